@@ -30,4 +30,7 @@
 
 + (instancetype)catWithDictionaryRepresentation:(NSDictionary *)dictionaryRepresentation;
 
+/// Compare the names of two cats, the order in which lists of cats are presented.
+- (NSComparisonResult)compareName:(AAPLCat *)otherCat;
+
 @end
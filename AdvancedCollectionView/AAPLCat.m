@@ -92,4 +92,9 @@ static NSMapTable *AAPLAllCatsTable()
         self.longDescription = description;
 }
 
+- (NSComparisonResult)compareName:(AAPLCat *)otherCat
+{
+    return [self.name localizedCaseInsensitiveCompare:otherCat.name];
+}
+
 @end
@@ -20,6 +20,9 @@
 
 #import "AAPLCollectionViewController.h"
 
+/// How many cats to show at a time as the list is read
+static const NSUInteger AAPLCatListBatchSize = 50;
+
 @interface AAPLCatListDataSource ()
 @end
 
@@ -44,32 +47,87 @@
     return cell;
 }
 
+/// Insert cats sorted by name among the items, which are sorted the same way.
+- (void)insertSortedCats:(NSArray *)cats
+{
+    NSArray *items = self.items;
+    NSUInteger numberOfItems = items.count;
+    NSUInteger itemIndex = 0;
+    NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+
+    // Each cat ends up after the items that don't sort after it and the cats before it in the batch
+    [cats enumerateObjectsUsingBlock:^(AAPLCat *cat, NSUInteger catIndex, BOOL *stop) {
+        while (itemIndex < numberOfItems && [items[itemIndex] compareName:cat] != NSOrderedDescending)
+            ++itemIndex;
+        [indexes addIndex:itemIndex + catIndex];
+    }];
+
+    [[self mutableArrayValueForKey:@"items"] insertObjects:cats atIndexes:indexes];
+}
+
 - (void)loadContent
 {
+    __weak typeof(&*self) weakself = self;
+
     [self loadContentWithBlock:^(AAPLLoading *loading) {
-        void (^handler)(NSArray *cats, NSError *error) = ^(NSArray *cats, NSError *error) {
+        __block BOOL loadedContent = NO;
+        // Cats read before the content update runs
+        __block NSMutableArray *pendingCats = nil;
+
+        BOOL (^batchHandler)(NSArray *cats) = ^(NSArray *cats) {
             // Check to make certain a more recent call to load content hasn't superceded this one…
+            if (!loading.current) {
+                [loading ignore];
+                return NO;
+            }
+
+            // The first batch replaces the placeholder, the rest fill in around it. Batches can arrive before the update has run.
+            if (!loadedContent) {
+                loadedContent = YES;
+                pendingCats = [cats mutableCopy];
+                [loading updateWithContent:^(AAPLCatListDataSource *me) {
+                    me.items = [pendingCats sortedArrayUsingSelector:@selector(compareName:)];
+                    pendingCats = nil;
+                }];
+            }
+            else if (pendingCats)
+                [pendingCats addObjectsFromArray:cats];
+            else
+                [weakself insertSortedCats:cats];
+            return YES;
+        };
+
+        void (^handler)(NSError *error) = ^(NSError *error) {
             if (!loading.current) {
                 [loading ignore];
                 return;
             }
 
-            if (error) {
+            if (error && !loadedContent) {
                 [loading done:NO error:error];
                 return;
             }
 
-            if (cats.count)
-                [loading updateWithContent:^(AAPLCatListDataSource *me) {
-                    me.items = cats;
-                }];
-            else
+            // The first batch already completed the load, so a later error goes to the data source directly rather than leaving the list cut short. The content update may still be waiting for the main queue, so this waits behind it.
+            if (error) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    AAPLCatListDataSource *me = weakself;
+                    if (!me || !loading.current)
+                        return;
+                    me.loadingError = error;
+                    me.loadingState = AAPLLoadStateError;
+                    [me notifyContentLoadedWithError:error];
+                });
+                return;
+            }
+
+            if (!loadedContent)
                 [loading updateWithNoContent:^(AAPLCatListDataSource *me) {
                     me.items = @[];
                 }];
         };
 
-        [[AAPLDataAccessManager manager] fetchCatListWithCompletionHandler:handler];
+        [[AAPLDataAccessManager manager] fetchCatListInBatchesOfSize:AAPLCatListBatchSize queue:loading.queue batchHandler:batchHandler completionHandler:handler];
     }];
 }
 
@@ -14,4 +14,9 @@
 @property (nonatomic, strong) NSDate *date;
 @property (nonatomic, strong) NSString *catFancier;
 @property (nonatomic, strong) NSString *shortDescription;
+
+/// A property list with the values of the sighting.
+- (NSDictionary *)dictionaryRepresentation;
+
++ (instancetype)sightingWithDictionaryRepresentation:(NSDictionary *)dictionaryRepresentation;
 @end
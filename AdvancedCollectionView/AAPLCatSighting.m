@@ -12,4 +12,25 @@
 
 @implementation AAPLCatSighting
 
++ (instancetype)sightingWithDictionaryRepresentation:(NSDictionary *)dictionaryRepresentation
+{
+    AAPLCatSighting *sighting = [[self alloc] init];
+    sighting.date = dictionaryRepresentation[@"date"];
+    sighting.catFancier = dictionaryRepresentation[@"catFancier"];
+    sighting.shortDescription = dictionaryRepresentation[@"shortDescription"];
+    return sighting;
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    NSMutableDictionary *dictionaryRepresentation = [NSMutableDictionary dictionary];
+    if (self.date)
+        dictionaryRepresentation[@"date"] = self.date;
+    if (self.catFancier)
+        dictionaryRepresentation[@"catFancier"] = self.catFancier;
+    if (self.shortDescription)
+        dictionaryRepresentation[@"shortDescription"] = self.shortDescription;
+    return dictionaryRepresentation;
+}
+
 @end
@@ -11,12 +11,19 @@
 #import <Foundation/Foundation.h>
 
 @class AAPLCat;
+@class AAPLDataCache;
 
 @interface AAPLDataAccessManager : NSObject
 
 + (AAPLDataAccessManager *)manager;
 
+/// Results are cached in memory and on disk, so fetching them again doesn't read or parse anything. Fetches of the same results at the same time share the work. The cache keeps statistics on its hit rate and evictions.
+@property (nonatomic, readonly) AAPLDataCache *cache;
+
 - (void)fetchCatListWithCompletionHandler:(void(^)(NSArray *cats, NSError *error))handler;
+
+/// Read the cat list a batch at a time, without parsing it as a whole. The batch handler is called on the main queue with each batch of at most batchSize cats, sorted by name, as soon as it has been read; return NO to stop reading. Reading waits while batches are still waiting for the main queue, so memory is bounded by the batch size. The list is read on queue, or a default priority global queue if queue is NULL. The completion handler is called on the main queue after the last batch.
+- (void)fetchCatListInBatchesOfSize:(NSUInteger)batchSize queue:(dispatch_queue_t)queue batchHandler:(BOOL(^)(NSArray *cats))batchHandler completionHandler:(void(^)(NSError *error))handler;
 - (void)fetchDetailForCat:(AAPLCat *)cat completionHandler:(void(^)(AAPLCat *cat, NSError *error))handler;
 - (void)fetchSightingsForCat:(AAPLCat *)cat completionHandler:(void(^)(NSArray *sightings, NSError *error))handler;
 
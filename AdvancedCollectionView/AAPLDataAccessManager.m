@@ -11,11 +11,163 @@
 #import "AAPLDataAccessManager.h"
 #import "AAPLCat.h"
 #import "AAPLCatSighting.h"
+#import "AAPLJSONArrayScanner.h"
+#import "AAPLDataCache.h"
+
+#import <sys/mman.h>
+#import <libkern/OSAtomic.h>
+
+/// How many bytes of a resource are handed to the scanner at a time
+static const NSUInteger AAPLJSONArrayStreamSliceLength = 1024 * 1024;
+
+/// How many batches may wait for the main queue before reading waits for them
+static const long AAPLJSONArrayStreamMaximumPendingBatches = 2;
+
+/// Decodes the elements of a JSON array one at a time, as AAPLJSONArrayScanner finds them, and delivers the resulting objects to the main queue in batches.
+@interface AAPLJSONArrayStream : NSObject
+- (instancetype)initWithBatchSize:(NSUInteger)batchSize objectBlock:(id(^)(id JSONObject))objectBlock batchHandler:(BOOL(^)(NSArray *batch))batchHandler;
+/// Scan the array that's the value of the key member of the data. Call on a background queue. Returns NO if the data couldn't be read, but not if the batch handler stopped reading.
+- (BOOL)scanData:(NSData *)data arrayKey:(NSString *)key error:(NSError **)error;
+@end
+
+@implementation AAPLJSONArrayStream {
+    NSUInteger _batchSize;
+    id (^_objectBlock)(id JSONObject);
+    BOOL (^_batchHandler)(NSArray *batch);
+    NSMutableArray *_batch;
+    NSUInteger _numberOfBatches;
+    NSTimeInterval _delay;
+    NSError *_error;
+    dispatch_semaphore_t _pendingBatches;
+    /// Set on the main queue when the batch handler stops reading
+    volatile int32_t _stopped;
+}
+
+static bool AAPLJSONArrayStreamElement(const char *bytes, size_t length, void *context)
+{
+    AAPLJSONArrayStream *stream = (__bridge AAPLJSONArrayStream *)context;
+    return [stream addElementWithBytes:bytes length:length];
+}
+
+static bool AAPLJSONArrayStreamMember(const char *name, size_t nameLength, const char *value, size_t valueLength, void *context)
+{
+    AAPLJSONArrayStream *stream = (__bridge AAPLJSONArrayStream *)context;
+    [stream setValueWithBytes:value length:valueLength forMemberWithName:[[NSString alloc] initWithBytes:name length:nameLength encoding:NSUTF8StringEncoding]];
+    return true;
+}
+
+- (instancetype)initWithBatchSize:(NSUInteger)batchSize objectBlock:(id (^)(id))objectBlock batchHandler:(BOOL (^)(NSArray *))batchHandler
+{
+    NSParameterAssert(batchSize > 0);
+    NSParameterAssert(objectBlock != nil);
+    NSParameterAssert(batchHandler != nil);
+
+    self = [super init];
+    if (!self)
+        return nil;
+
+    _batchSize = batchSize;
+    _objectBlock = [objectBlock copy];
+    _batchHandler = [batchHandler copy];
+    _batch = [NSMutableArray arrayWithCapacity:batchSize];
+    _pendingBatches = dispatch_semaphore_create(AAPLJSONArrayStreamMaximumPendingBatches);
+    return self;
+}
+
+- (BOOL)scanData:(NSData *)data arrayKey:(NSString *)key error:(NSError **)error
+{
+    AAPLJSONArrayScannerCallbacks callbacks = { AAPLJSONArrayStreamElement, AAPLJSONArrayStreamMember };
+    AAPLJSONArrayScannerRef scanner = AAPLJSONArrayScannerCreate(key.UTF8String, &callbacks, (__bridge void *)self);
+
+    const char *bytes = data.bytes;
+    NSUInteger length = data.length;
+
+    // Each page is only read once, so the pages of a mapped file can be let go as soon as they've been scanned
+    madvise((void *)bytes, length, MADV_SEQUENTIAL);
+
+    AAPLJSONArrayScannerResult result = AAPLJSONArrayScannerResultContinue;
+    for (NSUInteger offset = 0; offset < length && AAPLJSONArrayScannerResultContinue == result; offset += AAPLJSONArrayStreamSliceLength) {
+        @autoreleasepool {
+            result = AAPLJSONArrayScannerAppendBytes(scanner, bytes + offset, MIN(AAPLJSONArrayStreamSliceLength, length - offset));
+        }
+    }
+
+    BOOL complete = AAPLJSONArrayScannerIsComplete(scanner);
+    AAPLJSONArrayScannerRelease(scanner);
+
+    if (AAPLJSONArrayScannerResultStopped == result && !_error)
+        return YES;
+
+    if (!_error && !complete)
+        _error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSPropertyListReadCorruptError userInfo:@{ NSLocalizedDescriptionKey : [NSString stringWithFormat:@"The data is not an object with a \"%@\" array.", key] }];
+
+    if (_error) {
+        if (error)
+            *error = _error;
+        return NO;
+    }
+
+    [self deliverBatch];
+    return YES;
+}
+
+- (BOOL)addElementWithBytes:(const char *)bytes length:(size_t)length
+{
+    NSData *data = [NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO];
+    NSError *error;
+    id JSONObject = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    if (!JSONObject) {
+        _error = error;
+        return false;
+    }
+
+    id object = _objectBlock(JSONObject);
+    if (object)
+        [_batch addObject:object];
+
+    if (_batch.count < _batchSize)
+        return true;
+    return [self deliverBatch];
+}
+
+- (void)setValueWithBytes:(const char *)bytes length:(size_t)length forMemberWithName:(NSString *)name
+{
+    if (![name isEqualToString:@"delayResults"])
+        return;
+    NSString *value = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    _delay = [value doubleValue];
+}
+
+- (BOOL)deliverBatch
+{
+    if (_stopped)
+        return NO;
+    if (!_batch.count)
+        return YES;
+
+    // A delay ahead of the array holds back the first batch, the way a slow connection would
+    if (!_numberOfBatches++ && _delay > 0)
+        [NSThread sleepForTimeInterval:_delay];
+
+    NSArray *batch = _batch;
+    _batch = [NSMutableArray arrayWithCapacity:_batchSize];
+
+    dispatch_semaphore_wait(_pendingBatches, DISPATCH_TIME_FOREVER);
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (!_stopped && !_batchHandler(batch))
+            OSAtomicCompareAndSwap32Barrier(0, 1, &_stopped);
+        dispatch_semaphore_signal(_pendingBatches);
+    });
+
+    return !_stopped;
+}
 
-@interface AAPLDataAccessManager ()
-@property (nonatomic, strong) NSCache *sightingsCache;
 @end
 
+/// How many bytes of results are kept in memory and on disk
+static const NSUInteger AAPLDataAccessManagerMemoryCostLimit = 1024 * 1024;
+static const NSUInteger AAPLDataAccessManagerDiskCostLimit = 16 * 1024 * 1024;
+
 @implementation AAPLDataAccessManager
 
 + (AAPLDataAccessManager *)manager
@@ -29,6 +181,16 @@
     return manager;
 }
 
+- (instancetype)init
+{
+    self = [super init];
+    if (!self)
+        return nil;
+
+    _cache = [[AAPLDataCache alloc] initWithName:@"AAPLDataAccessManager" memoryCostLimit:AAPLDataAccessManagerMemoryCostLimit diskCostLimit:AAPLDataAccessManagerDiskCostLimit];
+    return self;
+}
+
 - (void)fetchJSONResourceWithName:(NSString *)name completionHandler:(void(^)(NSDictionary *json, NSError *error))handler
 {
     NSParameterAssert(handler != nil);
@@ -69,19 +231,24 @@
 
 - (void)fetchCatListWithCompletionHandler:(void(^)(NSArray *cats, NSError *error))handler
 {
-    [self fetchJSONResourceWithName:@"CatList" completionHandler:^(NSDictionary *json, NSError *error) {
-        if (error) {
-            if (handler) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    handler(nil, error);
-                });
+    [self.cache fetchObjectForKey:@"CatList" usingBlock:^(AAPLDataCacheFetchCompletion completion) {
+        [self fetchJSONResourceWithName:@"CatList" completionHandler:^(NSDictionary *json, NSError *error) {
+            if (error) {
+                completion(nil, error);
+                return;
             }
+
+            NSArray *results = json[@"results"];
+            NSAssert([results isKindOfClass:[NSArray class]], @"results property should be an array of cats");
+            completion(results, nil);
+        }];
+    } completionHandler:^(NSArray *results, NSError *error) {
+        if (error) {
+            if (handler)
+                handler(nil, error);
             return;
         }
 
-        NSArray *results = json[@"results"];
-        NSAssert([results isKindOfClass:[NSArray class]], @"results property should be an array of cats");
-
         NSMutableArray *cats = [NSMutableArray array];
         for (NSDictionary *catDictionary in results) {
             AAPLCat *cat = [AAPLCat catWithDictionaryRepresentation:catDictionary];
@@ -90,16 +257,47 @@
             [cats addObject:cat];
         }
 
-        [cats sortUsingComparator:^(AAPLCat *cat1, AAPLCat *cat2) {
-            return [cat1.name localizedCaseInsensitiveCompare:cat2.name];
-        }];
+        [cats sortUsingSelector:@selector(compareName:)];
+
+        if (handler)
+            handler(cats, nil);
+    }];
+}
+
+- (void)fetchCatListInBatchesOfSize:(NSUInteger)batchSize queue:(dispatch_queue_t)queue batchHandler:(BOOL (^)(NSArray *))batchHandler completionHandler:(void (^)(NSError *))handler
+{
+    NSParameterAssert(batchHandler != nil);
+
+    NSURL *resourceURL = [[NSBundle mainBundle] URLForResource:@"CatList" withExtension:@"json"];
+    NSAssert(resourceURL != nil, @"Could not find resource: CatList");
+
+    if (!queue)
+        queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    NSAssert(queue != dispatch_get_main_queue(), @"reading waits for the main queue, so it can't happen there");
+
+    AAPLJSONArrayStream *stream = [[AAPLJSONArrayStream alloc] initWithBatchSize:batchSize objectBlock:^id(NSDictionary *catDictionary) {
+        if (![catDictionary isKindOfClass:[NSDictionary class]])
+            return nil;
+        return [AAPLCat catWithDictionaryRepresentation:catDictionary];
+    } batchHandler:^BOOL(NSArray *cats) {
+        return batchHandler([cats sortedArrayUsingSelector:@selector(compareName:)]);
+    }];
+
+    dispatch_async(queue, ^{
+        NSError *error;
+
+        // Map the file rather than reading it, so only the pages being scanned need to be in memory
+        NSData *jsonData = [NSData dataWithContentsOfURL:resourceURL options:NSDataReadingMappedAlways error:&error];
+        if (jsonData)
+            [stream scanData:jsonData arrayKey:@"results" error:&error];
 
+        // Batches are delivered to the main queue in order, so this follows the last of them
         if (handler) {
             dispatch_async(dispatch_get_main_queue(), ^{
-                handler(cats, nil);
+                handler(error);
             });
         }
-    }];
+    });
 }
 
 - (void)fetchDetailForCat:(AAPLCat *)cat completionHandler:(void (^)(AAPLCat *, NSError *))handler
@@ -108,24 +306,27 @@
 
     NSString *resourceName = [NSString stringWithFormat:@"detail-%@", cat.uniqueID];
 
-    [self fetchJSONResourceWithName:resourceName completionHandler:^(NSDictionary *json, NSError *error) {
-        if (error) {
-            if (handler) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    handler(nil, error);
-                });
+    [self.cache fetchObjectForKey:resourceName usingBlock:^(AAPLDataCacheFetchCompletion completion) {
+        [self fetchJSONResourceWithName:resourceName completionHandler:^(NSDictionary *json, NSError *error) {
+            if (error) {
+                completion(nil, error);
+                return;
             }
+
+            NSDictionary *results = json[@"results"];
+            NSAssert([results isKindOfClass:[NSDictionary class]], @"results property should be a dictionary with a cat detail");
+            completion(results, nil);
+        }];
+    } completionHandler:^(NSDictionary *results, NSError *error) {
+        if (error) {
+            if (handler)
+                handler(nil, error);
             return;
         }
 
-        NSDictionary *results = json[@"results"];
-        NSAssert([results isKindOfClass:[NSDictionary class]], @"results property should be a dictionary with a cat detail");
-
         [cat updateWithDictionaryRepresentation:results];
         if (handler)
-            dispatch_async(dispatch_get_main_queue(), ^{
-                handler(cat, nil);
-            });
+            handler(cat, nil);
     }];
 }
 
@@ -133,17 +334,9 @@
 {
     NSParameterAssert(cat != nil);
 
-    if (!self.sightingsCache)
-        self.sightingsCache = [[NSCache alloc] init];
+    NSString *key = [NSString stringWithFormat:@"sightings-%@", cat.uniqueID];
 
-    NSArray *sightings = [self.sightingsCache objectForKey:cat.uniqueID];
-    if (sightings) {
-        if (handler)
-            handler(sightings, nil);
-        return;
-    }
-
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+    [self.cache fetchObjectForKey:key usingBlock:^(AAPLDataCacheFetchCompletion completion) {
         // Just make up some random sightings for this cat…
         NSArray *names = @[@"Jani Izabella", @"Billie Dilşad", @"Kerensa Marita", @"Noach Janetta", @"Janele Tzion", @"Phyliss Forest", @"Roswell Wolfgang", @"Meri Floella", @"Minty Honor", @"Afon Geoffrey"];
 
@@ -165,16 +358,26 @@
             sighting.catFancier = names[arc4random_uniform(numberOfNames)];
             sighting.shortDescription = @"Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt mollit anim id est laborum.";
 
-            [sightings addObject:sighting];
+            [sightings addObject:[sighting dictionaryRepresentation]];
         }
 
-        [self.sightingsCache setObject:sightings forKey:cat.uniqueID];
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(1 * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            completion(sightings, nil);
+        });
+    } completionHandler:^(NSArray *sightingDictionaries, NSError *error) {
+        if (error) {
+            if (handler)
+                handler(nil, error);
+            return;
+        }
+
+        NSMutableArray *sightings = [NSMutableArray arrayWithCapacity:sightingDictionaries.count];
+        for (NSDictionary *sightingDictionary in sightingDictionaries)
+            [sightings addObject:[AAPLCatSighting sightingWithDictionaryRepresentation:sightingDictionary]];
 
         if (handler)
-            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
-                handler(sightings, nil);
-            });
-    });
+            handler(sightings, nil);
+    }];
 }
 
 @end
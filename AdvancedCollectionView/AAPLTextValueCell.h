@@ -14,4 +14,7 @@
 
 - (void)configureWithText:(NSString *)text;
 
+/// The size of a cell displaying text, computed without creating a cell. Safe to call from any thread.
++ (CGSize)sizeForText:(NSString *)text fittingSize:(CGSize)fittingSize;
+
 @end
@@ -10,6 +10,10 @@
 
 #import "AAPLTextValueCell.h"
 
+/// The label's insets within the content view. These must match the constraints created in -initWithFrame:.
+static const CGFloat AAPLTextValueCellHorizontalMargin = 15;
+static const CGFloat AAPLTextValueCellVerticalMargin = 3;
+
 @interface AAPLTextValueCell ()
 @property (nonatomic, strong) UILabel *label;
 @end
@@ -26,7 +30,7 @@
 
     _label = [[UILabel alloc] initWithFrame:CGRectZero];
     _label.translatesAutoresizingMaskIntoConstraints = NO;
-    _label.font = [UIFont systemFontOfSize:12];
+    _label.font = [[self class] textFont];
     _label.textColor = [UIColor colorWithWhite:77/255.0 alpha:1];
     _label.lineBreakMode = NSLineBreakByWordWrapping;
     _label.numberOfLines = 0;
@@ -35,8 +39,8 @@
     NSMutableArray *constraints = [NSMutableArray array];
     NSDictionary *views = NSDictionaryOfVariableBindings(_label);
 
-    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"H:|-15-[_label]-15-|" options:0 metrics:nil views:views]];
-    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"V:|-3-[_label]-3-|" options:0 metrics:nil views:views]];
+    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"H:|-margin-[_label]-margin-|" options:0 metrics:@{ @"margin" : @(AAPLTextValueCellHorizontalMargin) } views:views]];
+    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"V:|-margin-[_label]-margin-|" options:0 metrics:@{ @"margin" : @(AAPLTextValueCellVerticalMargin) } views:views]];
 
     [contentView addConstraints:constraints];
 
@@ -48,10 +52,22 @@
     _label.text = text;
 }
 
++ (UIFont *)textFont
+{
+    return [UIFont systemFontOfSize:12];
+}
+
++ (CGSize)sizeForText:(NSString *)text fittingSize:(CGSize)fittingSize
+{
+    CGSize textSize = CGSizeMake(fittingSize.width - 2 * AAPLTextValueCellHorizontalMargin, CGFLOAT_MAX);
+    CGRect textRect = [text boundingRectWithSize:textSize options:NSStringDrawingUsesLineFragmentOrigin attributes:@{ NSFontAttributeName : [self textFont] } context:nil];
+    return CGSizeMake(fittingSize.width, ceil(CGRectGetHeight(textRect)) + 2 * AAPLTextValueCellVerticalMargin);
+}
+
 - (void)layoutSubviews
 {
     CGRect bounds = self.bounds;
-    _label.preferredMaxLayoutWidth = CGRectGetWidth(bounds) - 30;
+    _label.preferredMaxLayoutWidth = CGRectGetWidth(bounds) - 2 * AAPLTextValueCellHorizontalMargin;
     [super layoutSubviews];
 }
 
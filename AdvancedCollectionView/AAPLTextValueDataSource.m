@@ -18,8 +18,23 @@
 static NSString * const AAPLTextValueDataSourceKeyPathKey = @"keyPath";
 static NSString * const AAPLTextValueDataSourceLabelKey = @"label";
 
+/// What the data source last reported for the measurement of one key path: its identifier, the text it was measured with and the version of that text
+@interface AAPLTextValueMeasurement : NSObject
+@property (nonatomic, copy) NSString *identifier;
+@property (nonatomic, copy) NSString *text;
+@property (nonatomic) NSUInteger version;
+@end
+
+@implementation AAPLTextValueMeasurement
+@end
+
+/// Versions are unique across data sources, so a new data source that happens to get the address, and so the identifiers, of a released one never matches its cached heights
+static NSUInteger AAPLTextValueMeasurementLastVersion;
+
 @interface AAPLTextValueDataSource ()
 @property (nonatomic, strong) id object;
+/// Measurements keyed by key path
+@property (nonatomic, strong) NSMutableDictionary *measurements;
 @end
 
 @implementation AAPLTextValueDataSource
@@ -38,6 +53,7 @@ static NSString * const AAPLTextValueDataSourceLabelKey = @"label";
         return nil;
 
     _object = object;
+    _measurements = [NSMutableDictionary dictionary];
 
     self.defaultMetrics.selectedBackgroundColor = nil;
 
@@ -129,6 +145,52 @@ static NSString * const AAPLTextValueDataSourceLabelKey = @"label";
     return fittingSize;
 }
 
+- (AAPLItemSizeBlock)collectionView:(UICollectionView *)collectionView sizeBlockForItemsInSection:(NSInteger)section
+{
+    // Each section has a single item, so capture its text now rather than reading the object from another thread
+    NSDictionary *dictionary = _items[section];
+    NSString *value = [[self.object valueForKeyPath:dictionary[AAPLTextValueDataSourceKeyPathKey]] copy];
+
+    return ^(NSInteger itemIndex, CGSize fittingSize) {
+        return [AAPLTextValueCell sizeForText:value fittingSize:fittingSize];
+    };
+}
+
+/// The measurement for the item, with its version bumped if the text has changed since the layout last asked. The object may change its values without telling the data source, so the text is compared rather than trusted.
+- (AAPLTextValueMeasurement *)measurementForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    NSDictionary *dictionary = [self itemAtIndexPath:indexPath];
+    NSString *keyPath = dictionary[AAPLTextValueDataSourceKeyPathKey];
+    NSString *value = [self.object valueForKeyPath:keyPath];
+
+    AAPLTextValueMeasurement *measurement = _measurements[keyPath];
+    if (!measurement) {
+        // Other data sources may show the same key paths in the same layout, so the identifier includes this data source
+        measurement = [[AAPLTextValueMeasurement alloc] init];
+        measurement.identifier = [NSString stringWithFormat:@"%@ %p %@", NSStringFromClass(self.class), (__bridge void *)self, keyPath];
+        measurement.text = value;
+        measurement.version = ++AAPLTextValueMeasurementLastVersion;
+        _measurements[keyPath] = measurement;
+    }
+    else if (measurement.text != value && ![measurement.text isEqualToString:value]) {
+        measurement.text = value;
+        measurement.version = ++AAPLTextValueMeasurementLastVersion;
+    }
+
+    return measurement;
+}
+
+- (id<NSCopying>)collectionView:(UICollectionView *)collectionView measurementIdentifierForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    return [self measurementForItemAtIndexPath:indexPath].identifier;
+}
+
+- (NSUInteger)collectionView:(UICollectionView *)collectionView measurementVersionForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    // The height only depends on the text
+    return [self measurementForItemAtIndexPath:indexPath].version;
+}
+
 - (UICollectionViewCell *)collectionView:(UICollectionView *)collectionView cellForItemAtIndexPath:(NSIndexPath *)indexPath
 {
     AAPLTextValueCell *cell = [collectionView dequeueReusableCellWithReuseIdentifier:NSStringFromClass([AAPLTextValueCell class]) forIndexPath:indexPath];
@@ -11,7 +11,13 @@
 /// The items represented by this data source. This property is KVC compliant for mutable changes via -mutableArrayValueForKey:.
 @property (nonatomic, copy) NSArray *items;
 
-/// Set the items with optional animation. By default, setting the items is not animated.
+/// Set the items with optional animation. By default, setting the items is not animated. When animated, only the minimal set of deletes, inserts and moves is reported, and items with the same identifier that are no longer equal are refreshed.
 - (void)setItems:(NSArray *)items animated:(BOOL)animated;
 
+/// Set the items, computing the changes on a background queue and applying them on the main thread in a single batch update. If this is called again before the changes land, only the latest items are applied, in one update, and every completion is called once it finishes. Pending items are dropped with a NO completion when the content is reset. -identifierForItem: is called on the background queue.
+- (void)setItemsInBackground:(NSArray *)items completion:(void (^)(BOOL finished))completion;
+
+/// The value that identifies an item across changes to its content, compared with -isEqual:. Must be safe to call from any thread. Used by -setItems:animated: to tell an updated item from a replaced one. The default returns the item itself.
+- (id)identifierForItem:(id)item;
+
 @end
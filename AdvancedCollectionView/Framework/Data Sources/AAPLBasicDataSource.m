@@ -5,12 +5,43 @@
 
 #import "AAPLBasicDataSource.h"
 #import "AAPLDataSource+Subclasses.h"
+#import "AAPLArrayDiff.h"
+
+static NSArray *AAPLIndexPathsForItemIndexes(NSIndexSet *indexes)
+{
+    NSMutableArray *indexPaths = [NSMutableArray arrayWithCapacity:[indexes count]];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForItem:idx inSection:0]];
+    }];
+    return indexPaths;
+}
+
+/// Changes for every basic data source are computed on one serial queue, so diffs don't compete with each other for cores
+static dispatch_queue_t AAPLBasicDataSourceDiffingQueue(void)
+{
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.example.apple-samplecode.AdvancedCollectionView.diffing", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+@interface AAPLBasicDataSource ()
+/// The latest items passed to -setItemsInBackground:completion: that haven't been applied yet
+@property (nonatomic, copy) NSArray *pendingItems;
+/// The completion blocks of every background update that will be applied with the pending items
+@property (nonatomic, strong) NSMutableArray *pendingCompletions;
+/// Whether changes are being computed on the diffing queue
+@property (nonatomic) BOOL diffingInBackground;
+@end
 
 @implementation AAPLBasicDataSource
 
 - (void)resetContent
 {
     [super resetContent];
+    [self cancelPendingItems];
     self.items = @[];
 }
 
@@ -45,48 +76,149 @@
         return;
     }
 
-    NSOrderedSet *oldItemSet = [NSOrderedSet orderedSetWithArray:_items];
-    NSOrderedSet *newItemSet = [NSOrderedSet orderedSetWithArray:items];
+    dispatch_block_t update = [self updateBlockForChangesFromItems:_items toItems:items];
 
-    NSMutableOrderedSet *deletedItems = [oldItemSet mutableCopy];
-    [deletedItems minusOrderedSet:newItemSet];
+    _items = [items copy];
+    [self updateLoadingStateFromItems];
+    [self notifyBatchUpdate:update completion:NULL];
+}
 
-    NSMutableOrderedSet *newItems = [newItemSet mutableCopy];
-    [newItems minusOrderedSet:oldItemSet];
+/// Compute the notifications that turn oldItems into newItems, or nil if nothing changed. This only reads its arguments and calls -identifierForItem:, so it may be called on any thread. The block must be called on the main thread within a batch update.
+- (dispatch_block_t)updateBlockForChangesFromItems:(NSArray *)oldItems toItems:(NSArray *)newItems
+{
+    AAPLArrayDiff *diff = [AAPLArrayDiff diffFromArray:oldItems toArray:newItems identifierBlock:^(id item) {
+        return [self identifierForItem:item];
+    }];
 
-    NSMutableOrderedSet *movedItems = [newItemSet mutableCopy];
-    [movedItems intersectOrderedSet:oldItemSet];
+    if (!diff.hasChanges)
+        return nil;
 
-    NSMutableArray *deletedIndexPaths = [NSMutableArray arrayWithCapacity:[deletedItems count]];
-    for (id deletedItem in deletedItems) {
-        [deletedIndexPaths addObject:[NSIndexPath indexPathForItem:[oldItemSet indexOfObject:deletedItem] inSection:0]];
-    }
+    NSIndexSet *movedIndexes = diff.movedIndexes;
+    NSMutableIndexSet *removedIndexes = [diff.deletedIndexes mutableCopy];
+    NSMutableIndexSet *insertedIndexes = [diff.insertedIndexes mutableCopy];
+    NSMutableIndexSet *refreshedIndexes = [diff.updatedIndexes mutableCopy];
 
-    NSMutableArray *insertedIndexPaths = [NSMutableArray arrayWithCapacity:[newItems count]];
-    for (id newItem in newItems) {
-        [insertedIndexPaths addObject:[NSIndexPath indexPathForItem:[newItemSet indexOfObject:newItem] inSection:0]];
-    }
+    // UICollectionView can't reload and move the same item in one batch, so updated items that also moved are replaced instead
+    NSIndexSet *replacedIndexes = [refreshedIndexes indexesPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+        return [movedIndexes containsIndex:idx];
+    }];
+    [replacedIndexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [removedIndexes addIndex:idx];
+        [insertedIndexes addIndex:[diff newIndexForIndex:idx]];
+    }];
+    [refreshedIndexes removeIndexes:replacedIndexes];
+
+    NSArray *removedIndexPaths = AAPLIndexPathsForItemIndexes(removedIndexes);
+    NSArray *insertedIndexPaths = AAPLIndexPathsForItemIndexes(insertedIndexes);
+    NSArray *refreshedIndexPaths = AAPLIndexPathsForItemIndexes(refreshedIndexes);
+
+    // Only the items that changed position relative to their neighbors are moved
+    NSMutableArray *fromMovedIndexPaths = [NSMutableArray arrayWithCapacity:[movedIndexes count]];
+    NSMutableArray *toMovedIndexPaths = [NSMutableArray arrayWithCapacity:[movedIndexes count]];
+    [diff enumerateMovesUsingBlock:^(NSUInteger fromIndex, NSUInteger toIndex, BOOL *stop) {
+        if ([replacedIndexes containsIndex:fromIndex])
+            return;
+        [fromMovedIndexPaths addObject:[NSIndexPath indexPathForItem:fromIndex inSection:0]];
+        [toMovedIndexPaths addObject:[NSIndexPath indexPathForItem:toIndex inSection:0]];
+    }];
 
-    NSMutableArray *fromMovedIndexPaths = [NSMutableArray arrayWithCapacity:[movedItems count]];
-    NSMutableArray *toMovedIndexPaths = [NSMutableArray arrayWithCapacity:[movedItems count]];
-    for (id movedItem in movedItems) {
-        [fromMovedIndexPaths addObject:[NSIndexPath indexPathForItem:[oldItemSet indexOfObject:movedItem] inSection:0]];
-        [toMovedIndexPaths addObject:[NSIndexPath indexPathForItem:[newItemSet indexOfObject:movedItem] inSection:0]];
-    }
+    return ^{
+        if ([removedIndexPaths count])
+            [self notifyItemsRemovedAtIndexPaths:removedIndexPaths];
 
-    _items = [items copy];
+        if ([insertedIndexPaths count])
+            [self notifyItemsInsertedAtIndexPaths:insertedIndexPaths];
+
+        if ([refreshedIndexPaths count])
+            [self notifyItemsRefreshedAtIndexPaths:refreshedIndexPaths];
+
+        [fromMovedIndexPaths enumerateObjectsUsingBlock:^(NSIndexPath *fromIndexPath, NSUInteger idx, BOOL *stop) {
+            [self notifyItemMovedFromIndexPath:fromIndexPath toIndexPaths:toMovedIndexPaths[idx]];
+        }];
+    };
+}
+
+- (void)setItemsInBackground:(NSArray *)items completion:(void (^)(BOOL finished))completion
+{
+    NSAssert([NSThread isMainThread], @"This method must be called on the main thread");
+
+    if (!_pendingCompletions)
+        _pendingCompletions = [NSMutableArray array];
+
+    self.pendingItems = items ? : @[];
+    if (completion)
+        [_pendingCompletions addObject:[completion copy]];
+
+    // The diff in flight picks up the latest items when it lands
+    if (_diffingInBackground)
+        return;
+
+    [self diffPendingItemsInBackground];
+}
+
+- (void)diffPendingItemsInBackground
+{
+    NSArray *oldItems = _items;
+    NSArray *newItems = _pendingItems;
+    _diffingInBackground = YES;
+
+    dispatch_async(AAPLBasicDataSourceDiffingQueue(), ^{
+        dispatch_block_t update = [self updateBlockForChangesFromItems:oldItems toItems:newItems];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            self.diffingInBackground = NO;
+
+            // Cancelled by -resetContent
+            if (!self.pendingItems)
+                return;
+
+            // Superseded by newer items, or the items changed underneath the diff: start over from what's there now
+            if (self.pendingItems != newItems || self.items != oldItems) {
+                [self diffPendingItemsInBackground];
+                return;
+            }
+
+            [self applyPendingItemsWithUpdate:update];
+        });
+    });
+}
+
+- (void)applyPendingItemsWithUpdate:(dispatch_block_t)update
+{
+    NSArray *completions = _pendingCompletions;
+    _pendingCompletions = [NSMutableArray array];
+
+    void (^completion)(BOOL) = ^(BOOL finished) {
+        for (void (^pendingCompletion)(BOOL) in completions)
+            pendingCompletion(finished);
+    };
+
+    // Items with the same identifiers may still be different objects, so keep the new ones even when nothing changes on screen
+    _items = _pendingItems;
+    self.pendingItems = nil;
     [self updateLoadingStateFromItems];
 
-    if ([deletedIndexPaths count])
-        [self notifyItemsRemovedAtIndexPaths:deletedIndexPaths];
+    if (!update) {
+        completion(YES);
+        return;
+    }
 
-    if ([insertedIndexPaths count])
-        [self notifyItemsInsertedAtIndexPaths:insertedIndexPaths];
+    [self notifyBatchUpdate:update completion:completion];
+}
+
+- (void)cancelPendingItems
+{
+    NSArray *completions = _pendingCompletions;
+    _pendingCompletions = nil;
+    self.pendingItems = nil;
 
-	[fromMovedIndexPaths enumerateObjectsUsingBlock:^(NSIndexPath *fromIndexPath, NSUInteger idx, BOOL *stop) {
-		NSIndexPath *toIndexPath = toMovedIndexPaths[idx];
-		[self notifyItemMovedFromIndexPath:fromIndexPath toIndexPaths:toIndexPath];
-	}];
+    for (void (^pendingCompletion)(BOOL) in completions)
+        pendingCompletion(NO);
+}
+
+- (id)identifierForItem:(id)item
+{
+    return item;
 }
 
 - (void)updateLoadingStateFromItems
@@ -7,16 +7,34 @@
 #import "AAPLDataSource+Subclasses.h"
 #import "AAPLComposedCollectionView.h"
 
+/// The merged snapshot metrics for the sections of one child data source, along with the versions and position they were built for.
+@interface AAPLComposedSnapshotMetrics : NSObject
+@property (nonatomic) NSUInteger dataSourceVersion;
+@property (nonatomic) NSUInteger enclosingVersion;
+@property (nonatomic) NSUInteger globalSectionOffset;
+@property (nonatomic, copy) NSArray *sectionMetrics;
+@end
+
+@implementation AAPLComposedSnapshotMetrics
+@end
+
 @interface AAPLComposedDataSource () <AAPLDataSourceDelegate>
 @property (nonatomic, retain) NSMutableArray *mappings;
 @property (nonatomic, retain) NSMapTable *dataSourceToMappings;
-@property (nonatomic, retain) NSMutableDictionary *globalSectionToMappings;
+@property (nonatomic, retain) NSMapTable *dataSourceToSnapshotMetrics;
 @property (nonatomic) NSUInteger sectionCount;
 @property (nonatomic, readonly) NSArray *dataSources;
 @property (nonatomic, strong) NSString *aggregateLoadingState;
 @end
 
-@implementation AAPLComposedDataSource
+@implementation AAPLComposedDataSource {
+    /// The first global section of each mapping followed by the total number of sections, so the mapping for a global section can be found with a binary search
+    NSUInteger *_sectionOffsets;
+    /// Bumped whenever sections move between children
+    NSUInteger _mappingsVersion;
+    /// The version of this data source's own metrics, gathered along with metricsVersion
+    NSUInteger _enclosingMetricsVersion;
+}
 
 - (instancetype)init
 {
@@ -26,26 +44,59 @@
 
     _mappings = [[NSMutableArray alloc] init];
     _dataSourceToMappings = [[NSMapTable alloc] initWithKeyOptions:NSMapTableObjectPointerPersonality valueOptions:NSMapTableStrongMemory capacity:1];
-    _globalSectionToMappings = [[NSMutableDictionary alloc] init];
+    _dataSourceToSnapshotMetrics = [[NSMapTable alloc] initWithKeyOptions:NSMapTableObjectPointerPersonality valueOptions:NSMapTableStrongMemory capacity:1];
+    [self updateMappings];
 
     return self;
 }
 
+- (void)dealloc
+{
+    free(_sectionOffsets);
+}
+
+/// Recompute the sections of every mapping. Only needed when data sources are added or removed, or a child reloads.
 - (void)updateMappings
 {
+    NSUInteger numberOfMappings = [_mappings count];
+    _sectionOffsets = reallocf(_sectionOffsets, (numberOfMappings + 1) * sizeof(NSUInteger));
+
     _sectionCount = 0;
-    [_globalSectionToMappings removeAllObjects];
+    for (NSUInteger mappingIndex = 0; mappingIndex < numberOfMappings; ++mappingIndex) {
+        _sectionOffsets[mappingIndex] = _sectionCount;
+        _sectionCount = [_mappings[mappingIndex] updateMappingsStartingWithGlobalSection:_sectionCount];
+    }
+    _sectionOffsets[numberOfMappings] = _sectionCount;
+    _mappingsVersion = AAPLLayoutMetricsNextVersion();
+}
 
-    for (AAPLComposedMapping *mapping in _mappings) {
-        NSUInteger newSectionCount = [mapping updateMappingsStartingWithGlobalSection:_sectionCount];
-        while (_sectionCount < newSectionCount)
-            _globalSectionToMappings[@(_sectionCount++)] = mapping;
+/// Update the sections of one child after its number of sections changed. The mappings after it only move, so their data sources aren't asked for their number of sections.
+- (void)updateMappingForDataSource:(AAPLDataSource *)dataSource
+{
+    AAPLComposedMapping *mapping = [self mappingForDataSource:dataSource];
+    NSUInteger mappingIndex = [_mappings indexOfObjectIdenticalTo:mapping];
+    NSAssert(mappingIndex != NSNotFound, @"Data source not found in mapping");
+
+    NSUInteger numberOfMappings = [_mappings count];
+    NSUInteger oldEndSection = _sectionOffsets[mappingIndex + 1];
+    NSUInteger newEndSection = [mapping updateMappingsStartingWithGlobalSection:_sectionOffsets[mappingIndex]];
+    NSInteger delta = (NSInteger)newEndSection - (NSInteger)oldEndSection;
+    if (!delta)
+        return;
+
+    for (NSUInteger index = mappingIndex + 1; index < numberOfMappings; ++index) {
+        [_mappings[index] offsetGlobalSectionsBy:delta];
+        _sectionOffsets[index] += delta;
     }
+
+    _sectionOffsets[numberOfMappings] += delta;
+    _sectionCount = _sectionOffsets[numberOfMappings];
+    _mappingsVersion = AAPLLayoutMetricsNextVersion();
 }
 
 - (AAPLDataSource *)dataSourceForSectionAtIndex:(NSInteger)sectionIndex
 {
-    AAPLComposedMapping *mapping = _globalSectionToMappings[@(sectionIndex)];
+    AAPLComposedMapping *mapping = [self mappingForGlobalSection:sectionIndex];
     return mapping.dataSource;
 }
 
@@ -57,8 +108,20 @@
 
 - (AAPLComposedMapping *)mappingForGlobalSection:(NSInteger)section
 {
-    AAPLComposedMapping *mapping = _globalSectionToMappings[@(section)];
-    return mapping;
+    if (section < 0 || (NSUInteger)section >= _sectionCount)
+        return nil;
+
+    // Find the last mapping starting at or before the section. A mapping without sections starts where the next one does, so it's never the last.
+    NSUInteger low = 0, high = [_mappings count];
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (_sectionOffsets[middle] <= (NSUInteger)section)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return _mappings[low - 1];
 }
 
 - (AAPLComposedMapping *)mappingForDataSource:(AAPLDataSource *)dataSource
@@ -102,6 +165,7 @@
     NSParameterAssert(dataSource != nil);
 
     dataSource.delegate = self;
+    dataSource.loadingPriority = self.loadingPriority;
 
     AAPLComposedMapping *mappingForDataSource = [_dataSourceToMappings objectForKey:dataSource];
     NSAssert(mappingForDataSource == nil, @"tried to add data source more than once: %@", dataSource);
@@ -129,6 +193,7 @@
         [removedSections addIndex:[mappingForDataSource globalSectionForLocalSection:sectionIdx]];
 
     [_dataSourceToMappings removeObjectForKey:dataSource];
+    [_dataSourceToSnapshotMetrics removeObjectForKey:dataSource];
     [_mappings removeObject:mappingForDataSource];
 
     dataSource.delegate = nil;
@@ -140,7 +205,6 @@
 
 - (NSUInteger)numberOfSections
 {
-    [self updateMappings];
     return _sectionCount;
 }
 
@@ -150,13 +214,54 @@
     NSInteger localSection = [mapping localSectionForGlobalSection:(NSUInteger)sectionIndex];
     AAPLDataSource *dataSource = mapping.dataSource;
 
-    AAPLLayoutSectionMetrics *metrics = [dataSource snapshotMetricsForSectionAtIndex:localSection];
+    AAPLLayoutSectionMetrics *metrics = [dataSource cachedSnapshotMetricsForSectionAtIndex:localSection];
     AAPLLayoutSectionMetrics *enclosingMetrics = [super snapshotMetricsForSectionAtIndex:sectionIndex];
 
     [enclosingMetrics applyValuesFromMetrics:metrics];
     return enclosingMetrics;
 }
 
+- (AAPLLayoutSectionMetrics *)cachedSnapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex
+{
+    AAPLComposedMapping *mapping = [self mappingForGlobalSection:sectionIndex];
+    if (!mapping)
+        return [super cachedSnapshotMetricsForSectionAtIndex:sectionIndex];
+
+    // Reading metricsVersion brings _enclosingMetricsVersion up to date
+    (void)self.metricsVersion;
+    AAPLDataSource *dataSource = mapping.dataSource;
+    NSUInteger dataSourceVersion = dataSource.metricsVersion;
+    NSUInteger enclosingVersion = _enclosingMetricsVersion;
+    NSUInteger globalSectionOffset = mapping.globalSectionOffset;
+    NSUInteger numberOfSections = (NSUInteger)mapping.sectionCount;
+
+    // Each child keeps its merged metrics until its own metrics, the metrics of this data source or its position change, so a change in one child doesn't copy the metrics of the others
+    AAPLComposedSnapshotMetrics *snapshot = [_dataSourceToSnapshotMetrics objectForKey:dataSource];
+    if (!snapshot || snapshot.dataSourceVersion != dataSourceVersion || snapshot.enclosingVersion != enclosingVersion || snapshot.globalSectionOffset != globalSectionOffset || snapshot.sectionMetrics.count != numberOfSections) {
+        NSMutableArray *sectionMetrics = [NSMutableArray arrayWithCapacity:numberOfSections];
+        for (NSUInteger localSection = 0; localSection < numberOfSections; ++localSection)
+            [sectionMetrics addObject:[self snapshotMetricsForSectionAtIndex:(NSInteger)(globalSectionOffset + localSection)]];
+
+        snapshot = [[AAPLComposedSnapshotMetrics alloc] init];
+        snapshot.dataSourceVersion = dataSourceVersion;
+        snapshot.enclosingVersion = enclosingVersion;
+        snapshot.globalSectionOffset = globalSectionOffset;
+        snapshot.sectionMetrics = sectionMetrics;
+        [_dataSourceToSnapshotMetrics setObject:snapshot forKey:dataSource];
+    }
+
+    return snapshot.sectionMetrics[(NSUInteger)sectionIndex - globalSectionOffset];
+}
+
+- (NSUInteger)newestMetricsVersion
+{
+    _enclosingMetricsVersion = [super newestMetricsVersion];
+    NSUInteger version = MAX(_enclosingMetricsVersion, _mappingsVersion);
+    for (AAPLComposedMapping *mapping in _mappings)
+        version = MAX(version, mapping.dataSource.metricsVersion);
+    return version;
+}
+
 - (void)registerReusableViewsWithCollectionView:(UICollectionView *)collectionView
 {
     [super registerReusableViewsWithCollectionView:collectionView];
@@ -185,6 +290,77 @@
     return [dataSource collectionView:(id)wrapper sizeFittingSize:size forItemAtIndexPath:localIndexPath];
 }
 
+- (AAPLItemSizeBlock)collectionView:(UICollectionView *)collectionView sizeBlockForItemsInSection:(NSInteger)section
+{
+    AAPLComposedMapping *mapping = [self mappingForGlobalSection:section];
+	AAPLComposedCollectionView *wrapper = [[AAPLComposedCollectionView alloc] initWithView:collectionView mapping:mapping];
+    AAPLDataSource *dataSource = mapping.dataSource;
+    NSInteger localSection = [mapping localSectionForGlobalSection:(NSUInteger)section];
+
+    // Only sections are mapped, so the item indexes passed to the block don't need translating
+    return [dataSource collectionView:(id)wrapper sizeBlockForItemsInSection:localSection];
+}
+
+- (id<NSCopying>)collectionView:(UICollectionView *)collectionView measurementIdentifierForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    AAPLComposedMapping *mapping = [self mappingForGlobalSection:indexPath.section];
+	AAPLComposedCollectionView *wrapper = [[AAPLComposedCollectionView alloc] initWithView:collectionView mapping:mapping];
+    AAPLDataSource *dataSource = mapping.dataSource;
+    NSIndexPath *localIndexPath = [mapping localIndexPathForGlobalIndexPath:indexPath];
+
+    return [dataSource collectionView:(id)wrapper measurementIdentifierForItemAtIndexPath:localIndexPath];
+}
+
+- (NSUInteger)collectionView:(UICollectionView *)collectionView measurementVersionForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    AAPLComposedMapping *mapping = [self mappingForGlobalSection:indexPath.section];
+	AAPLComposedCollectionView *wrapper = [[AAPLComposedCollectionView alloc] initWithView:collectionView mapping:mapping];
+    AAPLDataSource *dataSource = mapping.dataSource;
+    NSIndexPath *localIndexPath = [mapping localIndexPathForGlobalIndexPath:indexPath];
+
+    return [dataSource collectionView:(id)wrapper measurementVersionForItemAtIndexPath:localIndexPath];
+}
+
+/// Call the block once for each child data source with items among the index paths, with the local index paths of those items in their original order
+- (void)enumerateDataSourcesForIndexPaths:(NSArray *)indexPaths collectionView:(UICollectionView *)collectionView usingBlock:(void(^)(AAPLDataSource *dataSource, UICollectionView *wrapper, NSArray *localIndexPaths))block
+{
+    NSMutableArray *mappings = [NSMutableArray array];
+    NSMapTable *mappingToLocalIndexPaths = [NSMapTable strongToStrongObjectsMapTable];
+
+    for (NSIndexPath *indexPath in indexPaths) {
+        AAPLComposedMapping *mapping = [self mappingForGlobalSection:indexPath.section];
+        if (!mapping)
+            continue;
+
+        NSMutableArray *localIndexPaths = [mappingToLocalIndexPaths objectForKey:mapping];
+        if (!localIndexPaths) {
+            localIndexPaths = [NSMutableArray array];
+            [mappingToLocalIndexPaths setObject:localIndexPaths forKey:mapping];
+            [mappings addObject:mapping];
+        }
+        [localIndexPaths addObject:[mapping localIndexPathForGlobalIndexPath:indexPath]];
+    }
+
+    for (AAPLComposedMapping *mapping in mappings) {
+        AAPLComposedCollectionView *wrapper = [[AAPLComposedCollectionView alloc] initWithView:collectionView mapping:mapping];
+        block(mapping.dataSource, (UICollectionView *)wrapper, [mappingToLocalIndexPaths objectForKey:mapping]);
+    }
+}
+
+- (void)collectionView:(UICollectionView *)collectionView prefetchItemsAtIndexPaths:(NSArray *)indexPaths
+{
+    [self enumerateDataSourcesForIndexPaths:indexPaths collectionView:collectionView usingBlock:^(AAPLDataSource *dataSource, UICollectionView *wrapper, NSArray *localIndexPaths) {
+        [dataSource collectionView:wrapper prefetchItemsAtIndexPaths:localIndexPaths];
+    }];
+}
+
+- (void)collectionView:(UICollectionView *)collectionView cancelPrefetchingForItemsAtIndexPaths:(NSArray *)indexPaths
+{
+    [self enumerateDataSourcesForIndexPaths:indexPaths collectionView:collectionView usingBlock:^(AAPLDataSource *dataSource, UICollectionView *wrapper, NSArray *localIndexPaths) {
+        [dataSource collectionView:wrapper cancelPrefetchingForItemsAtIndexPaths:localIndexPaths];
+    }];
+}
+
 #pragma mark - AAPLContentLoading
 
 - (void)updateLoadingState
@@ -244,10 +420,25 @@
 
 - (void)loadContent
 {
+    // Each child cancels its own superseded load
     for (AAPLDataSource *dataSource in self.dataSources)
         [dataSource loadContent];
 }
 
+- (void)cancelLoading
+{
+    [super cancelLoading];
+    for (AAPLDataSource *dataSource in self.dataSources)
+        [dataSource cancelLoading];
+}
+
+- (void)setLoadingPriority:(AAPLLoadingPriority)loadingPriority
+{
+    [super setLoadingPriority:loadingPriority];
+    for (AAPLDataSource *dataSource in self.dataSources)
+        dataSource.loadingPriority = loadingPriority;
+}
+
 - (void)resetContent
 {
     _aggregateLoadingState = nil;
@@ -266,8 +457,6 @@
 
 - (NSInteger)collectionView:(UICollectionView *)collectionView numberOfItemsInSection:(NSInteger)section
 {
-    [self updateMappings];
-
     AAPLComposedMapping *mapping = [self mappingForGlobalSection:section];
 	AAPLComposedCollectionView *wrapper = [[AAPLComposedCollectionView alloc] initWithView:collectionView mapping:mapping];
     NSInteger localSection = [mapping localSectionForGlobalSection:(NSUInteger)section];
@@ -332,7 +521,7 @@
 {
     AAPLComposedMapping *mapping = [self mappingForDataSource:dataSource];
 
-    [self updateMappings];
+    [self updateMappingForDataSource:dataSource];
 
     NSMutableIndexSet *globalSections = [NSMutableIndexSet indexSet];
     [sections enumerateIndexesUsingBlock:^(NSUInteger localSectionIndex, BOOL *stop) {
@@ -351,7 +540,7 @@
         [globalSections addIndex:[mapping globalSectionForLocalSection:localSectionIndex]];
     }];
 
-    [self updateMappings];
+    [self updateMappingForDataSource:dataSource];
 
     [self notifySectionsRemoved:globalSections direction:direction];
 }
@@ -366,7 +555,7 @@
     }];
 
     [self notifySectionsRefreshed:globalSections];
-    [self updateMappings];
+    [self updateMappingForDataSource:dataSource];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource didMoveSection:(NSInteger)section toSection:(NSInteger)newSection direction:(AAPLDataSourceSectionOperationDirection)direction
@@ -376,13 +565,14 @@
     NSInteger globalSection = [mapping globalSectionForLocalSection:(NSUInteger)section];
     NSInteger globalNewSection = [mapping globalSectionForLocalSection:(NSUInteger)newSection];
 
-    [self updateMappings];
+    [self updateMappingForDataSource:dataSource];
 
     [self notifySectionMovedFrom:globalSection to:globalNewSection direction:direction];
 }
 
 - (void)dataSourceDidReloadData:(AAPLDataSource *)dataSource
 {
+    [self updateMappings];
     [self notifyDidReloadData];
 }
 
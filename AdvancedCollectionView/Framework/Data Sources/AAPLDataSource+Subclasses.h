@@ -37,6 +37,15 @@
 
 - (AAPLLayoutSectionMetrics *)snapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex;
 
+/// The same metrics as -snapshotMetricsForSectionAtIndex:, reused until the metricsVersion changes. The result is shared and must not be modified.
+- (AAPLLayoutSectionMetrics *)cachedSnapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex;
+
+/// The newest version of anything the snapshot metrics are built from. Composed data sources include the versions of their children. Only recomputed after some metrics have changed.
+@property (nonatomic, readonly) NSUInteger metricsVersion;
+
+/// Gathers the versions behind metricsVersion. Subclasses that build their snapshot metrics from other objects override this and call super.
+- (NSUInteger)newestMetricsVersion;
+
 - (void)executePendingUpdates;
 
 - (NSIndexPath *)localIndexPathForGlobalIndexPath:(NSIndexPath *)globalIndexPath;
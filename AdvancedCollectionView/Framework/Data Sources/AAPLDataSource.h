@@ -15,6 +15,9 @@ typedef enum {
 	AAPLDataSourceSectionOperationDirectionLeft
 } AAPLDataSourceSectionOperationDirection;
 
+/// Computes the size of the item at itemIndex that fits within fittingSize. See -collectionView:sizeBlockForItemsInSection:.
+typedef CGSize (^AAPLItemSizeBlock)(NSInteger itemIndex, CGSize fittingSize);
+
 @interface AAPLDataSource : NSObject <UICollectionViewDataSource, AAPLContentLoading>
 
 /// The title of this data source. This value is used to populate section headers.
@@ -45,7 +48,7 @@ typedef enum {
 /// Replace a header specified by its key with a new header with the same key.
 - (void)replaceHeaderForKey:(NSString *)key withHeader:(AAPLLayoutSupplementaryMetrics *)header __unused;
 
-/// Compute a flattened snapshot of the layout metrics associated with this and any child data sources.
+/// Compute a flattened snapshot of the layout metrics associated with this and any child data sources. The snapshot is reused until the metrics change, so it must not be modified.
 - (NSDictionary *)snapshotMetrics;
 
 #pragma mark - Placeholders
@@ -67,10 +70,31 @@ typedef enum {
 /// Measure variable height cells. The goal here is to do the minimal necessary configuration to get the correct size information.
 - (CGSize)collectionView:(UICollectionView *)collectionView sizeFittingSize:(CGSize)size forItemAtIndexPath:(NSIndexPath *)indexPath;
 
+/// Return a block that computes the size of items in the section from model data alone, or nil to measure each item with -collectionView:sizeFittingSize:forItemAtIndexPath:. The layout calls the block for batches of items concurrently on background queues, so it must not touch views or any state that may change while the layout is measuring. Capture what the block needs when it is created. The default returns nil.
+- (AAPLItemSizeBlock)collectionView:(UICollectionView *)collectionView sizeBlockForItemsInSection:(NSInteger)section;
+
+/// A stable identifier for the item used to cache its measured size. The layout reuses a cached size for as long as the identifier, the width and the measurement version are unchanged, even across reloads. The layout shares one cache between all the data sources it shows, so the identifier must not collide with those of other data sources. The default returns nil, which means the item is measured every time.
+- (id<NSCopying>)collectionView:(UICollectionView *)collectionView measurementIdentifierForItemAtIndexPath:(NSIndexPath *)indexPath;
+
+/// The version of the item's content as far as its size is concerned. Return a different value whenever the content changes in a way that could change the item's size. A hash of the content isn't enough, because two different contents may have the same hash. The default returns 0.
+- (NSUInteger)collectionView:(UICollectionView *)collectionView measurementVersionForItemAtIndexPath:(NSIndexPath *)indexPath;
+
+/// The layout calls this with items that are about to scroll into view, nearest first, sized from the scrolling velocity. Start loading whatever their cells will need, so it's ready when they appear. The default does nothing.
+- (void)collectionView:(UICollectionView *)collectionView prefetchItemsAtIndexPaths:(NSArray *)indexPaths;
+
+/// The layout calls this with items passed to -collectionView:prefetchItemsAtIndexPaths: that are no longer about to scroll into view, for instance because scrolling changed direction. Cancel loading for them that hasn't finished. Items that scroll into view aren't cancelled. The default does nothing.
+- (void)collectionView:(UICollectionView *)collectionView cancelPrefetchingForItemsAtIndexPaths:(NSArray *)indexPaths;
+
 /// Register reusable views needed by this data source
 - (void)registerReusableViewsWithCollectionView:(UICollectionView *)collectionView NS_REQUIRES_SUPER;
 
 /// Signal that the data source SHOULD reload its content
 - (void)setNeedsLoadContent;
 
+/// The priority given to loads started by -loadContentWithBlock:. Composed data sources pass this along to their children. Default is AAPLLoadingPriorityDefault.
+@property (nonatomic) AAPLLoadingPriority loadingPriority;
+
+/// Cancel the load in progress, if any. Composed data sources cancel the loads of their children as well.
+- (void)cancelLoading;
+
 @end
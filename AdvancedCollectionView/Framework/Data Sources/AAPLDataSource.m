@@ -6,6 +6,7 @@
 #import "AAPLDataSource+Subclasses.h"
 #import "AAPLCollectionViewGridLayout.h"
 #import "AAPLPlaceholderView.h"
+#import "AAPLChangeJournal.h"
 #import <libkern/OSAtomic.h>
 
 static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingCompleteContext;
@@ -18,7 +19,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 @property (nonatomic, strong) NSMutableDictionary *headersByKey;
 @property (nonatomic, strong) AAPLStateMachine *stateMachine;
 @property (nonatomic, strong) AAPLCollectionPlaceholderView *placeholderView;
-@property (nonatomic, copy) dispatch_block_t pendingUpdateBlock;
+@property (nonatomic, strong) AAPLChangeJournal *pendingChanges;
 @property (nonatomic) BOOL loadingComplete;
 @property (nonatomic, weak) AAPLLoading *loadingInstance;
 @property (nonatomic, copy) dispatch_block_t loadingCompleteBlock;
@@ -29,9 +30,21 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 	OSSpinLock _loadingCompleteLock;
 	int32_t _loadingCompleteObserverToken;
 	
+    /// Bumped when section metrics or headers are added, replaced or removed, or when the placeholder or root data source state changes
+    NSUInteger _metricsVersion;
+    /// The newest version of this data source's metrics, valid while AAPLLayoutMetricsCurrentVersion() is _metricsValidatedVersion
+    NSUInteger _combinedMetricsVersion;
+    NSUInteger _metricsValidatedVersion;
+    NSMutableDictionary *_snapshotMetricsCache;
+    NSUInteger _snapshotMetricsCacheVersion;
+    /// The last result of -snapshotMetrics and the cached section metrics it was made from
+    NSDictionary *_snapshotMetrics;
+    NSDictionary *_snapshotMetricsSources;
+    NSUInteger _snapshotMetricsVersion;
 }
 
 @synthesize loadingError = _loadingError;
+@synthesize defaultMetrics = _defaultMetrics;
 
 - (instancetype)init
 {
@@ -41,10 +54,21 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 	
 	_loadingCompleteLock = OS_SPINLOCK_INIT;
     _defaultMetrics = [[AAPLLayoutSectionMetrics alloc] init];
+    _snapshotMetricsCacheVersion = NSNotFound;
+    _snapshotMetricsVersion = NSNotFound;
+    _metricsValidatedVersion = NSNotFound;
+    _loadingPriority = AAPLLoadingPriorityDefault;
 	
     return self;
 }
 
+- (void)setDelegate:(id<AAPLDataSourceDelegate>)delegate
+{
+    _delegate = delegate;
+    // Only the root data source lays out the global section
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
 - (BOOL)isRootDataSource
 {
     id delegate = self.delegate;
@@ -110,6 +134,29 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
     return size;
 }
 
+- (AAPLItemSizeBlock)collectionView:(UICollectionView *)collectionView sizeBlockForItemsInSection:(NSInteger)section
+{
+    return nil;
+}
+
+- (id<NSCopying>)collectionView:(UICollectionView *)collectionView measurementIdentifierForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    return nil;
+}
+
+- (NSUInteger)collectionView:(UICollectionView *)collectionView measurementVersionForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+    return 0;
+}
+
+- (void)collectionView:(UICollectionView *)collectionView prefetchItemsAtIndexPaths:(NSArray *)indexPaths
+{
+}
+
+- (void)collectionView:(UICollectionView *)collectionView cancelPrefetchingForItemsAtIndexPaths:(NSArray *)indexPaths
+{
+}
+
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
 {
 	if (context == AAPLDataSourceLoadingCompleteContext) {
@@ -175,8 +222,9 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
     self.loadingState = state;
 
     if (self.shouldDisplayPlaceholder) {
+        // Any changes the update makes are recorded until the placeholder goes away
         if (update)
-            [self enqueuePendingUpdateBlock:update];
+            update();
     }
     else {
         [self notifyBatchUpdate:^{
@@ -200,7 +248,13 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     _stateMachine = nil;
     // Content has been reset, if we're loading something, chances are we don't need it.
-    self.loadingInstance.current = NO;
+    [self.loadingInstance cancel];
+}
+
+- (void)cancelLoading
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(loadContent) object:nil];
+    [self.loadingInstance cancel];
 }
 
 - (void)loadContent
@@ -224,9 +278,10 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
                 update(me);
         }];
     }];
+    loading.priority = self.loadingPriority;
 
-    // Tell previous loading instance it's no longer current and remember this loading instance
-    self.loadingInstance.current = NO;
+    // Cancel the previous loading instance, it's been superseded, and remember this loading instance
+    [self.loadingInstance cancel];
     self.loadingInstance = loading;
     
     // Call the provided block to actually do the load
@@ -262,6 +317,9 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 
 - (void)stateDidChangeFrom:(NSString *)oldState to:(NSString *)newState
 {
+    // The loading state decides whether the placeholder is part of the snapshot metrics
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+
 	if (![newState isEqualToString:AAPLLoadStateInitial] && ![newState isEqualToString:AAPLLoadStateRefreshingContent]) {
 		[self updatePlaceholder:self.placeholderView notifyVisibility:YES];
 	}
@@ -280,6 +338,12 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
     return _defaultMetrics;
 }
 
+- (void)setDefaultMetrics:(AAPLLayoutSectionMetrics *)defaultMetrics
+{
+    _defaultMetrics = defaultMetrics;
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
 - (AAPLLayoutSectionMetrics *)metricsForSectionAtIndex:(NSInteger)sectionIndex
 {
     if (!_sectionMetrics)
@@ -294,6 +358,49 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
         _sectionMetrics = [NSMutableDictionary dictionary];
 
     _sectionMetrics[@(sectionIndex)] = metrics;
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
+- (NSUInteger)metricsVersion
+{
+    // Metrics are changed in place, so their versions only need gathering again once some metrics somewhere have changed
+    NSUInteger currentVersion = AAPLLayoutMetricsCurrentVersion();
+    if (currentVersion == _metricsValidatedVersion)
+        return _combinedMetricsVersion;
+
+    _combinedMetricsVersion = [self newestMetricsVersion];
+    _metricsValidatedVersion = currentVersion;
+    return _combinedMetricsVersion;
+}
+
+- (NSUInteger)newestMetricsVersion
+{
+    NSUInteger version = MAX(_metricsVersion, _defaultMetrics.version);
+    for (AAPLLayoutSectionMetrics *metrics in [_sectionMetrics objectEnumerator])
+        version = MAX(version, metrics.version);
+    for (AAPLLayoutSupplementaryMetrics *header in _headers)
+        version = MAX(version, header.version);
+    return version;
+}
+
+- (AAPLLayoutSectionMetrics *)cachedSnapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex
+{
+    NSUInteger metricsVersion = self.metricsVersion;
+    if (metricsVersion != _snapshotMetricsCacheVersion) {
+        [_snapshotMetricsCache removeAllObjects];
+        _snapshotMetricsCacheVersion = metricsVersion;
+    }
+
+    if (!_snapshotMetricsCache)
+        _snapshotMetricsCache = [NSMutableDictionary dictionary];
+
+    NSNumber *key = @(sectionIndex);
+    AAPLLayoutSectionMetrics *metrics = _snapshotMetricsCache[key];
+    if (!metrics) {
+        metrics = [self snapshotMetricsForSectionAtIndex:sectionIndex];
+        _snapshotMetricsCache[key] = metrics;
+    }
+    return metrics;
 }
 
 - (AAPLLayoutSectionMetrics *)snapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex
@@ -328,25 +435,42 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 
 - (NSDictionary *)snapshotMetrics
 {
+    NSUInteger metricsVersion = self.metricsVersion;
     NSUInteger numberOfSections = self.numberOfSections;
-    NSMutableDictionary *metrics = [NSMutableDictionary dictionary];
+
+    if (_snapshotMetrics && metricsVersion == _snapshotMetricsVersion && numberOfSections + 1 == _snapshotMetrics.count)
+        return _snapshotMetrics;
+
+    NSMutableDictionary *metrics = [NSMutableDictionary dictionaryWithCapacity:numberOfSections + 1];
+    NSMutableDictionary *sources = [NSMutableDictionary dictionaryWithCapacity:numberOfSections + 1];
 
     UIColor *defaultBackground = [UIColor whiteColor];
 
-    AAPLLayoutSectionMetrics *globalMetrics = [self snapshotMetricsForSectionAtIndex:AAPLGlobalSection];
-    if (!globalMetrics.backgroundColor)
-        globalMetrics.backgroundColor = defaultBackground;
-    metrics[@(AAPLGlobalSection)] = globalMetrics;
+    // The global section comes first
+    for (NSUInteger sectionNumber = 0; sectionNumber <= numberOfSections; ++sectionNumber) {
+        NSUInteger sectionIndex = sectionNumber ? sectionNumber - 1 : AAPLGlobalSection;
+        NSNumber *key = @(sectionIndex);
 
-    for (NSUInteger sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex) {
-        AAPLLayoutSectionMetrics *sectionMetrics = [self snapshotMetricsForSectionAtIndex:sectionIndex];
-        // assign default colors
-        if (!sectionMetrics.backgroundColor)
+        AAPLLayoutSectionMetrics *source = [self cachedSnapshotMetricsForSectionAtIndex:(NSInteger)sectionIndex];
+        AAPLLayoutSectionMetrics *sectionMetrics = source;
+
+        // Sections that still have the same cached metrics keep what they had in the last snapshot
+        if (source == _snapshotMetricsSources[key])
+            sectionMetrics = _snapshotMetrics[key];
+        else if (!source.backgroundColor) {
+            // assign default colors to a copy, because the cached metrics are shared
+            sectionMetrics = [source copy];
             sectionMetrics.backgroundColor = defaultBackground;
-        metrics[@(sectionIndex)] = sectionMetrics;
+        }
+
+        metrics[key] = sectionMetrics;
+        sources[key] = source;
     }
 
-    return metrics;
+    _snapshotMetrics = [metrics copy];
+    _snapshotMetricsSources = [sources copy];
+    _snapshotMetricsVersion = metricsVersion;
+    return _snapshotMetrics;
 }
 
 - (AAPLLayoutSupplementaryMetrics *)headerForKey:(NSString *)key
@@ -366,6 +490,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 	AAPLLayoutSupplementaryMetrics *header = [[AAPLLayoutSupplementaryMetrics alloc] initWithSupplementaryViewKind:UICollectionElementKindSectionHeader];
     _headersByKey[key] = header;
     [_headers addObject:header];
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
     return header;
 }
 
@@ -382,6 +507,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
     NSUInteger headerIndex = [_headers indexOfObject:oldHeader];
     _headersByKey[key] = header;
     _headers[headerIndex] = header;
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)removeHeaderForKey:(NSString *)key {
@@ -395,6 +521,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 
     [_headers removeObject:oldHeader];
     [_headersByKey removeObjectForKey:key];
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
 }
 
 #pragma mark - Placeholder
@@ -414,6 +541,31 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
     return dataSource.obscuredByPlaceholder;
 }
 
+- (void)setNoContentTitle:(NSString *)noContentTitle
+{
+    _noContentTitle = [noContentTitle copy];
+    // Whether there is a placeholder to show depends on its title and message
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setNoContentMessage:(NSString *)noContentMessage
+{
+    _noContentMessage = [noContentMessage copy];
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setErrorTitle:(NSString *)errorTitle
+{
+    _errorTitle = [errorTitle copy];
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setErrorMessage:(NSString *)errorMessage
+{
+    _errorMessage = [errorMessage copy];
+    _metricsVersion = AAPLLayoutMetricsNextVersion();
+}
+
 - (BOOL)shouldDisplayPlaceholder
 {
     NSString *loadingState = self.loadingState;
@@ -470,37 +622,45 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 - (void)executePendingUpdates
 {
     AAPL_ASSERT_MAIN_THREAD;
-    dispatch_block_t block = _pendingUpdateBlock;
-    _pendingUpdateBlock = nil;
-    if (block)
-        block();
-}
 
-- (void)enqueuePendingUpdateBlock:(dispatch_block_t)block
-{
-    dispatch_block_t update;
+    // The changes are merged in batch terms, so they can't be recorded again one by one
+    if (self.shouldDisplayPlaceholder)
+        return;
 
-    if (_pendingUpdateBlock) {
-        dispatch_block_t oldPendingUpdate = _pendingUpdateBlock;
-        update = ^{
-            oldPendingUpdate();
-            block();
-        };
-    }
-    else
-        update = block;
+    AAPLChangeJournal *pendingChanges = _pendingChanges;
+    _pendingChanges = nil;
+    if (!pendingChanges.hasChanges)
+        return;
+
+    NSArray *removedIndexPaths = pendingChanges.removedIndexPaths;
+    if (removedIndexPaths.count)
+        [self notifyItemsRemovedAtIndexPaths:removedIndexPaths];
 
-    self.pendingUpdateBlock = update;
+    NSArray *insertedIndexPaths = pendingChanges.insertedIndexPaths;
+    if (insertedIndexPaths.count)
+        [self notifyItemsInsertedAtIndexPaths:insertedIndexPaths];
+
+    NSArray *refreshedIndexPaths = pendingChanges.refreshedIndexPaths;
+    if (refreshedIndexPaths.count)
+        [self notifyItemsRefreshedAtIndexPaths:refreshedIndexPaths];
+
+    [pendingChanges enumerateMovesUsingBlock:^(NSIndexPath *fromIndexPath, NSIndexPath *toIndexPath, BOOL *stop) {
+        [self notifyItemMovedFromIndexPath:fromIndexPath toIndexPaths:toIndexPath];
+    }];
+}
+
+- (AAPLChangeJournal *)pendingChanges
+{
+    if (!_pendingChanges)
+        _pendingChanges = [[AAPLChangeJournal alloc] init];
+    return _pendingChanges;
 }
 
 - (void)notifyItemsInsertedAtIndexPaths:(NSArray *)insertedIndexPaths
 {
     AAPL_ASSERT_MAIN_THREAD;
     if (self.shouldDisplayPlaceholder) {
-        __weak typeof(&*self) weakself = self;
-        [self enqueuePendingUpdateBlock:^{
-            [weakself notifyItemsInsertedAtIndexPaths:insertedIndexPaths];
-        }];
+        [self.pendingChanges insertItemsAtIndexPaths:insertedIndexPaths];
         return;
     }
 
@@ -514,10 +674,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
     if (self.shouldDisplayPlaceholder) {
-        __weak typeof(&*self) weakself = self;
-        [self enqueuePendingUpdateBlock:^{
-            [weakself notifyItemsRemovedAtIndexPaths:removedIndexPaths];
-        }];
+        [self.pendingChanges removeItemsAtIndexPaths:removedIndexPaths];
         return;
     }
 
@@ -531,10 +688,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
     if (self.shouldDisplayPlaceholder) {
-        __weak typeof(&*self) weakself = self;
-        [self enqueuePendingUpdateBlock:^{
-            [weakself notifyItemsRefreshedAtIndexPaths:refreshedIndexPaths];
-        }];
+        [self.pendingChanges refreshItemsAtIndexPaths:refreshedIndexPaths];
         return;
     }
 
@@ -548,10 +702,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
     if (self.shouldDisplayPlaceholder) {
-        __weak typeof(&*self) weakself = self;
-        [self enqueuePendingUpdateBlock:^{
-            [weakself notifyItemMovedFromIndexPath:indexPath toIndexPaths:newIndexPath];
-        }];
+        [self.pendingChanges moveItemAtIndexPath:indexPath toIndexPath:newIndexPath];
         return;
     }
 
@@ -565,6 +716,9 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
 
+    // Sections are updated right away, but the pending changes need to follow them
+    [_pendingChanges insertSections:sections];
+
     id<AAPLDataSourceDelegate> delegate = self.delegate;
     if ([delegate respondsToSelector:@selector(dataSource:didInsertSections:direction:)]) {
         [delegate dataSource:self didInsertSections:sections direction:direction];
@@ -575,6 +729,8 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
 
+    [_pendingChanges removeSections:sections];
+
     id<AAPLDataSourceDelegate> delegate = self.delegate;
     if ([delegate respondsToSelector:@selector(dataSource:didRemoveSections:direction:)]) {
         [delegate dataSource:self didRemoveSections:sections direction:direction];
@@ -585,6 +741,9 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
 
+    // Refreshed sections show the current items, so the changes recorded for them must not be sent again
+    [_pendingChanges refreshSections:sections];
+
     id<AAPLDataSourceDelegate> delegate = self.delegate;
     if ([delegate respondsToSelector:@selector(dataSource:didRefreshSections:)]) {
         [delegate dataSource:self didRefreshSections:sections];
@@ -595,6 +754,8 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
 
+    [_pendingChanges moveSection:section toSection:newSection];
+
     id<AAPLDataSourceDelegate> delegate = self.delegate;
     if ([delegate respondsToSelector:@selector(dataSource:didMoveSection:toSection:direction:)]) {
         [delegate dataSource:self didMoveSection:section toSection:newSection direction:direction];
@@ -605,6 +766,8 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 {
     AAPL_ASSERT_MAIN_THREAD;
 
+    [_pendingChanges removeAllChanges];
+
     id<AAPLDataSourceDelegate> delegate = self.delegate;
     if ([delegate respondsToSelector:@selector(dataSourceDidReloadData:)]) {
         [delegate dataSourceDidReloadData:self];
@@ -682,7 +845,7 @@ static void *AAPLDataSourceLoadingCompleteContext = &AAPLDataSourceLoadingComple
 	    return nil;
     }
 
-    AAPLLayoutSectionMetrics *sectionMetrics = [self snapshotMetricsForSectionAtIndex:section];
+    AAPLLayoutSectionMetrics *sectionMetrics = [self cachedSnapshotMetricsForSectionAtIndex:section];
 	NSIndexSet *matching = [sectionMetrics.supplementaryViews indexesOfObjectsWithOptions:NSEnumerationConcurrent passingTest:^BOOL(AAPLLayoutSupplementaryMetrics *metrics, NSUInteger idx, BOOL *stop) {
 		return [metrics.supplementaryViewKind isEqual:kind];
 	}];
@@ -6,6 +6,7 @@
 #import <UIKit/UIKit.h>
 
 #import "AAPLCollectionViewGridLayoutAttributes.h"
+#import "AAPLLayoutMeasurementCache.h"
 
 extern NSUInteger const AAPLGlobalSection;
 
@@ -16,4 +17,10 @@ extern NSString * const AAPLCollectionElementKindPlaceholder;
 /// Recompute the layout for a specific item. This will remeasure the cell and then update the layout.
 - (void)invalidateLayoutForItemAtIndexPath:(NSIndexPath *)indexPath;
 
+/// When YES, the row separators of a section are drawn by one decoration view for each band of rows instead of one view per row, which cuts the views and attributes a list with separators needs. Long sections are split into bands of 64 rows so each view stays small. Default is NO.
+@property (nonatomic) BOOL drawsRowSeparatorsBySection;
+
+/// Heights of variable height items, kept for items whose data source provides a measurement identifier. The cache survives reloads of the data source.
+@property (nonatomic, readonly) AAPLLayoutMeasurementCache *measurementCache;
+
 @end
@@ -4,7 +4,10 @@
  */
 
 #import "AAPLCollectionViewGridLayout_Internal.h"
+#import "AAPLGridLayoutRowSeparatorsView.h"
 #import "AAPLGridLayoutSeparatorView.h"
+#import "AAPLLayoutElementTable.h"
+#import "AAPLLayoutIndex.h"
 #import "UICollectionReusableView+AAPLGridLayout.h"
 #import "UIView+AAPLAdditions.h"
 
@@ -12,10 +15,21 @@ NSUInteger const AAPLGlobalSection = NSUIntegerMax;
 
 NSString *const AAPLCollectionElementKindPlaceholder = @"AAPLCollectionElementKindPlaceholder";
 static NSString *const AAPLGridLayoutRowSeparatorKind = @"AAPLGridLayoutRowSeparatorKind";
+static NSString *const AAPLGridLayoutRowSeparatorBandKind = @"AAPLGridLayoutRowSeparatorBandKind";
 static NSString *const AAPLGridLayoutSectionSeparatorKind = @"AAPLGridLayoutSectionSeparatorKind";
 static NSString *const AAPLGridLayoutGlobalHeaderBackgroundKind = @"AAPLGridLayoutGlobalHeaderBackgroundKind";
 
 static const CGFloat AAPLGridLayoutMeasuringHeight = 1000;
+/// The number of items measured by each unit of work when a data source provides a size block
+static const NSUInteger AAPLGridLayoutMeasuringBatchSize = 64;
+
+/// The most rows whose separators are drawn by one view when row separators are drawn by section
+static const NSUInteger AAPLGridLayoutRowSeparatorBandSize = 64;
+
+/// How far past the visible rect to prefetch items, in screens
+static const CGFloat AAPLGridLayoutPrefetchScreens = 1;
+/// How far to scroll, in screens, before the prefetched items are updated
+static const CGFloat AAPLGridLayoutPrefetchGranularity = 0.25;
 
 static const NSInteger AAPLGridLayoutZIndexDefault = 1;
 static const NSInteger AAPLGridLayoutZIndexPlaceholder = 50;
@@ -33,6 +47,109 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 	return [indexPath indexAtPosition:0];
 }
 
+/// The IDs of the element kinds the layout creates itself. They are interned in this order when the layout is created, other kinds are interned as they are seen.
+enum {
+    AAPLGridLayoutElementKindHeader,
+    AAPLGridLayoutElementKindFooter,
+    AAPLGridLayoutElementKindPlaceholder,
+    AAPLGridLayoutElementKindSectionSeparator,
+    AAPLGridLayoutElementKindGlobalHeaderBackground,
+};
+
+/// The number of bands holding the separators above every item but the first
+static inline NSUInteger AAPLGridLayoutNumberOfRowSeparatorBands(NSUInteger numberOfItems)
+{
+    return (numberOfItems > 1 ? (numberOfItems + AAPLGridLayoutRowSeparatorBandSize - 1) / AAPLGridLayoutRowSeparatorBandSize : 0);
+}
+
+/// Round a position to the nearest pixel
+static inline CGFloat AAPLGridLayoutRoundToPixel(CGFloat value, CGFloat hairline)
+{
+    return round(value / hairline) * hairline;
+}
+
+/// Element keys keep the shape of the index path: global elements have a single index, which is stored as the section with no item.
+static inline AAPLLayoutElementKey AAPLGridLayoutElementKeyMake(uint32_t kind, NSIndexPath *indexPath)
+{
+    NSUInteger itemIndex;
+    NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, NO);
+    return AAPLLayoutElementKeyMake(kind, sectionIndex, itemIndex);
+}
+
+static inline NSIndexPath *AAPLGridLayoutIndexPathForElementKey(AAPLLayoutElementKey key)
+{
+    if ((size_t)NSNotFound == key.item)
+        return [NSIndexPath indexPathWithIndex:key.section];
+    return [NSIndexPath indexPathForItem:key.item inSection:key.section];
+}
+
+static inline AAPLCollectionViewGridLayoutAttributes *AAPLGridLayoutGetElementAttributes(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key)
+{
+    return (__bridge AAPLCollectionViewGridLayoutAttributes *)AAPLLayoutElementTableGetValue(table, key);
+}
+
+static inline void AAPLGridLayoutSetElementAttributes(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key, AAPLCollectionViewGridLayoutAttributes *attributes)
+{
+    AAPLLayoutElementTableSetValue(table, key, (__bridge const void *)attributes);
+}
+
+static const AAPLLayoutElementTableValueCallBacks AAPLGridLayoutElementAttributesCallBacks = { CFRetain, CFRelease };
+
+typedef struct {
+    /// The table the elements are looked up in
+    AAPLLayoutElementTableRef otherAttributes;
+    __unsafe_unretained NSArray *elementKinds;
+    __unsafe_unretained NSMutableDictionary *result;
+} AAPLGridLayoutMissingElementQuery;
+
+/// Collects the index paths, by kind, of the elements that aren't in the other table
+static bool AAPLGridLayoutCollectMissingElements(AAPLLayoutElementKey key, const void *value, void *context)
+{
+    AAPLGridLayoutMissingElementQuery *query = context;
+    // If the other layout has a similar decoration view, skip it.
+    if (AAPLLayoutElementTableGetValue(query->otherAttributes, key))
+        return true;
+
+    NSString *kind = query->elementKinds[key.kind];
+    NSMutableArray *indexPaths = query->result[kind];
+    if (!indexPaths) {
+        indexPaths = [NSMutableArray array];
+        query->result[kind] = indexPaths;
+    }
+    [indexPaths addObject:AAPLGridLayoutIndexPathForElementKey(key)];
+    return true;
+}
+
+/// How far down a section reaches: from its top to the bottom of its lowest element, which may lie below its frame
+typedef struct {
+    CGFloat minY;
+    CGFloat maxY;
+} AAPLGridLayoutSectionExtent;
+
+static inline AAPLGridLayoutSectionExtent AAPLGridLayoutSectionExtentMake(AAPLGridLayoutSectionInfo *section)
+{
+    CGRect frame = section.frame;
+    AAPLGridLayoutSectionExtent extent = { CGRectGetMinY(frame), MAX(CGRectGetMaxY(frame), section.contentMaxY) };
+    return extent;
+}
+
+typedef struct {
+    __unsafe_unretained NSArray *layoutAttributes;
+    __unsafe_unretained NSMutableArray *result;
+    CGRect rect;
+    /// Where the attributes of the section being queried start
+    NSUInteger location;
+} AAPLGridLayoutRectQuery;
+
+static bool AAPLGridLayoutCollectAttributesInRect(size_t position, void *context)
+{
+    AAPLGridLayoutRectQuery *query = context;
+    AAPLCollectionViewGridLayoutAttributes *attributes = query->layoutAttributes[query->location + position];
+    if (CGRectIntersectsRect(attributes.frame, query->rect))
+        [query->result addObject:attributes];
+    return true;
+}
+
 @interface AAPLCollectionViewGridLayout ()
 
 @property (nonatomic) CGSize layoutSize;
@@ -41,14 +158,20 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 @property (nonatomic) NSInteger totalNumberOfItems;
 @property (nonatomic, strong) NSMutableArray *layoutAttributes;
-@property (nonatomic, strong) NSMutableArray *pinnableAttributes;
+/// The global section's attributes, which move with the content offset. These are kept out of the section indexes and checked individually.
+@property (nonatomic, strong) NSMutableArray *floatingAttributes;
 @property (nonatomic, strong) AAPLGridLayoutInfo *layoutInfo;
-@property (nonatomic, strong) NSMutableDictionary *indexPathKindToSupplementaryAttributes;
-@property (nonatomic, strong) NSMutableDictionary *oldIndexPathKindToSupplementaryAttributes;
-@property (nonatomic, strong) NSMutableDictionary *indexPathKindToDecorationAttributes;
-@property (nonatomic, strong) NSMutableDictionary *oldIndexPathKindToDecorationAttributes;
+/// The layout info from before the data last changed, used to create attributes for update animations
+@property (nonatomic, strong) AAPLGridLayoutInfo *oldLayoutInfo;
+/// Item attributes are created on demand and kept until the next time the layout is built
 @property (nonatomic, strong) NSMutableDictionary *indexPathToItemAttributes;
 @property (nonatomic, strong) NSMutableDictionary *oldIndexPathToItemAttributes;
+/// Row separator attributes are created on demand along with the items. They're bands of separators when drawsRowSeparatorsBySection is set.
+@property (nonatomic, strong) NSMutableDictionary *indexPathToRowSeparatorAttributes;
+@property (nonatomic, strong) NSMutableDictionary *oldIndexPathToRowSeparatorAttributes;
+
+/// The sections that need to be recomputed when the layout metrics are only partially valid
+@property (nonatomic, strong) NSMutableIndexSet *invalidatedSections;
 
 /// A dictionary mapping the section index to the AAPLDataSourceSectionOperationDirection value
 @property (nonatomic, strong) NSMutableDictionary *updateSectionDirections;
@@ -61,6 +184,35 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 @end
 
 @implementation AAPLCollectionViewGridLayout  {
+    /// Supplementary and decoration attributes by element key, for the current and the previous layout
+    AAPLLayoutElementTableRef _supplementaryAttributes;
+    AAPLLayoutElementTableRef _oldSupplementaryAttributes;
+    AAPLLayoutElementTableRef _decorationAttributes;
+    AAPLLayoutElementTableRef _oldDecorationAttributes;
+    /// Element kinds indexed by their kind ID
+    NSMutableArray *_elementKinds;
+    /// Index paths of the decoration views only the new layout has, and of those only the previous layout has, by kind. Only set while updates are animating.
+    NSMutableDictionary *_insertedDecorationIndexPaths;
+    NSMutableDictionary *_deletedDecorationIndexPaths;
+    /// The pinning offset used the last time the special attributes were filtered
+    CGFloat _pinnedY;
+    /// The bounds origin used the last time the special attributes were filtered
+    CGFloat _pinnedBoundsY;
+    /// The section whose pinnable headers were pinned the last time the special attributes were filtered. Only its headers and those of the global section are ever out of their unpinned positions.
+    AAPLGridLayoutSectionInfo *_pinnedSection;
+    /// The vertical extents of the sections in order, which every search for the sections at a position uses. Sections are stacked, so these are sorted as well. Partial builds keep them up to date.
+    AAPLGridLayoutSectionExtent *_sectionExtents;
+    NSUInteger _numberOfSectionExtents;
+    /// Items the data source was asked to prefetch that haven't been cancelled
+    NSMutableSet *_prefetchedIndexPaths;
+    /// Items with estimated heights that came close to the visible bounds. They are measured by -invalidateEstimatedItems once the rect query that found them has returned.
+    NSMutableSet *_estimatedIndexPathsToMeasure;
+    /// The bounds origin used the last time the prefetched items were updated
+    CGFloat _prefetchBoundsY;
+    /// 1 when scrolling down, -1 when scrolling up
+    CGFloat _prefetchDirection;
+    /// Where the current fling will come to rest, or NAN
+    CGFloat _prefetchTargetY;
     struct {
         /// the data source has the snapshot metrics method
 		BOOL dataSourceHasSnapshotMetrics;
@@ -68,8 +220,18 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 		BOOL layoutDataIsValid;
         /// layout metrics will only be valid if layout data is also valid
 		BOOL layoutMetricsAreValid;
+        /// when the layout metrics are invalid, only the invalidatedSections need to be recomputed
+		BOOL layoutMetricsArePartiallyValid;
         /// contentOffset of collection view is valid
 		BOOL useCollectionViewContentOffset;
+        /// the pinned attributes reflect _pinnedY and _pinnedBoundsY
+        BOOL pinnedAttributesAreValid;
+        /// at least one section uses estimated row heights
+        BOOL layoutHasEstimatedItems;
+        /// the prefetched items reflect _prefetchBoundsY and _prefetchTargetY
+        BOOL prefetchedItemsAreValid;
+        /// -invalidateEstimatedItems will run on the next turn of the main queue
+        BOOL estimatedItemsInvalidationIsScheduled;
     } _flags;
 }
 
@@ -96,19 +258,69 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 - (void)aapl_commonInitCollectionViewGridLayout
 {
     [self registerClass:[AAPLGridLayoutSeparatorView class] forDecorationViewOfKind:AAPLGridLayoutRowSeparatorKind];
+    [self registerClass:[AAPLGridLayoutRowSeparatorsView class] forDecorationViewOfKind:AAPLGridLayoutRowSeparatorBandKind];
     [self registerClass:[AAPLGridLayoutSeparatorView class] forDecorationViewOfKind:AAPLGridLayoutSectionSeparatorKind];
     [self registerClass:[AAPLGridLayoutSeparatorView class] forDecorationViewOfKind:AAPLGridLayoutGlobalHeaderBackgroundKind];
 
-    _indexPathKindToDecorationAttributes = [NSMutableDictionary dictionary];
-    _oldIndexPathKindToDecorationAttributes = [NSMutableDictionary dictionary];
+    _supplementaryAttributes = AAPLLayoutElementTableCreate(&AAPLGridLayoutElementAttributesCallBacks);
+    _oldSupplementaryAttributes = AAPLLayoutElementTableCreate(&AAPLGridLayoutElementAttributesCallBacks);
+    _decorationAttributes = AAPLLayoutElementTableCreate(&AAPLGridLayoutElementAttributesCallBacks);
+    _oldDecorationAttributes = AAPLLayoutElementTableCreate(&AAPLGridLayoutElementAttributesCallBacks);
+    _elementKinds = [NSMutableArray arrayWithObjects:UICollectionElementKindSectionHeader, UICollectionElementKindSectionFooter, AAPLCollectionElementKindPlaceholder, AAPLGridLayoutSectionSeparatorKind, AAPLGridLayoutGlobalHeaderBackgroundKind, nil];
     _indexPathToItemAttributes = [NSMutableDictionary dictionary];
     _oldIndexPathToItemAttributes = [NSMutableDictionary dictionary];
-    _indexPathKindToSupplementaryAttributes = [NSMutableDictionary dictionary];
-    _oldIndexPathKindToSupplementaryAttributes = [NSMutableDictionary dictionary];
+    _indexPathToRowSeparatorAttributes = [NSMutableDictionary dictionary];
+    _oldIndexPathToRowSeparatorAttributes = [NSMutableDictionary dictionary];
 
     _updateSectionDirections = [NSMutableDictionary dictionary];
+    _invalidatedSections = [NSMutableIndexSet indexSet];
     _layoutAttributes = [NSMutableArray array];
-    _pinnableAttributes = [NSMutableArray array];
+    _floatingAttributes = [NSMutableArray array];
+    _measurementCache = [[AAPLLayoutMeasurementCache alloc] init];
+    _prefetchedIndexPaths = [NSMutableSet set];
+    _estimatedIndexPathsToMeasure = [NSMutableSet set];
+    _prefetchDirection = 1;
+    _prefetchTargetY = NAN;
+}
+
+- (void)dealloc
+{
+    AAPLLayoutElementTableRelease(_supplementaryAttributes);
+    AAPLLayoutElementTableRelease(_oldSupplementaryAttributes);
+    AAPLLayoutElementTableRelease(_decorationAttributes);
+    AAPLLayoutElementTableRelease(_oldDecorationAttributes);
+    free(_sectionExtents);
+}
+
+- (void)setDrawsRowSeparatorsBySection:(BOOL)drawsRowSeparatorsBySection
+{
+    if (_drawsRowSeparatorsBySection == drawsRowSeparatorsBySection)
+        return;
+    _drawsRowSeparatorsBySection = drawsRowSeparatorsBySection;
+
+    // The cached separators are the other kind
+    [_indexPathToRowSeparatorAttributes removeAllObjects];
+    [_oldIndexPathToRowSeparatorAttributes removeAllObjects];
+    [self invalidateLayout];
+}
+
+/// A small integer standing in for the kind in element keys. The same kind always gets the same ID for the lifetime of the layout.
+- (uint32_t)elementKindIDForKind:(NSString *)kind
+{
+    NSUInteger numberOfKinds = _elementKinds.count;
+
+    // Kinds are almost always the same constant strings, so check for those before comparing contents
+    for (NSUInteger kindID = 0; kindID < numberOfKinds; ++kindID) {
+        if (_elementKinds[kindID] == kind)
+            return (uint32_t)kindID;
+    }
+
+    NSUInteger kindID = [_elementKinds indexOfObject:kind];
+    if (NSNotFound == kindID) {
+        kindID = numberOfKinds;
+        [_elementKinds addObject:[kind copy]];
+    }
+    return (uint32_t)kindID;
 }
 
 #pragma mark - UICollectionViewLayout API
@@ -133,16 +345,38 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     _flags.useCollectionViewContentOffset = context.invalidateLayoutOrigin;
 
+    // Frames may have moved. If the items changed, the prefetched index paths no longer mean anything, so there's nothing to cancel.
+    if (invalidateEverything || invalidateDataSourceCounts || invalidateLayoutMetrics)
+        _flags.prefetchedItemsAreValid = NO;
+    if (invalidateEverything || invalidateDataSourceCounts) {
+        [_prefetchedIndexPaths removeAllObjects];
+        [_estimatedIndexPathsToMeasure removeAllObjects];
+    }
+
     if (invalidateEverything) {
         _flags.layoutMetricsAreValid = NO;
         _flags.layoutDataIsValid = NO;
+        _flags.layoutMetricsArePartiallyValid = NO;
     }
 
     if (_flags.layoutDataIsValid) {
+        BOOL layoutMetricsWereValid = _flags.layoutMetricsAreValid;
         _flags.layoutMetricsAreValid = !(invalidateDataSourceCounts || invalidateLayoutMetrics);
 
         if (invalidateDataSourceCounts)
             _flags.layoutDataIsValid = NO;
+
+        // Keep track of the sections that changed so the next build can leave the others alone. Any invalidation that doesn't say which sections changed requires rebuilding everything.
+        NSIndexSet *invalidatedSections = context.invalidatedSections;
+        if (invalidateDataSourceCounts || (invalidateLayoutMetrics && !invalidatedSections.count))
+            _flags.layoutMetricsArePartiallyValid = NO;
+        else if (invalidateLayoutMetrics) {
+            if (layoutMetricsWereValid) {
+                [_invalidatedSections removeAllIndexes];
+                _flags.layoutMetricsArePartiallyValid = YES;
+            }
+            [_invalidatedSections addIndexes:invalidatedSections];
+        }
     }
 
     [super invalidateLayoutWithContext:context];
@@ -156,8 +390,10 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 	
 	[super prepareLayout];
 
-    if (!CGRectIsEmpty(self.collectionView.bounds)) {
+    UICollectionView *collectionView = self.collectionView;
+    if (!CGRectIsEmpty(collectionView.bounds)) {
         [self buildLayout];
+        [self updatePrefetchedItems];
     }
 }
 
@@ -165,57 +401,261 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 {
     NSMutableArray *result = [NSMutableArray array];
 
+    [self recordEstimatedItemsInRect:rect];
     [self filterSpecialAttributes];
 
-    for (AAPLCollectionViewGridLayoutAttributes *attributes in _layoutAttributes) {
+    for (AAPLCollectionViewGridLayoutAttributes *attributes in _floatingAttributes) {
         if (CGRectIntersectsRect(attributes.frame, rect))
             [result addObject:attributes];
     }
 
+    CGFloat minY = CGRectGetMinY(rect);
+    CGFloat maxY = CGRectGetMaxY(rect);
+
+    NSArray *sections = _layoutInfo.sections;
+    NSUInteger numberOfSections = [sections count];
+
+    AAPLGridLayoutRectQuery query = { _layoutAttributes, result, rect, 0 };
+    for (NSUInteger sectionIndex = [self indexOfFirstSectionReachingY:minY]; sectionIndex < numberOfSections; ++sectionIndex) {
+        AAPLGridLayoutSectionInfo *section = sections[sectionIndex];
+        if (CGRectGetMinY(section.frame) > maxY)
+            break;
+
+        query.location = section.layoutAttributesRange.location;
+        AAPLLayoutIndexEnumerateEntriesInRange(section.layoutIndex, minY, maxY, AAPLGridLayoutCollectAttributesInRect, &query);
+
+        // Pinned headers stay within their section
+        for (AAPLCollectionViewGridLayoutAttributes *attributes in section.pinnableHeaderAttributes) {
+            if (CGRectIntersectsRect(attributes.frame, rect))
+                [result addObject:attributes];
+        }
+    }
+
+    [self addItemAttributesInRect:rect toArray:result];
     return result;
 }
 
-- (UICollectionViewLayoutAttributes *)layoutAttributesForItemAtIndexPath:(NSIndexPath *)indexPath
+/// Add the attributes of the items and row separators that intersect the rect, creating them if they haven't been requested since the layout was built
+- (void)addItemAttributesInRect:(CGRect)rect toArray:(NSMutableArray *)result
+{
+    BOOL drawsRowSeparatorsBySection = _drawsRowSeparatorsBySection;
+    __block NSUInteger lastBandSectionIndex = NSNotFound;
+    __block NSUInteger lastBandIndex = NSNotFound;
+
+    [self enumerateItemsInRect:rect usingBlock:^(AAPLGridLayoutSectionInfo *section, NSUInteger sectionIndex, NSUInteger itemIndex) {
+        NSIndexPath *indexPath = [NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex];
+        if (CGRectIntersectsRect([section frameForItemAtIndex:itemIndex], rect))
+            [result addObject:[self itemAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToItemAttributes]];
+
+        // The separator sits on top of the item below it
+        if (!itemIndex || !section.separatorColor)
+            return;
+
+        // Each band is added once, along with the first of its items in the rect
+        if (drawsRowSeparatorsBySection) {
+            NSUInteger bandIndex = itemIndex / AAPLGridLayoutRowSeparatorBandSize;
+            if (sectionIndex == lastBandSectionIndex && bandIndex == lastBandIndex)
+                return;
+            lastBandSectionIndex = sectionIndex;
+            lastBandIndex = bandIndex;
+
+            NSIndexPath *bandIndexPath = [NSIndexPath indexPathForItem:bandIndex inSection:sectionIndex];
+            AAPLCollectionViewGridLayoutAttributes *bandAttributes = [self rowSeparatorBandAttributesAtIndexPath:bandIndexPath layoutInfo:_layoutInfo cache:_indexPathToRowSeparatorAttributes];
+            if (CGRectIntersectsRect(bandAttributes.frame, rect))
+                [result addObject:bandAttributes];
+            return;
+        }
+
+        AAPLCollectionViewGridLayoutAttributes *separatorAttributes = [self rowSeparatorAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToRowSeparatorAttributes];
+        if (CGRectIntersectsRect(separatorAttributes.frame, rect))
+            [result addObject:separatorAttributes];
+    }];
+}
+
+/// Call the block for each item that overlaps the vertical extent of the rect, in order
+- (void)enumerateItemsInRect:(CGRect)rect usingBlock:(void(^)(AAPLGridLayoutSectionInfo *section, NSUInteger sectionIndex, NSUInteger itemIndex))block
+{
+    CGFloat minY = CGRectGetMinY(rect);
+    CGFloat maxY = CGRectGetMaxY(rect);
+
+    NSArray *sections = _layoutInfo.sections;
+    NSUInteger numberOfSections = [sections count];
+
+    for (NSUInteger sectionIndex = [self indexOfFirstSectionReachingY:minY]; sectionIndex < numberOfSections; ++sectionIndex) {
+        AAPLGridLayoutSectionInfo *section = sections[sectionIndex];
+        CGRect sectionFrame = section.frame;
+        if (CGRectGetMinY(sectionFrame) > maxY)
+            break;
+
+        NSUInteger numberOfItems = section.numberOfItems;
+        if (!numberOfItems || CGRectGetMaxY(sectionFrame) < minY)
+            continue;
+
+        for (NSUInteger itemIndex = [section indexOfFirstItemReachingY:minY]; itemIndex < numberOfItems; ++itemIndex) {
+            if (CGRectGetMinY([section frameForItemAtIndex:itemIndex]) > maxY)
+                break;
+            block(section, sectionIndex, itemIndex);
+        }
+    }
+}
+
+/// Create the attributes for an item from the section info. The attributes are remembered in the cache, if there is one. Returns nil if the item doesn't exist.
+- (AAPLCollectionViewGridLayoutAttributes *)itemAttributesAtIndexPath:(NSIndexPath *)indexPath layoutInfo:(AAPLGridLayoutInfo *)layoutInfo cache:(NSMutableDictionary *)cache
 {
+    AAPLCollectionViewGridLayoutAttributes *attributes = cache[indexPath];
+    if (attributes)
+        return attributes;
+
 	NSUInteger itemIndex;
 	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, YES);
+    if (sectionIndex == AAPLGlobalSection)
+        return nil;
 
-	if (sectionIndex == AAPLGlobalSection || sectionIndex >= _layoutInfo.sections.count) {
+    AAPLGridLayoutSectionInfo *section = [layoutInfo sectionAtIndex:sectionIndex];
+    if (itemIndex >= section.numberOfItems)
         return nil;
-	}
 
-	AAPLCollectionViewGridLayoutAttributes *attributes = _indexPathToItemAttributes[indexPath];
-	if (attributes) {
-		return attributes;
-	}
-	
-    AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:sectionIndex];
+    attributes = [[self.class layoutAttributesClass] layoutAttributesForCellWithIndexPath:indexPath];
+    attributes.frame = [section frameForItemAtIndex:itemIndex];
+	attributes.zIndex = AAPLGridLayoutZIndexDefault;
+    attributes.backgroundColor = section.backgroundColor;
+    attributes.selectedBackgroundColor = section.selectedBackgroundColor;
 
-	if (itemIndex >= section.items.count) {
+    // Only the current layout matches the data source
+    if (layoutInfo == _layoutInfo) {
+        UICollectionView *collectionView = self.collectionView;
+        AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
+        if ([dataSource isKindOfClass:[AAPLDataSource class]])
+            attributes.hidden = [dataSource collectionView:collectionView itemAtIndexPathIsHidden:indexPath];
+    }
+
+    cache[indexPath] = attributes;
+    return attributes;
+}
+
+/// Create the attributes for the separator above an item from the section info. The attributes are remembered in the cache, if there is one. Returns nil if the item doesn't have a separator.
+- (AAPLCollectionViewGridLayoutAttributes *)rowSeparatorAttributesAtIndexPath:(NSIndexPath *)indexPath layoutInfo:(AAPLGridLayoutInfo *)layoutInfo cache:(NSMutableDictionary *)cache
+{
+    AAPLCollectionViewGridLayoutAttributes *attributes = cache[indexPath];
+    if (attributes)
+        return attributes;
+
+	NSUInteger itemIndex;
+	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, YES);
+    if (sectionIndex == AAPLGlobalSection)
         return nil;
-	}
 
-	UICollectionView *collectionView = self.collectionView;
-	AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
-	if (![dataSource isKindOfClass:[AAPLDataSource class]]) {
-		dataSource = nil;
-	}
+    // The first item doesn't have a separator above it
+    AAPLGridLayoutSectionInfo *section = [layoutInfo sectionAtIndex:sectionIndex];
+    UIColor *separatorColor = section.separatorColor;
+    if (!separatorColor || !itemIndex || itemIndex >= section.numberOfItems)
+        return nil;
 
-    AAPLGridLayoutItemInfo *item = section.items[itemIndex];
+    CGRect frame = [section frameForItemAtIndex:itemIndex];
+    UIEdgeInsets separatorInsets = section.separatorInsets;
 
-    attributes = [[self.class layoutAttributesClass] layoutAttributesForCellWithIndexPath:indexPath];
+    attributes = [[self.class layoutAttributesClass] layoutAttributesForDecorationViewOfKind:AAPLGridLayoutRowSeparatorKind withIndexPath:indexPath];
+    attributes.frame = CGRectMake(separatorInsets.left, CGRectGetMinY(frame), CGRectGetWidth(frame) - separatorInsets.left - separatorInsets.right, self.collectionView.aapl_hairlineWidth);
+    attributes.backgroundColor = separatorColor;
+    attributes.zIndex = AAPLGridLayoutZIndexSeparator;
 
-    // Need to be clever if we're still preparing the layout…
-    attributes.frame = item.frame;
-	attributes.zIndex = AAPLGridLayoutZIndexDefault;
-    attributes.backgroundColor = section.backgroundColor;
-    attributes.selectedBackgroundColor = section.selectedBackgroundColor;
-	attributes.hidden = _preparingLayout || [dataSource collectionView:collectionView itemAtIndexPathIsHidden:indexPath];
+    cache[indexPath] = attributes;
+    return attributes;
+}
 
-	if (!_preparingLayout) {
-        _indexPathToItemAttributes[indexPath] = attributes;
+/// Create the attributes for a band of row separators from the section info. The item of the index path is the index of the band. The separators are snapped to pixels. The attributes are remembered in the cache, if there is one. Returns nil if the band doesn't have any separators.
+- (AAPLCollectionViewGridLayoutAttributes *)rowSeparatorBandAttributesAtIndexPath:(NSIndexPath *)indexPath layoutInfo:(AAPLGridLayoutInfo *)layoutInfo cache:(NSMutableDictionary *)cache
+{
+    AAPLCollectionViewGridLayoutAttributes *attributes = cache[indexPath];
+    if (attributes)
+        return attributes;
+
+	NSUInteger bandIndex;
+	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &bandIndex, YES);
+    if (sectionIndex == AAPLGlobalSection)
+        return nil;
+
+    AAPLGridLayoutSectionInfo *section = [layoutInfo sectionAtIndex:sectionIndex];
+    UIColor *separatorColor = section.separatorColor;
+    NSUInteger numberOfItems = section.numberOfItems;
+    if (!separatorColor || bandIndex >= AAPLGridLayoutNumberOfRowSeparatorBands(numberOfItems))
+        return nil;
+
+    // The first item doesn't have a separator above it
+    NSUInteger firstItemIndex = MAX(1, bandIndex * AAPLGridLayoutRowSeparatorBandSize);
+    NSUInteger endItemIndex = MIN(numberOfItems, (bandIndex + 1) * AAPLGridLayoutRowSeparatorBandSize);
+
+    const CGFloat hairline = self.collectionView.aapl_hairlineWidth;
+    CGRect firstFrame = [section frameForItemAtIndex:firstItemIndex];
+    CGFloat minY = AAPLGridLayoutRoundToPixel(CGRectGetMinY(firstFrame), hairline);
+    CGFloat maxY = minY;
+
+    CGFloat separatorOffsets[AAPLGridLayoutRowSeparatorBandSize];
+    NSUInteger numberOfSeparatorOffsets = 0;
+    for (NSUInteger itemIndex = firstItemIndex; itemIndex < endItemIndex; ++itemIndex) {
+        maxY = AAPLGridLayoutRoundToPixel(CGRectGetMinY([section frameForItemAtIndex:itemIndex]), hairline);
+        separatorOffsets[numberOfSeparatorOffsets++] = maxY - minY;
+    }
+
+    UIEdgeInsets separatorInsets = section.separatorInsets;
+
+    attributes = [[self.class layoutAttributesClass] layoutAttributesForDecorationViewOfKind:AAPLGridLayoutRowSeparatorBandKind withIndexPath:indexPath];
+    attributes.frame = CGRectMake(separatorInsets.left, minY, CGRectGetWidth(firstFrame) - separatorInsets.left - separatorInsets.right, maxY - minY + hairline);
+    [attributes setSeparatorOffsets:separatorOffsets count:numberOfSeparatorOffsets];
+    attributes.backgroundColor = separatorColor;
+    attributes.zIndex = AAPLGridLayoutZIndexSeparator;
+
+    cache[indexPath] = attributes;
+    return attributes;
+}
+
+- (AAPLCollectionViewGridLayoutAttributes *)itemAttributesAtIndexPath:(NSIndexPath *)indexPath previousLayout:(BOOL)previousLayout
+{
+    if (previousLayout)
+        return [self itemAttributesAtIndexPath:indexPath layoutInfo:_oldLayoutInfo cache:_oldIndexPathToItemAttributes];
+    return [self itemAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToItemAttributes];
+}
+
+- (AAPLCollectionViewGridLayoutAttributes *)decorationAttributesOfKind:(NSString *)kind atIndexPath:(NSIndexPath *)indexPath previousLayout:(BOOL)previousLayout
+{
+    if ([kind isEqualToString:AAPLGridLayoutRowSeparatorKind]) {
+        if (previousLayout)
+            return [self rowSeparatorAttributesAtIndexPath:indexPath layoutInfo:_oldLayoutInfo cache:_oldIndexPathToRowSeparatorAttributes];
+        return [self rowSeparatorAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToRowSeparatorAttributes];
+    }
+
+    if ([kind isEqualToString:AAPLGridLayoutRowSeparatorBandKind]) {
+        if (previousLayout)
+            return [self rowSeparatorBandAttributesAtIndexPath:indexPath layoutInfo:_oldLayoutInfo cache:_oldIndexPathToRowSeparatorAttributes];
+        return [self rowSeparatorBandAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToRowSeparatorAttributes];
+    }
+
+    AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+    if (previousLayout)
+        return AAPLGridLayoutGetElementAttributes(_oldDecorationAttributes, key);
+    return AAPLGridLayoutGetElementAttributes(_decorationAttributes, key);
+}
+
+- (UICollectionViewLayoutAttributes *)layoutAttributesForItemAtIndexPath:(NSIndexPath *)indexPath
+{
+	NSUInteger itemIndex;
+	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, YES);
+
+	if (sectionIndex == AAPLGlobalSection || sectionIndex >= _layoutInfo.numberOfSections) {
+        return nil;
 	}
-	
+
+    if (!_preparingLayout)
+        return [self itemAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:_indexPathToItemAttributes];
+
+	AAPLCollectionViewGridLayoutAttributes *attributes = _indexPathToItemAttributes[indexPath];
+	if (attributes) {
+		return attributes;
+	}
+
+    // Need to be clever if we're still preparing the layout…
+    attributes = [self itemAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:nil];
+    attributes.hidden = YES;
     return attributes;
 }
 
@@ -224,8 +664,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 	NSUInteger itemIndex;
 	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, YES);
 
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    AAPLCollectionViewGridLayoutAttributes *attributes = _indexPathKindToSupplementaryAttributes[indexPathKind];
+    AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+    AAPLCollectionViewGridLayoutAttributes *attributes = AAPLGridLayoutGetElementAttributes(_supplementaryAttributes, key);
     if (attributes)
         return attributes;
 
@@ -255,7 +695,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     attributes.selectedBackgroundColor = section.selectedBackgroundColor;
 
 	if (!_preparingLayout) {
-        _indexPathKindToSupplementaryAttributes[indexPathKind] = attributes;
+        AAPLGridLayoutSetElementAttributes(_supplementaryAttributes, key, attributes);
 	}
 
     return attributes;
@@ -263,8 +703,20 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 - (UICollectionViewLayoutAttributes *)layoutAttributesForDecorationViewOfKind:(NSString*)kind atIndexPath:(NSIndexPath *)indexPath
 {
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    AAPLCollectionViewGridLayoutAttributes *attributes = _indexPathKindToDecorationAttributes[indexPathKind];
+    if ([kind isEqualToString:AAPLGridLayoutRowSeparatorKind]) {
+        AAPLCollectionViewGridLayoutAttributes *separatorAttributes = [self rowSeparatorAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:(_preparingLayout ? nil : _indexPathToRowSeparatorAttributes)];
+        if (separatorAttributes)
+            return separatorAttributes;
+    }
+
+    if ([kind isEqualToString:AAPLGridLayoutRowSeparatorBandKind]) {
+        AAPLCollectionViewGridLayoutAttributes *bandAttributes = [self rowSeparatorBandAttributesAtIndexPath:indexPath layoutInfo:_layoutInfo cache:(_preparingLayout ? nil : _indexPathToRowSeparatorAttributes)];
+        if (bandAttributes)
+            return bandAttributes;
+    }
+
+    AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+    AAPLCollectionViewGridLayoutAttributes *attributes = AAPLGridLayoutGetElementAttributes(_decorationAttributes, key);
     if (attributes)
         return attributes;
 
@@ -293,7 +745,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 	}
 
 	if (!_preparingLayout) {
-		_indexPathKindToDecorationAttributes[indexPathKind] = attributes;
+		AAPLGridLayoutSetElementAttributes(_decorationAttributes, key, attributes);
 	}
 
 	return attributes;
@@ -318,6 +770,14 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 - (CGPoint)targetContentOffsetForProposedContentOffset:(CGPoint)proposedContentOffset withScrollingVelocity:(CGPoint)velocity
 {
+    // A fling says where scrolling will come to rest, so the items there can be prefetched before scrolling gets there
+    if (velocity.y) {
+        _prefetchDirection = (velocity.y > 0 ? 1 : -1);
+        _prefetchTargetY = proposedContentOffset.y;
+        _prefetchBoundsY = CGRectGetMinY(self.collectionView.bounds);
+        _flags.prefetchedItemsAreValid = NO;
+        [self updatePrefetchedItems];
+    }
     return proposedContentOffset;
 }
 
@@ -398,6 +858,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     CGPoint newContentOffset = [self targetContentOffsetForProposedContentOffset:contentOffset];
     self.contentOffsetDelta = CGPointMake(newContentOffset.x - contentOffset.x, newContentOffset.y - contentOffset.y);
 
+    [self prepareDecorationIndexPathUpdates];
+
     [super prepareForCollectionViewUpdates:updateItems];
 }
 
@@ -409,26 +871,67 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     self.removedSections = nil;
     self.reloadedSections = nil;
     [self.updateSectionDirections removeAllObjects];
+    _insertedDecorationIndexPaths = nil;
+    _deletedDecorationIndexPaths = nil;
 	[super finalizeCollectionViewUpdates];
 }
 
-// FIXME: <rdar://problem/16520988>
-// This method is ACTUALLY called for supplementary views
-- (NSArray *)indexPathsToDeleteForDecorationViewOfKind:(NSString *)kind
+/// Work out which decoration views come and go with this update for every kind at once, so the collection view asking for each kind in turn doesn't scan both layouts each time. Decoration views in both layouts aren't listed: the collection view animates those from their previous attributes to their new ones itself.
+- (void)prepareDecorationIndexPathUpdates
 {
-    NSMutableArray *result = [NSMutableArray array];
-
     // FIXME: <rdar://problem/16117605> Be smarter about updating the attributes on layout updates
-    [_oldIndexPathKindToDecorationAttributes enumerateKeysAndObjectsUsingBlock:^(AAPLIndexPathKind *indexPathKind, AAPLCollectionViewGridLayoutAttributes *attributes, BOOL *stop) {
-        if (![indexPathKind.kind isEqualToString:kind])
-            return;
-        // If we have a similar decoration view in the new attributes, skip it.
-        if (_indexPathKindToDecorationAttributes[indexPathKind])
+    NSMutableDictionary *inserted = [NSMutableDictionary dictionary];
+    AAPLGridLayoutMissingElementQuery insertedQuery = { _oldDecorationAttributes, _elementKinds, inserted };
+    AAPLLayoutElementTableApplyFunction(_decorationAttributes, AAPLGridLayoutCollectMissingElements, &insertedQuery);
+    [self collectRowSeparatorIndexPathsOfLayoutInfo:_layoutInfo missingFromLayoutInfo:_oldLayoutInfo intoDictionary:inserted];
+
+    NSMutableDictionary *deleted = [NSMutableDictionary dictionary];
+    AAPLGridLayoutMissingElementQuery deletedQuery = { _decorationAttributes, _elementKinds, deleted };
+    AAPLLayoutElementTableApplyFunction(_oldDecorationAttributes, AAPLGridLayoutCollectMissingElements, &deletedQuery);
+    [self collectRowSeparatorIndexPathsOfLayoutInfo:_oldLayoutInfo missingFromLayoutInfo:_layoutInfo intoDictionary:deleted];
+
+    _insertedDecorationIndexPaths = inserted;
+    _deletedDecorationIndexPaths = deleted;
+}
+
+/// Row separators are created on demand rather than kept in the decoration tables, so work out which ones one layout has and the other doesn't from the section info
+- (void)collectRowSeparatorIndexPathsOfLayoutInfo:(AAPLGridLayoutInfo *)layoutInfo missingFromLayoutInfo:(AAPLGridLayoutInfo *)otherLayoutInfo intoDictionary:(NSMutableDictionary *)result
+{
+    BOOL drawsRowSeparatorsBySection = _drawsRowSeparatorsBySection;
+    NSMutableArray *rowSeparatorIndexPaths = [NSMutableArray array];
+
+    [layoutInfo.sections enumerateObjectsUsingBlock:^(AAPLGridLayoutSectionInfo *section, NSUInteger sectionIndex, BOOL *stop) {
+        if (!section.separatorColor)
             return;
-        [result addObject:indexPathKind.indexPath];
+
+        AAPLGridLayoutSectionInfo *otherSection = [otherLayoutInfo sectionAtIndex:sectionIndex];
+
+        if (drawsRowSeparatorsBySection) {
+            NSUInteger numberOfOtherBands = otherSection.separatorColor ? AAPLGridLayoutNumberOfRowSeparatorBands(otherSection.numberOfItems) : 0;
+            for (NSUInteger bandIndex = numberOfOtherBands; bandIndex < AAPLGridLayoutNumberOfRowSeparatorBands(section.numberOfItems); ++bandIndex)
+                [rowSeparatorIndexPaths addObject:[NSIndexPath indexPathForItem:bandIndex inSection:sectionIndex]];
+        }
+        else {
+            NSUInteger numberOfOtherSeparatedItems = otherSection.separatorColor ? otherSection.numberOfItems : 0;
+            for (NSUInteger itemIndex = MAX(1, numberOfOtherSeparatedItems); itemIndex < section.numberOfItems; ++itemIndex)
+                [rowSeparatorIndexPaths addObject:[NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex]];
+        }
     }];
 
-    return result;
+    if (rowSeparatorIndexPaths.count)
+        result[drawsRowSeparatorsBySection ? AAPLGridLayoutRowSeparatorBandKind : AAPLGridLayoutRowSeparatorKind] = rowSeparatorIndexPaths;
+}
+
+// FIXME: <rdar://problem/16520988>
+// This method is ACTUALLY called for supplementary views
+- (NSArray *)indexPathsToDeleteForDecorationViewOfKind:(NSString *)kind
+{
+    return _deletedDecorationIndexPaths[kind] ?: @[];
+}
+
+- (NSArray *)indexPathsToInsertForDecorationViewOfKind:(NSString *)kind
+{
+    return _insertedDecorationIndexPaths[kind] ?: @[];
 }
 
 - (UICollectionViewLayoutAttributes *)initialLayoutAttributesForAppearingDecorationElementOfKind:(NSString *)kind atIndexPath:(NSIndexPath *)indexPath
@@ -439,21 +942,19 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-        return [self initialLayoutAttributesForAttributes:[_indexPathKindToDecorationAttributes[indexPathKind] copy] slidingInFromDirection:direction];
+        return [self initialLayoutAttributesForAttributes:[[self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:NO] copy] slidingInFromDirection:direction];
     }
 
     BOOL inserted = [self.insertedSections containsIndex:section];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    result = [_indexPathKindToDecorationAttributes[indexPathKind] copy];
+    result = [[self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:NO] copy];
 
     if (inserted)
         result.alpha = 0;
 
     if (reloaded) {
-        if (!_oldIndexPathKindToDecorationAttributes[indexPathKind])
+        if (![self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:YES])
             result.alpha = 0;
     }
 
@@ -468,21 +969,19 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-        return [self finalLayoutAttributesForAttributes:[_oldIndexPathKindToDecorationAttributes[indexPathKind] copy] slidingAwayFromDirection:direction];
+        return [self finalLayoutAttributesForAttributes:[[self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:YES] copy] slidingAwayFromDirection:direction];
     }
 
     BOOL removed = [self.removedSections containsIndex:section];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    result = [_oldIndexPathKindToDecorationAttributes[indexPathKind] copy];
+    result = [[self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:YES] copy];
 
     if (removed)
         result.alpha = 0;
 
     if (reloaded) {
-        if (!_indexPathKindToDecorationAttributes[indexPathKind])
+        if (![self decorationAttributesOfKind:kind atIndexPath:indexPath previousLayout:NO])
             result.alpha = 0;
     }
 
@@ -497,8 +996,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-        result = [_indexPathKindToSupplementaryAttributes[indexPathKind] copy];
+        AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+        result = [AAPLGridLayoutGetElementAttributes(_supplementaryAttributes, key) copy];
         if ([AAPLCollectionElementKindPlaceholder isEqualToString:kind]) {
             result.alpha = 0;
             return [self initialLayoutAttributesForAttributes:result];
@@ -510,15 +1009,15 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     BOOL inserted = [self.insertedSections containsIndex:section];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    result = [_indexPathKindToSupplementaryAttributes[indexPathKind] copy];
+    AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+    result = [AAPLGridLayoutGetElementAttributes(_supplementaryAttributes, key) copy];
 
     if (inserted) {
         result.alpha = 0;
         result = [self initialLayoutAttributesForAttributes:result];
     }
     else if (reloaded) {
-        if (!_oldIndexPathKindToSupplementaryAttributes[indexPathKind])
+        if (!AAPLGridLayoutGetElementAttributes(_oldSupplementaryAttributes, key))
             result.alpha = 0;
     }
 
@@ -533,8 +1032,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-        result = [_oldIndexPathKindToSupplementaryAttributes[indexPathKind] copy];
+        AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+        result = [AAPLGridLayoutGetElementAttributes(_oldSupplementaryAttributes, key) copy];
         if ([AAPLCollectionElementKindPlaceholder isEqualToString:kind]) {
             result.alpha = 0;
             return [self finalLayoutAttributesForAttributes:result];
@@ -546,8 +1045,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     BOOL removed = [self.removedSections containsIndex:section];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-    result = [_oldIndexPathKindToSupplementaryAttributes[indexPathKind] copy];
+    AAPLLayoutElementKey key = AAPLGridLayoutElementKeyMake([self elementKindIDForKind:kind], indexPath);
+    result = [AAPLGridLayoutGetElementAttributes(_oldSupplementaryAttributes, key) copy];
 
     if (removed || reloaded)
         result.alpha = 0;
@@ -563,19 +1062,19 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        return [self initialLayoutAttributesForAttributes:[_indexPathToItemAttributes[indexPath] copy] slidingInFromDirection:direction];
+        return [self initialLayoutAttributesForAttributes:[[self itemAttributesAtIndexPath:indexPath previousLayout:NO] copy] slidingInFromDirection:direction];
     }
 
     BOOL inserted = [self.insertedSections containsIndex:section] || [self.insertedIndexPaths containsObject:indexPath];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    result = [_indexPathToItemAttributes[indexPath] copy];
+    result = [[self itemAttributesAtIndexPath:indexPath previousLayout:NO] copy];
 
     if (inserted)
         result.alpha = 0;
 
     if (reloaded) {
-        if (!_oldIndexPathToItemAttributes[indexPath])
+        if (![self itemAttributesAtIndexPath:indexPath previousLayout:YES])
             result.alpha = 0;
     }
 
@@ -590,20 +1089,20 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     AAPLDataSourceSectionOperationDirection direction = [_updateSectionDirections[@(section)] intValue];
 	if (AAPLDataSourceSectionOperationDirectionNone != direction) {
-        return [self finalLayoutAttributesForAttributes:[_oldIndexPathToItemAttributes[indexPath] copy] slidingAwayFromDirection:direction];
+        return [self finalLayoutAttributesForAttributes:[[self itemAttributesAtIndexPath:indexPath previousLayout:YES] copy] slidingAwayFromDirection:direction];
     }
 
     BOOL removed = [self.removedIndexPaths containsObject:indexPath] || [self.removedSections containsIndex:section];
     BOOL reloaded = [self.reloadedSections containsIndex:section];
 
-    result = [_oldIndexPathToItemAttributes[indexPath] copy];
+    result = [[self itemAttributesAtIndexPath:indexPath previousLayout:YES] copy];
 
     if (removed)
         result.alpha = 0;
 
     if (reloaded) {
         // There's no item at this index path, so cross fade
-        if (!_indexPathToItemAttributes[indexPath])
+        if (![self itemAttributesAtIndexPath:indexPath previousLayout:NO])
             result.alpha = 0;
     }
 
@@ -621,7 +1120,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 - (AAPLGridLayoutSectionInfo *)sectionInfoForSectionAtIndex:(NSInteger)sectionIndex
 {
-    return _layoutInfo.sections[@(sectionIndex)];
+    return [_layoutInfo sectionAtIndex:(NSUInteger)sectionIndex];
 }
 
 - (NSDictionary *)snapshotMetrics
@@ -634,27 +1133,34 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 - (void)resetLayoutInfo
 {
-    if (!_layoutInfo)
-        _layoutInfo = [[AAPLGridLayoutInfo alloc] init];
-    else
-        [_layoutInfo invalidate];
+    // Keep the previous layout so attributes that were never requested can still be created for update animations
+    _oldLayoutInfo = _layoutInfo;
+    _layoutInfo = [[AAPLGridLayoutInfo alloc] init];
+    _numberOfSectionExtents = 0;
 
-    NSMutableDictionary *tmp;
+    AAPLLayoutElementTableRef table;
 
-    tmp = _oldIndexPathKindToSupplementaryAttributes;
-    _oldIndexPathKindToSupplementaryAttributes = _indexPathKindToSupplementaryAttributes;
-    _indexPathKindToSupplementaryAttributes = tmp;
-    [_indexPathKindToSupplementaryAttributes removeAllObjects];
+    table = _oldSupplementaryAttributes;
+    _oldSupplementaryAttributes = _supplementaryAttributes;
+    _supplementaryAttributes = table;
+    AAPLLayoutElementTableRemoveAllValues(_supplementaryAttributes);
+
+    NSMutableDictionary *tmp;
 
     tmp = _oldIndexPathToItemAttributes;
     _oldIndexPathToItemAttributes = _indexPathToItemAttributes;
     _indexPathToItemAttributes = tmp;
     [_indexPathToItemAttributes removeAllObjects];
 
-    tmp = _oldIndexPathKindToDecorationAttributes;
-    _oldIndexPathKindToDecorationAttributes = _indexPathKindToDecorationAttributes;
-    _indexPathKindToDecorationAttributes = tmp;
-    [_indexPathKindToDecorationAttributes removeAllObjects];
+    tmp = _oldIndexPathToRowSeparatorAttributes;
+    _oldIndexPathToRowSeparatorAttributes = _indexPathToRowSeparatorAttributes;
+    _indexPathToRowSeparatorAttributes = tmp;
+    [_indexPathToRowSeparatorAttributes removeAllObjects];
+
+    table = _oldDecorationAttributes;
+    _oldDecorationAttributes = _decorationAttributes;
+    _decorationAttributes = table;
+    AAPLLayoutElementTableRemoveAllValues(_decorationAttributes);
 }
 
 - (CGSize)measureSupplementalItemOfKind:(NSString *)kind atIndexPath:(NSIndexPath *)indexPath
@@ -669,6 +1175,208 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     return size;
 }
 
+/// Measure an item using the data source, unless the measurement cache already has its height.
+- (CGSize)measureItemAtIndexPath:(NSIndexPath *)indexPath fittingSize:(CGSize)fittingSize dataSource:(AAPLDataSource *)dataSource
+{
+    UICollectionView *collectionView = self.collectionView;
+
+    id<NSCopying> identifier = [dataSource collectionView:collectionView measurementIdentifierForItemAtIndexPath:indexPath];
+    if (!identifier)
+        return [dataSource collectionView:collectionView sizeFittingSize:fittingSize forItemAtIndexPath:indexPath];
+
+    NSUInteger version = [dataSource collectionView:collectionView measurementVersionForItemAtIndexPath:indexPath];
+
+    CGFloat height;
+    if ([_measurementCache getHeight:&height forIdentifier:identifier width:fittingSize.width version:version])
+        return CGSizeMake(fittingSize.width, height);
+
+    CGSize size = [dataSource collectionView:collectionView sizeFittingSize:fittingSize forItemAtIndexPath:indexPath];
+    [_measurementCache setHeight:size.height forIdentifier:identifier width:fittingSize.width version:version];
+    return size;
+}
+
+/// Measure the items in a section that need a size using the data source's size block, if it has one. Items with a cached height are filled in directly and the rest are measured in batches spread across a concurrent queue. The results are applied in one pass once every batch has finished, so -computeLayoutForSection:… doesn't measure these items again.
+- (void)measureItemsInSection:(AAPLGridLayoutSectionInfo *)section atIndex:(NSInteger)sectionIndex dataSource:(AAPLDataSource *)dataSource
+{
+    // Estimated items are measured as they come close to the visible bounds, and uniform sections have a fixed row height
+    if (!dataSource || section.estimatedRowHeight || section.uniform)
+        return;
+
+    NSUInteger numberOfItems = section.numberOfItems;
+    if (!numberOfItems)
+        return;
+
+    UICollectionView *collectionView = self.collectionView;
+    AAPLItemSizeBlock sizeBlock = [dataSource collectionView:collectionView sizeBlockForItemsInSection:sectionIndex];
+    if (!sizeBlock)
+        return;
+
+    CGFloat columnWidth = section.columnWidth;
+    CGRect *itemFrames = section.itemFrames;
+    AAPLGridLayoutItemFlags *itemFlags = section.itemFlags;
+    NSUInteger *itemIndexes = malloc(numberOfItems * sizeof(NSUInteger));
+    NSUInteger *versions = malloc(numberOfItems * sizeof(NSUInteger));
+    CGFloat *heights = malloc(numberOfItems * sizeof(CGFloat));
+    NSMutableArray *identifiers = [NSMutableArray array];
+    NSUInteger count = 0;
+
+    for (NSUInteger itemIndex = 0; itemIndex < numberOfItems; ++itemIndex) {
+        if (!(itemFlags[itemIndex] & AAPLGridLayoutItemFlagNeedSizeUpdate))
+            continue;
+
+        NSIndexPath *indexPath = [NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex];
+        id<NSCopying> identifier = [dataSource collectionView:collectionView measurementIdentifierForItemAtIndexPath:indexPath];
+        NSUInteger version = identifier ? [dataSource collectionView:collectionView measurementVersionForItemAtIndexPath:indexPath] : 0;
+
+        CGFloat height;
+        if (identifier && [_measurementCache getHeight:&height forIdentifier:identifier width:columnWidth version:version]) {
+            itemFrames[itemIndex].size.height = height;
+            itemFlags[itemIndex] &= ~AAPLGridLayoutItemFlagNeedSizeUpdate;
+            continue;
+        }
+
+        itemIndexes[count] = itemIndex;
+        versions[count] = version;
+        [identifiers addObject:identifier ?: [NSNull null]];
+        ++count;
+    }
+
+    if (count) {
+        CGSize fittingSize = CGSizeMake(columnWidth, AAPLGridLayoutMeasuringHeight);
+        size_t numberOfBatches = (count + AAPLGridLayoutMeasuringBatchSize - 1) / AAPLGridLayoutMeasuringBatchSize;
+
+        // Each batch writes to its own slice of heights, so no synchronization is needed
+        dispatch_apply(numberOfBatches, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t batch) {
+            NSUInteger end = MIN(count, (batch + 1) * AAPLGridLayoutMeasuringBatchSize);
+            for (NSUInteger position = batch * AAPLGridLayoutMeasuringBatchSize; position < end; ++position)
+                heights[position] = sizeBlock(itemIndexes[position], fittingSize).height;
+        });
+
+        for (NSUInteger position = 0; position < count; ++position) {
+            NSUInteger itemIndex = itemIndexes[position];
+            itemFrames[itemIndex].size.height = heights[position];
+            itemFlags[itemIndex] &= ~AAPLGridLayoutItemFlagNeedSizeUpdate;
+
+            id identifier = identifiers[position];
+            if (identifier != [NSNull null])
+                [_measurementCache setHeight:heights[position] forIdentifier:identifier width:columnWidth version:versions[position]];
+        }
+    }
+
+    free(itemIndexes);
+    free(versions);
+    free(heights);
+}
+
+/// Record the items with estimated heights that are close to the visible bounds and schedule -invalidateEstimatedItems to measure them. UICollectionView doesn't expect the layout to be invalidated while it is asking for attributes, so the attributes returned for this rect keep the estimated frames.
+- (void)recordEstimatedItemsInRect:(CGRect)rect
+{
+    if (!_flags.layoutHasEstimatedItems || !_flags.layoutMetricsAreValid || _preparingLayout)
+        return;
+
+    UICollectionView *collectionView = self.collectionView;
+    if (![collectionView.dataSource isKindOfClass:[AAPLDataSource class]])
+        return;
+
+    // Only measure what's visible or about to be, no matter how large a rect was requested
+    CGRect bounds = collectionView.bounds;
+    CGRect nearbyRect = CGRectIntersection(rect, CGRectInset(bounds, 0, -CGRectGetHeight(bounds)));
+    if (CGRectIsNull(nearbyRect))
+        return;
+
+    [self enumerateItemsInRect:nearbyRect usingBlock:^(AAPLGridLayoutSectionInfo *section, NSUInteger sectionIndex, NSUInteger itemIndex) {
+        if (!section.estimatedRowHeight || !(section.itemFlags[itemIndex] & AAPLGridLayoutItemFlagNeedSizeUpdate))
+            return;
+        [_estimatedIndexPathsToMeasure addObject:[NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex]];
+    }];
+
+    if (![_estimatedIndexPathsToMeasure count] || _flags.estimatedItemsInvalidationIsScheduled)
+        return;
+
+    _flags.estimatedItemsInvalidationIsScheduled = YES;
+
+    __weak typeof(&*self) weakself = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakself invalidateEstimatedItems];
+    });
+}
+
+/// Measure the recorded items with estimated heights and invalidate their sections. The content offset moves by however much the items above the visible bounds changed height, so the visible content stays in place.
+- (void)invalidateEstimatedItems
+{
+    _flags.estimatedItemsInvalidationIsScheduled = NO;
+
+    // The frames the items were recorded with are out of date, and the items will be recorded again once the layout is rebuilt
+    if (!_flags.layoutMetricsAreValid) {
+        [_estimatedIndexPathsToMeasure removeAllObjects];
+        return;
+    }
+
+    NSMutableIndexSet *invalidatedSections = [NSMutableIndexSet indexSet];
+    for (NSIndexPath *indexPath in _estimatedIndexPathsToMeasure)
+        [invalidatedSections addIndex:indexPath.section];
+
+    CGFloat deltaAboveVisible = [self measureEstimatedItems];
+    if (![invalidatedSections count])
+        return;
+
+    AAPLGridLayoutInvalidationContext *context = [[AAPLGridLayoutInvalidationContext alloc] init];
+    context.invalidateLayoutMetrics = YES;
+    context.invalidatedSections = invalidatedSections;
+    context.invalidateLayoutOrigin = _flags.useCollectionViewContentOffset;
+
+    // iOS 7 has no content offset adjustment, so there the offset is moved once the layout has been invalidated
+    BOOL adjustsContentOffset = (deltaAboveVisible && [context respondsToSelector:@selector(setContentOffsetAdjustment:)]);
+    if (adjustsContentOffset)
+        context.contentOffsetAdjustment = CGPointMake(0, deltaAboveVisible);
+
+    [self invalidateLayoutWithContext:context];
+
+    if (deltaAboveVisible && !adjustsContentOffset) {
+        UICollectionView *collectionView = self.collectionView;
+        CGPoint contentOffset = collectionView.contentOffset;
+        contentOffset.y += deltaAboveVisible;
+        collectionView.contentOffset = contentOffset;
+    }
+}
+
+/// Measure the recorded items with estimated heights. Returns how much the items above the visible bounds changed height in total, which is how far the content offset should move to keep the visible content in place.
+- (CGFloat)measureEstimatedItems
+{
+    if (![_estimatedIndexPathsToMeasure count])
+        return 0;
+
+    UICollectionView *collectionView = self.collectionView;
+    AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
+
+    // The items may be gone if the data changed since they were recorded
+    if (!_flags.layoutDataIsValid || ![dataSource isKindOfClass:[AAPLDataSource class]]) {
+        [_estimatedIndexPathsToMeasure removeAllObjects];
+        return 0;
+    }
+
+    CGFloat visibleMinY = CGRectGetMinY(collectionView.bounds) + collectionView.contentInset.top;
+    CGFloat deltaAboveVisible = 0;
+
+    for (NSIndexPath *indexPath in _estimatedIndexPathsToMeasure) {
+        AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:indexPath.section];
+        NSUInteger itemIndex = indexPath.item;
+        if (itemIndex >= section.numberOfItems || !(section.itemFlags[itemIndex] & AAPLGridLayoutItemFlagNeedSizeUpdate))
+            continue;
+
+        CGRect frame = [section frameForItemAtIndex:itemIndex];
+        CGSize size = [self measureItemAtIndexPath:indexPath fittingSize:CGSizeMake(CGRectGetWidth(frame), AAPLGridLayoutMeasuringHeight) dataSource:dataSource];
+        [section setHeight:size.height forItemAtIndex:itemIndex];
+        section.itemFlags[itemIndex] &= ~AAPLGridLayoutItemFlagNeedSizeUpdate;
+
+        if (CGRectGetMaxY(frame) <= visibleMinY)
+            deltaAboveVisible += size.height - CGRectGetHeight(frame);
+    }
+
+    [_estimatedIndexPathsToMeasure removeAllObjects];
+    return deltaAboveVisible;
+}
+
 /// Create a new section from the metrics.
 - (void)createSectionFromMetrics:(AAPLLayoutSectionMetrics *)metrics forSectionAtIndex:(NSInteger)sectionIndex
 {
@@ -685,7 +1393,12 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     NSAssert(rowHeight != AAPLRowHeightRemainder || numberOfItemsInSection == 1, @"Only one item is permitted in a section with remainder row height.");
     NSAssert(rowHeight != AAPLRowHeightRemainder || sectionIndex == [collectionView numberOfSections] - 1, @"Remainder row height may only be set for last section.");
 
-    if (variableRowHeight)
+    CGFloat estimatedRowHeight = variableRowHeight ? metrics.estimatedRowHeight : 0;
+    if (estimatedRowHeight > 0) {
+        rowHeight = estimatedRowHeight;
+        _flags.layoutHasEstimatedItems = YES;
+    }
+    else if (variableRowHeight)
 		rowHeight = AAPLGridLayoutMeasuringHeight;
 
     AAPLGridLayoutSectionInfo *section = [_layoutInfo addSectionWithIndex:sectionIndex];
@@ -703,6 +1416,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     section.separatorInsets = metrics.separatorInsets;
     section.showsSectionSeparatorWhenLastSection = metrics.showsSectionSeparatorWhenLastSection;
     section.insets = metrics.padding;
+    section.estimatedRowHeight = MAX(estimatedRowHeight, 0);
 
 	for (AAPLLayoutSupplementaryMetrics *suplMetrics in metrics.supplementaryViews) {
 		if ([suplMetrics.supplementaryViewKind isEqual:UICollectionElementKindSectionFooter] && !suplMetrics.height) {
@@ -743,18 +1457,16 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
         placeholder.height = height;
     }
     else {
-        for (NSInteger itemIndex = 0; itemIndex < numberOfItemsInSection; ++itemIndex) {
-            AAPLGridLayoutItemInfo *itemInfo = [section addItem];
-            itemInfo.frame = CGRectMake(0, 0, columnWidth, rowHeight);
-            if (variableRowHeight)
-                itemInfo.needSizeUpdate = YES;
-        }
+        // Items with a fixed row height keep the section uniform, so it stores nothing per item however many there are
+        AAPLGridLayoutItemFlags flags = (variableRowHeight ? AAPLGridLayoutItemFlagNeedSizeUpdate : 0);
+        [section addItemsWithCount:(NSUInteger)numberOfItemsInSection frame:CGRectMake(0, 0, columnWidth, rowHeight) flags:flags];
     }
 }
 
 - (void)createLayoutInfoFromDataSource
 {
     [self resetLayoutInfo];
+    _flags.layoutHasEstimatedItems = NO;
 
     UICollectionView *collectionView = self.collectionView;
     NSDictionary *layoutMetrics = [self snapshotMetrics];
@@ -778,25 +1490,38 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 	NSUInteger sectionIndex = AAPLGridLayoutGetIndices(indexPath, &itemIndex, NO);
 
     AAPLGridLayoutSectionInfo *sectionInfo = [self sectionInfoForSectionAtIndex:sectionIndex];
-    AAPLGridLayoutItemInfo *itemInfo = sectionInfo.items[itemIndex];
+    if (itemIndex >= sectionInfo.numberOfItems)
+        return;
 
     UICollectionView *collectionView = self.collectionView;
 
     // This call really only makes sense if the section has variable height rows…
-    CGRect rect = itemInfo.frame;
+    CGRect rect = [sectionInfo frameForItemAtIndex:itemIndex];
     CGSize fittingSize = CGSizeMake(sectionInfo.columnWidth, UILayoutFittingExpandedSize.height);
 
     // This is really only going to work if it's an AAPLCollectionViewCell, but we'll pretend
     UICollectionViewCell *cell = [collectionView cellForItemAtIndexPath:indexPath];
     rect.size = [cell aapl_preferredLayoutSizeFittingSize:fittingSize];
-    itemInfo.frame = rect;
+    [sectionInfo setHeight:CGRectGetHeight(rect) forItemAtIndex:itemIndex];
+
+    // Keep the cache in step with the new measurement
+    AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
+    if ([dataSource isKindOfClass:[AAPLDataSource class]]) {
+        id<NSCopying> identifier = [dataSource collectionView:collectionView measurementIdentifierForItemAtIndexPath:indexPath];
+        if (identifier) {
+            NSUInteger version = [dataSource collectionView:collectionView measurementVersionForItemAtIndexPath:indexPath];
+            [_measurementCache setHeight:CGRectGetHeight(rect) forIdentifier:identifier width:fittingSize.width version:version];
+        }
+    }
 
     AAPLGridLayoutInvalidationContext *context = [[AAPLGridLayoutInvalidationContext alloc] init];
     context.invalidateLayoutMetrics = YES;
+    context.invalidatedSections = [NSIndexSet indexSetWithIndex:sectionIndex];
     [self invalidateLayoutWithContext:context];
 }
 
-- (void)addLayoutAttributesForSection:(AAPLGridLayoutSectionInfo *)section atIndex:(NSInteger)sectionIndex dataSource:(AAPLDataSource *)dataSource
+/// Create the attributes for a section. They aren't sorted: the section's layout index orders them by position, and nothing else depends on their order. The attributes are registered for lookup by index path, but it's up to the caller to add them to the layout attributes. Attributes for items and row separators are created on demand rather than here.
+- (NSArray *)createLayoutAttributesForSection:(AAPLGridLayoutSectionInfo *)section atIndex:(NSInteger)sectionIndex dataSource:(AAPLDataSource *)dataSource
 {
 	UICollectionView *collectionView = self.collectionView;
 
@@ -806,9 +1531,8 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     BOOL globalSection = (AAPLGlobalSection == sectionIndex);
 
-    UIColor *separatorColor = section.separatorColor;
     UIColor *sectionSeparatorColor = section.sectionSeparatorColor;
-    NSInteger numberOfItems = [section.items count];
+    NSUInteger numberOfItems = section.numberOfItems;
 
 	const CGFloat hairline = collectionView.aapl_hairlineWidth;
 
@@ -831,8 +1555,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
         [newAttributes addObject:backgroundAttribute];
 
         section.backgroundAttribute = backgroundAttribute;
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:AAPLGridLayoutGlobalHeaderBackgroundKind];
-        _indexPathKindToDecorationAttributes[indexPathKind] = backgroundAttribute;
+        AAPLGridLayoutSetElementAttributes(_decorationAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindGlobalHeaderBackground, indexPath), backgroundAttribute);
     }
 
 	NSArray *headers = section.supplementalItemArraysByKind[UICollectionElementKindSectionHeader], *footers = section.supplementalItemArraysByKind[UICollectionElementKindSectionFooter];
@@ -861,14 +1584,12 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
         if (header.shouldPin) {
             [section.pinnableHeaderAttributes addObject:headerAttribute];
-            [self.pinnableAttributes addObject:headerAttribute];
         }
         else if (globalSection) {
             [section.nonPinnableHeaderAttributes addObject:headerAttribute];
         }
 
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:UICollectionElementKindSectionHeader];
-        _indexPathKindToSupplementaryAttributes[indexPathKind] = headerAttribute;
+        AAPLGridLayoutSetElementAttributes(_supplementaryAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindHeader, indexPath), headerAttribute);
     }];
 
     AAPLCollectionViewGridLayoutAttributes *lastAttribute = [newAttributes lastObject];
@@ -880,8 +1601,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 		separatorAttributes.zIndex = AAPLGridLayoutZIndexSeparator;
         [newAttributes addObject:separatorAttributes];
 
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:AAPLGridLayoutSectionSeparatorKind];
-        _indexPathKindToDecorationAttributes[indexPathKind] = separatorAttributes;
+        AAPLGridLayoutSetElementAttributes(_decorationAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindSectionSeparator, indexPath), separatorAttributes);
     }
 
     AAPLGridLayoutSupplementalItemInfo *placeholder = section.placeholder;
@@ -892,43 +1612,14 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 		placeholderAttribute.zIndex = AAPLGridLayoutZIndexPlaceholder;
         [newAttributes addObject:placeholderAttribute];
 
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:AAPLCollectionElementKindPlaceholder];
-        _indexPathKindToSupplementaryAttributes[indexPathKind] = placeholderAttribute;
+        AAPLGridLayoutSetElementAttributes(_supplementaryAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindPlaceholder, indexPath), placeholderAttribute);
     }
 
-	_totalNumberOfItems += section.items.count;
-
-	[section.items enumerateObjectsUsingBlock:^(AAPLGridLayoutItemInfo *item, NSUInteger itemIndex, BOOL *stop) {
-		CGRect frame = item.frame;
-
-		// If there's a separator, add it above the current row…
-		if (itemIndex && separatorColor) {
-			NSIndexPath *indexPath = [NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex];
-			AAPLCollectionViewGridLayoutAttributes *separatorAttributes = [attributeClass layoutAttributesForDecorationViewOfKind:AAPLGridLayoutRowSeparatorKind withIndexPath:indexPath];
-			separatorAttributes.frame = CGRectMake(section.separatorInsets.left, CGRectGetMinY(frame), CGRectGetWidth(frame) - section.separatorInsets.left - section.separatorInsets.right, hairline);
-			separatorAttributes.backgroundColor = separatorColor;
-			separatorAttributes.zIndex = AAPLGridLayoutZIndexSeparator;
-			[newAttributes addObject:separatorAttributes];
-
-			AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:AAPLGridLayoutRowSeparatorKind];
-			_indexPathKindToDecorationAttributes[indexPathKind] = separatorAttributes;
-		}
-
-		NSIndexPath *indexPath = [NSIndexPath indexPathForItem:itemIndex++ inSection:sectionIndex];
-		AAPLCollectionViewGridLayoutAttributes *newAttribute = [attributeClass layoutAttributesForCellWithIndexPath:indexPath];
-		newAttribute.frame = frame;
-		newAttribute.zIndex = AAPLGridLayoutZIndexDefault;
-		newAttribute.backgroundColor = section.backgroundColor;
-		newAttribute.selectedBackgroundColor = section.selectedBackgroundColor;
-		newAttribute.hidden = [dataSource collectionView:collectionView itemAtIndexPathIsHidden:indexPath];
-
-		[newAttributes addObject:newAttribute];
-
-		_indexPathToItemAttributes[indexPath] = newAttribute;
-	}];
+	_totalNumberOfItems += numberOfItems;
 
 	[section enumerateArraysOfOtherSupplementalItems:^(NSString *kind, NSArray *obj, BOOL *stop) {
 		NSUInteger index = 0;
+		uint32_t kindID = [self elementKindIDForKind:kind];
 
 		for (AAPLGridLayoutSupplementalItemInfo *item in obj) {
 			// ignore headers if there are no items and the header isn't a global header
@@ -945,8 +1636,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 			itemAttribute.hidden = NO;
 			[newAttributes addObject:itemAttribute];
 
-			AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:kind];
-			_indexPathKindToSupplementaryAttributes[indexPathKind] = itemAttribute;
+			AAPLGridLayoutSetElementAttributes(_supplementaryAttributes, AAPLGridLayoutElementKeyMake(kindID, indexPath), itemAttribute);
 		}
 	}];
 
@@ -965,11 +1655,10 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
         footerAttribute.hidden = NO;
         [newAttributes addObject:footerAttribute];
 
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:UICollectionElementKindSectionFooter];
-        _indexPathKindToSupplementaryAttributes[indexPathKind] = footerAttribute;
+        AAPLGridLayoutSetElementAttributes(_supplementaryAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindFooter, indexPath), footerAttribute);
     }];
 
-    NSUInteger numberOfSections = [_layoutInfo.sections count];
+    NSUInteger numberOfSections = _layoutInfo.numberOfSections;
 
     // Add the section separator below this section provided it's not the last section (or if the section explicitly says to)
     if (sectionSeparatorColor && _totalNumberOfItems && (sectionIndex + 1 < numberOfSections || section.showsSectionSeparatorWhenLastSection)) {
@@ -980,42 +1669,142 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 		separatorAttributes.zIndex = AAPLGridLayoutZIndexSeparator;
         [newAttributes addObject:separatorAttributes];
 
-        AAPLIndexPathKind *indexPathKind = [[AAPLIndexPathKind alloc] initWithIndexPath:indexPath kind:AAPLGridLayoutSectionSeparatorKind];
-        _indexPathKindToDecorationAttributes[indexPathKind] = separatorAttributes;
+        AAPLGridLayoutSetElementAttributes(_decorationAttributes, AAPLGridLayoutElementKeyMake(AAPLGridLayoutElementKindSectionSeparator, indexPath), separatorAttributes);
 	}
-	
-	[newAttributes sortWithOptions:NSSortConcurrent|NSSortStable usingComparator:^(AAPLCollectionViewGridLayoutAttributes *obj1, AAPLCollectionViewGridLayoutAttributes *obj2) {
-		CGRect frame1 = obj1.frame, frame2 = obj2.frame;
-		
-		CGFloat max1 = CGRectGetMaxY(frame1), max2 = CGRectGetMaxY(frame2);
-		
-		if (max1 > max2) {
-			return NSOrderedDescending;
-		} else if (max1 < max2) {
-			return NSOrderedAscending;
-		}
-		
-		NSInteger z1 = obj1.zIndex;
-		NSInteger z2 = obj2.zIndex;
-		
-		if (z1 > z2) {
-			return NSOrderedAscending;
-		} else if (z1 < z2) {
-			return NSOrderedAscending;
-		}
-		
-		CGFloat min1 = CGRectGetMinY(frame1), min2 = CGRectGetMinY(frame2);
-		
-		if (min1 > max2) {
-			return NSOrderedAscending;
-		} else if (min1 < min2)  {
-			return NSOrderedDescending;
-		}
-		
-		return NSOrderedSame;
-	}];
 
-	[_layoutAttributes addObjectsFromArray:newAttributes];
+    // The next section starts below the lowest element of this one, including the items that don't have attributes yet
+    CGFloat contentMaxY = CGRectGetMinY(sectionFrame);
+    if (numberOfItems)
+        contentMaxY = CGRectGetMaxY([section frameForItemAtIndex:numberOfItems - 1]);
+    for (AAPLCollectionViewGridLayoutAttributes *attributes in newAttributes)
+        contentMaxY = MAX(contentMaxY, CGRectGetMaxY(attributes.frame));
+    section.contentMaxY = contentMaxY;
+
+	return newAttributes;
+}
+
+/// The position where a section starts: the bottom of the section before it, or of the global section for the first section
+- (CGFloat)contentMaxYBeforeSectionAtIndex:(NSUInteger)sectionIndex
+{
+    AAPLGridLayoutSectionInfo *previousSection = sectionIndex ? [self sectionInfoForSectionAtIndex:sectionIndex - 1] : [self sectionInfoForSectionAtIndex:AAPLGlobalSection];
+    return previousSection ? previousSection.contentMaxY : 0;
+}
+
+- (void)addLayoutAttributesForSection:(AAPLGridLayoutSectionInfo *)section atIndex:(NSInteger)sectionIndex dataSource:(AAPLDataSource *)dataSource
+{
+    NSArray *newAttributes = [self createLayoutAttributesForSection:section atIndex:sectionIndex dataSource:dataSource];
+    section.layoutAttributesRange = NSMakeRange([_layoutAttributes count], [newAttributes count]);
+    [_layoutAttributes addObjectsFromArray:newAttributes];
+    [self updateLayoutIndexForSection:section];
+}
+
+/// Recompute the invalidated sections in place. Sections before the first invalidated section are left alone and sections after it that weren't invalidated are only moved by the change in height.
+- (void)updateLayoutAttributesForInvalidatedSections:(NSIndexSet *)invalidatedSections dataSource:(AAPLDataSource *)dataSource measureItem:(CGSize(^)(NSIndexPath *, CGRect))measureItemBlock measureSupplementaryItem:(CGSize(^)(NSString *, NSIndexPath *, CGRect))measureSupplementaryItemBlock
+{
+    NSUInteger numberOfSections = [self.collectionView numberOfSections];
+    NSUInteger firstSectionIndex = [invalidatedSections firstIndex];
+
+    // Shifting needs the unpinned positions
+    [self resetPinnedAttributes];
+
+    self.totalNumberOfItems = 0;
+    for (NSUInteger sectionIndex = 0; sectionIndex < firstSectionIndex && sectionIndex < numberOfSections; ++sectionIndex)
+        _totalNumberOfItems += [self sectionInfoForSectionAtIndex:sectionIndex].numberOfItems;
+
+    CGFloat deltaY = 0;
+    NSInteger deltaCount = 0;
+
+    // The number of sections can't change without the layout data being invalidated
+    NSAssert(_numberOfSectionExtents == numberOfSections, @"Section extents are out of date");
+
+    for (NSUInteger sectionIndex = firstSectionIndex; sectionIndex < numberOfSections; ++sectionIndex) {
+        AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:sectionIndex];
+        NSRange range = section.layoutAttributesRange;
+        range.location += deltaCount;
+
+        // The height of a placeholder depends on where it starts, so those always need to be recomputed
+        if (![invalidatedSections containsIndex:sectionIndex] && !section.placeholder) {
+            section.layoutAttributesRange = range;
+            _totalNumberOfItems += section.numberOfItems;
+            if (!deltaY)
+                continue;
+
+            // The section's index holds positions within its range, so moving the range leaves it valid, and moving the attributes only needs an offset
+            [section offsetFramesByY:deltaY];
+            AAPLLayoutIndexOffsetEntries(section.layoutIndex, deltaY);
+            _sectionExtents[sectionIndex] = AAPLGridLayoutSectionExtentMake(section);
+            for (NSUInteger position = range.location; position < NSMaxRange(range); ++position) {
+                AAPLCollectionViewGridLayoutAttributes *attributes = _layoutAttributes[position];
+                attributes.frame = CGRectOffset(attributes.frame, 0, deltaY);
+                if ([attributes.representedElementKind isEqualToString:UICollectionElementKindSectionHeader])
+                    attributes.unpinnedY += deltaY;
+            }
+            continue;
+        }
+
+        CGPoint origin = CGPointMake(0, [self contentMaxYBeforeSectionAtIndex:sectionIndex]);
+
+        // The next section starts at the bottom of this one, so that's what the sections below need to move by
+        CGFloat oldMaxY = section.contentMaxY + deltaY;
+
+        [self measureItemsInSection:section atIndex:sectionIndex dataSource:dataSource];
+        [section computeLayoutForSection:sectionIndex origin:origin measureItem:measureItemBlock measureSupplementaryItem:measureSupplementaryItemBlock];
+        NSArray *newAttributes = [self createLayoutAttributesForSection:section atIndex:sectionIndex dataSource:dataSource];
+        [_layoutAttributes replaceObjectsInRange:range withObjectsFromArray:newAttributes];
+
+        NSUInteger count = [newAttributes count];
+        section.layoutAttributesRange = NSMakeRange(range.location, count);
+        deltaCount += (NSInteger)count - (NSInteger)range.length;
+        [self updateLayoutIndexForSection:section];
+        _sectionExtents[sectionIndex] = AAPLGridLayoutSectionExtentMake(section);
+
+        deltaY += section.contentMaxY - oldMaxY;
+    }
+}
+
+/// Index the attributes of a section other than its pinnable headers, which move with the content offset
+- (void)updateLayoutIndexForSection:(AAPLGridLayoutSectionInfo *)section
+{
+    AAPLLayoutIndexRef layoutIndex = section.layoutIndex;
+    AAPLLayoutIndexRemoveAllEntries(layoutIndex);
+
+    NSArray *pinnableHeaderAttributes = section.pinnableHeaderAttributes;
+    NSHashTable *pinnableHeaders = nil;
+    if ([pinnableHeaderAttributes count]) {
+        pinnableHeaders = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+        for (AAPLCollectionViewGridLayoutAttributes *attributes in pinnableHeaderAttributes)
+            [pinnableHeaders addObject:attributes];
+    }
+
+    NSRange range = section.layoutAttributesRange;
+    for (NSUInteger position = range.location; position < NSMaxRange(range); ++position) {
+        AAPLCollectionViewGridLayoutAttributes *attributes = _layoutAttributes[position];
+        if ([pinnableHeaders containsObject:attributes])
+            continue;
+
+        CGRect frame = attributes.frame;
+        AAPLLayoutIndexAddEntry(layoutIndex, CGRectGetMinY(frame), CGRectGetMaxY(frame), position - range.location);
+    }
+
+    AAPLLayoutIndexFinalize(layoutIndex);
+}
+
+/// Collect the section extents and the attributes that move with the content offset once every section has been laid out
+- (void)updateSectionFrames
+{
+    [self.floatingAttributes removeAllObjects];
+
+    // All of the global section's attributes float with the content offset
+    AAPLGridLayoutSectionInfo *globalSection = [self sectionInfoForSectionAtIndex:AAPLGlobalSection];
+    if (globalSection)
+        [self.floatingAttributes addObjectsFromArray:[_layoutAttributes subarrayWithRange:globalSection.layoutAttributesRange]];
+
+    NSUInteger numberOfSections = [self.collectionView numberOfSections];
+    _sectionExtents = realloc(_sectionExtents, MAX(numberOfSections, 1) * sizeof(AAPLGridLayoutSectionExtent));
+    _numberOfSectionExtents = numberOfSections;
+
+    for (NSUInteger sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex)
+        _sectionExtents[sectionIndex] = AAPLGridLayoutSectionExtentMake([self sectionInfoForSectionAtIndex:sectionIndex]);
 }
 
 - (CGFloat)heightOfAttributes:(NSArray *)attributes
@@ -1046,6 +1835,10 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     [self updateFlagsFromCollectionView];
 
+    // Only the invalidated sections need to be recomputed if nothing else about the layout has changed
+    BOOL updateInvalidatedSections = _flags.layoutDataIsValid && _flags.layoutMetricsArePartiallyValid;
+    _flags.layoutMetricsArePartiallyValid = NO;
+
     if (!_flags.layoutDataIsValid) {
         [self createLayoutInfoFromDataSource];
         _flags.layoutDataIsValid = YES;
@@ -1063,10 +1856,6 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 	CGPoint origin = CGPointZero;
 
-    [self.layoutAttributes removeAllObjects];
-    [self.pinnableAttributes removeAllObjects];
-    self.totalNumberOfItems = 0;
-
     AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
     if (![dataSource isKindOfClass:[AAPLDataSource class]])
         dataSource = nil;
@@ -1075,39 +1864,51 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     __block BOOL shouldInvalidate = NO;
 
+    CGSize (^measureItem)(NSIndexPath *, CGRect) = ^(NSIndexPath *indexPath, CGRect frame) {
+        return [self measureItemAtIndexPath:indexPath fittingSize:frame.size dataSource:dataSource];
+    };
+    CGSize (^measureSupplementaryItem)(NSString *, NSIndexPath *, CGRect) = ^(NSString *kind, NSIndexPath *indexPath, CGRect frame) {
+        shouldInvalidate |= YES;
+        return [self measureSupplementalItemOfKind:kind atIndexPath:indexPath];
+    };
+
     CGFloat globalNonPinningHeight = 0;
     AAPLGridLayoutSectionInfo *globalSection = [self sectionInfoForSectionAtIndex:AAPLGlobalSection];
-    if (globalSection) {
-		[globalSection computeLayoutForSection:AAPLGlobalSection origin:origin measureItem:NULL measureSupplementaryItem:^(NSString *kind, NSIndexPath *indexPath, CGRect frame) {
-			shouldInvalidate |= YES;
-			return [self measureSupplementalItemOfKind:kind atIndexPath:indexPath];
-		}];
-		[self addLayoutAttributesForSection:globalSection atIndex:AAPLGlobalSection dataSource:dataSource];
+
+    if (updateInvalidatedSections) {
+        [self updateLayoutAttributesForInvalidatedSections:self.invalidatedSections dataSource:dataSource measureItem:measureItem measureSupplementaryItem:measureSupplementaryItem];
         globalNonPinningHeight = [self heightOfAttributes:globalSection.nonPinnableHeaderAttributes];
     }
+    else {
+        [self.layoutAttributes removeAllObjects];
+        self.totalNumberOfItems = 0;
+        // The headers are all new, and the old ones stay where they were for update animations
+        _pinnedSection = nil;
+
+        if (globalSection) {
+            [globalSection computeLayoutForSection:AAPLGlobalSection origin:origin measureItem:NULL measureSupplementaryItem:measureSupplementaryItem];
+            [self addLayoutAttributesForSection:globalSection atIndex:AAPLGlobalSection dataSource:dataSource];
+            globalNonPinningHeight = [self heightOfAttributes:globalSection.nonPinnableHeaderAttributes];
+        }
 
-    for (NSInteger sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex) {
-        AAPLCollectionViewGridLayoutAttributes *attributes = [_layoutAttributes lastObject];
-		if (attributes) {
-			origin.y = CGRectGetMaxY(attributes.frame);
-		}
-        AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:sectionIndex];
-		[section computeLayoutForSection:sectionIndex origin:origin measureItem:^(NSIndexPath *indexPath, CGRect frame) {
-			return [dataSource collectionView:collectionView sizeFittingSize:frame.size forItemAtIndexPath:indexPath];
-		} measureSupplementaryItem:^(NSString *kind, NSIndexPath *indexPath, CGRect frame) {
-			shouldInvalidate |= YES;
-			return [self measureSupplementalItemOfKind:kind atIndexPath:indexPath];
-		}];
+        for (NSInteger sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex) {
+            origin.y = [self contentMaxYBeforeSectionAtIndex:sectionIndex];
+            AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:sectionIndex];
+            [self measureItemsInSection:section atIndex:sectionIndex dataSource:dataSource];
+            [section computeLayoutForSection:sectionIndex origin:origin measureItem:measureItem measureSupplementaryItem:measureSupplementaryItem];
+            [self addLayoutAttributesForSection:section atIndex:sectionIndex dataSource:dataSource];
+        }
 
-		[self addLayoutAttributesForSection:section atIndex:sectionIndex dataSource:dataSource];
+        [self updateSectionFrames];
     }
 
-	AAPLCollectionViewGridLayoutAttributes *attributes = [_layoutAttributes lastObject];
-	if (attributes) {
-		size.height = CGRectGetMaxY(attributes.frame);
-	} else {
-		size.height = origin.y;
-	}
+    [self.invalidatedSections removeAllIndexes];
+
+    // Items and row separators created for the previous build no longer match the section info
+    [_indexPathToItemAttributes removeAllObjects];
+    [_indexPathToRowSeparatorAttributes removeAllObjects];
+
+	size.height = [self contentMaxYBeforeSectionAtIndex:numberOfSections];
 
 	if (_layoutInfo.contentOffsetY >= globalNonPinningHeight && size.height - globalNonPinningHeight < size.height) {
 		size.height += globalNonPinningHeight;
@@ -1115,6 +1916,7 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
 	_layoutSize = size;
 
+    _flags.pinnedAttributesAreValid = NO;
     [self filterSpecialAttributes];
 
     _flags.layoutMetricsAreValid = YES;
@@ -1174,22 +1976,126 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
     }];
 }
 
-- (AAPLGridLayoutSectionInfo *)firstSectionOverlappingYOffset:(CGFloat)yOffset
+/// Add the items in the rect that aren't visible to the array, in the order scrolling will reach them
+- (void)addPrefetchIndexPathsInRect:(CGRect)rect visibleRect:(CGRect)visibleRect toArray:(NSMutableArray *)indexPaths
 {
-    __block AAPLGridLayoutSectionInfo *result = nil;
+    NSMutableArray *indexPathsInRect = [NSMutableArray array];
+    [self enumerateItemsInRect:rect usingBlock:^(AAPLGridLayoutSectionInfo *section, NSUInteger sectionIndex, NSUInteger itemIndex) {
+        if (!CGRectIntersectsRect([section frameForItemAtIndex:itemIndex], visibleRect))
+            [indexPathsInRect addObject:[NSIndexPath indexPathForItem:itemIndex inSection:sectionIndex]];
+    }];
 
-    [_layoutInfo.sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *sectionIndex, AAPLGridLayoutSectionInfo *sectionInfo, BOOL *stop) {
-        if (AAPLGlobalSection == [sectionIndex unsignedIntegerValue])
-            return;
+    if (_prefetchDirection > 0)
+        [indexPaths addObjectsFromArray:indexPathsInRect];
+    else
+        [indexPaths addObjectsFromArray:[[indexPathsInRect reverseObjectEnumerator] allObjects]];
+}
 
-        CGRect frame = sectionInfo.frame;
-        if (CGRectGetMinY(frame) <= yOffset && yOffset <= CGRectGetMaxY(frame)) {
-            result = sectionInfo;
-            *stop = YES;
-        }
-    }];
+/// Tell the data source about items that are about to scroll into view, and the ones that no longer are. Items are prefetched up to a screen ahead of the visible rect in the direction of scrolling. During a fling, the screen where it will come to rest is prefetched as well.
+- (void)updatePrefetchedItems
+{
+    UICollectionView *collectionView = self.collectionView;
+    AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
+    if (![dataSource isKindOfClass:[AAPLDataSource class]])
+        return;
 
-    return result;
+    CGRect visibleRect = collectionView.bounds;
+    CGFloat height = CGRectGetHeight(visibleRect);
+    CGFloat boundsY = CGRectGetMinY(visibleRect);
+    if (height <= 0)
+        return;
+
+    CGFloat distance = boundsY - _prefetchBoundsY;
+    if (_flags.prefetchedItemsAreValid && fabs(distance) < height * AAPLGridLayoutPrefetchGranularity)
+        return;
+
+    if (distance)
+        _prefetchDirection = (distance > 0 ? 1 : -1);
+    _prefetchBoundsY = boundsY;
+    _flags.prefetchedItemsAreValid = YES;
+
+    // Once scrolling reaches the resting place of a fling or turns around, the fling no longer says where it's headed
+    if (!isnan(_prefetchTargetY) && (_prefetchTargetY - boundsY) * _prefetchDirection <= 0)
+        _prefetchTargetY = NAN;
+
+    NSMutableArray *indexPaths = [NSMutableArray array];
+    CGFloat lookahead = height * AAPLGridLayoutPrefetchScreens;
+
+    CGRect aheadRect = visibleRect;
+    aheadRect.size.height = lookahead;
+    aheadRect.origin.y = (_prefetchDirection > 0 ? CGRectGetMaxY(visibleRect) : boundsY - lookahead);
+    [self addPrefetchIndexPathsInRect:aheadRect visibleRect:visibleRect toArray:indexPaths];
+
+    // Skip what the fling passes over on its way
+    if (!isnan(_prefetchTargetY)) {
+        CGRect targetRect = visibleRect;
+        targetRect.origin.y = _prefetchTargetY;
+        if (!CGRectIntersectsRect(targetRect, aheadRect))
+            [self addPrefetchIndexPathsInRect:targetRect visibleRect:visibleRect toArray:indexPaths];
+    }
+
+    NSSet *prefetchIndexPaths = [NSSet setWithArray:indexPaths];
+
+    // Items that scrolled into view stay loaded, the rest are cancelled
+    NSMutableArray *cancelledIndexPaths = [NSMutableArray array];
+    for (NSIndexPath *indexPath in _prefetchedIndexPaths) {
+        if ([prefetchIndexPaths containsObject:indexPath])
+            continue;
+
+        AAPLGridLayoutSectionInfo *section = [_layoutInfo sectionAtIndex:indexPath.section];
+        if ((NSUInteger)indexPath.item < section.numberOfItems && CGRectIntersectsRect([section frameForItemAtIndex:indexPath.item], visibleRect))
+            continue;
+        [cancelledIndexPaths addObject:indexPath];
+    }
+
+    NSMutableArray *newIndexPaths = [NSMutableArray array];
+    for (NSIndexPath *indexPath in indexPaths) {
+        if (![_prefetchedIndexPaths containsObject:indexPath])
+            [newIndexPaths addObject:indexPath];
+    }
+
+    [_prefetchedIndexPaths setSet:prefetchIndexPaths];
+
+    if (cancelledIndexPaths.count)
+        [dataSource collectionView:collectionView cancelPrefetchingForItemsAtIndexPaths:cancelledIndexPaths];
+    if (newIndexPaths.count)
+        [dataSource collectionView:collectionView prefetchItemsAtIndexPaths:newIndexPaths];
+}
+
+/// The index of the first section whose extent reaches down to the position, or the number of sections if there is none. Until the extents have been collected for the current layout, this is 0, so callers fall back to checking every section.
+- (NSUInteger)indexOfFirstSectionReachingY:(CGFloat)y
+{
+    if (_numberOfSectionExtents != _layoutInfo.numberOfSections)
+        return 0;
+
+    NSUInteger low = 0, high = _numberOfSectionExtents;
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (_sectionExtents[middle].maxY < y)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+- (AAPLGridLayoutSectionInfo *)firstSectionOverlappingYOffset:(CGFloat)yOffset
+{
+    if (_numberOfSectionExtents != _layoutInfo.numberOfSections)
+        return nil;
+
+    NSUInteger sectionIndex = [self indexOfFirstSectionReachingY:yOffset];
+    if (sectionIndex == _numberOfSectionExtents || _sectionExtents[sectionIndex].minY > yOffset)
+        return nil;
+    return [self sectionInfoForSectionAtIndex:sectionIndex];
+}
+
+/// Put back the headers that may have been pinned
+- (void)resetPinnedAttributes
+{
+    [self resetPinnableAttributes:[self sectionInfoForSectionAtIndex:AAPLGlobalSection].pinnableHeaderAttributes];
+    [self resetPinnableAttributes:_pinnedSection.pinnableHeaderAttributes];
+    _pinnedSection = nil;
 }
 
 - (void)filterSpecialAttributes
@@ -1209,12 +2115,20 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     CGFloat pinnableY = contentOffset.y + collectionView.contentInset.top;
     CGFloat nonPinnableY = pinnableY;
+    CGFloat boundsY = collectionView.bounds.origin.y;
 
-    [self resetPinnableAttributes:self.pinnableAttributes];
+    // Nothing to do if the pinned attributes were already positioned for this offset
+    if (_flags.pinnedAttributesAreValid && pinnableY == _pinnedY && boundsY == _pinnedBoundsY)
+        return;
+
+    _pinnedY = pinnableY;
+    _pinnedBoundsY = boundsY;
+    _flags.pinnedAttributesAreValid = YES;
 
     // Pin the headers as appropriate
     AAPLGridLayoutSectionInfo *section = [self sectionInfoForSectionAtIndex:AAPLGlobalSection];
     if (section.pinnableHeaderAttributes) {
+        [self resetPinnableAttributes:section.pinnableHeaderAttributes];
         pinnableY = [self applyTopPinningToAttributes:section.pinnableHeaderAttributes minY:pinnableY];
 		[self finalizePinnedAttributes:section.pinnableHeaderAttributes zIndex:AAPLGridLayoutZIndexPinned];
     }
@@ -1227,14 +2141,20 @@ static inline NSUInteger AAPLGridLayoutGetIndices(NSIndexPath *indexPath, NSUInt
 
     if (section.backgroundAttribute) {
         CGRect frame = section.backgroundAttribute.frame;
-        frame.origin.y = MIN(nonPinnableY, collectionView.bounds.origin.y);
+        frame.origin.y = MIN(nonPinnableY, boundsY);
         CGFloat bottomY = MAX(CGRectGetMaxY([[section.pinnableHeaderAttributes lastObject] frame]), CGRectGetMaxY([[section.nonPinnableHeaderAttributes lastObject] frame]));
         frame.size.height =  bottomY - frame.origin.y;
         section.backgroundAttribute.frame = frame;
     }
 
+    // Only the headers of the section under the pinned global headers pin, so the section that was there before is the only other one that needs putting back
     AAPLGridLayoutSectionInfo *overlappingSection = [self firstSectionOverlappingYOffset:pinnableY];
+    if (_pinnedSection != overlappingSection)
+        [self resetPinnableAttributes:_pinnedSection.pinnableHeaderAttributes];
+    _pinnedSection = overlappingSection;
+
     if (overlappingSection) {
+        [self resetPinnableAttributes:overlappingSection.pinnableHeaderAttributes];
         [self applyTopPinningToAttributes:overlappingSection.pinnableHeaderAttributes minY:pinnableY];
 		[self finalizePinnedAttributes:overlappingSection.pinnableHeaderAttributes zIndex:AAPLGridLayoutZIndexPinnedOverlap];
     };
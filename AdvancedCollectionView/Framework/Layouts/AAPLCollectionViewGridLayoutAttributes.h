@@ -17,6 +17,12 @@
 @property (nonatomic) UIEdgeInsets padding;
 /// Y offset when not pinned
 @property (nonatomic) CGFloat unpinnedY;
+/// Used by row separator bands: the offsets from the top of the frame of each separator in the band, numberOfSeparatorOffsets of them
+@property (nonatomic, readonly) const CGFloat *separatorOffsets;
+@property (nonatomic, readonly) NSUInteger numberOfSeparatorOffsets;
+
+/// Copies the offsets into one buffer, which copies of these attributes share
+- (void)setSeparatorOffsets:(const CGFloat *)separatorOffsets count:(NSUInteger)count;
 
 @end
 
@@ -26,4 +32,7 @@
 @property (nonatomic) BOOL invalidateLayoutMetrics;
 @property (nonatomic) BOOL invalidateLayoutOrigin;
 
+/// The sections whose metrics changed. When set along with invalidateLayoutMetrics, sections before the first of these keep their layout, these sections are recomputed, and the remaining sections are only moved by the change in height. When nil (the default), every section is recomputed.
+@property (nonatomic, copy) NSIndexSet *invalidatedSections;
+
 @end
@@ -5,7 +5,25 @@
 
 #import "AAPLCollectionViewGridLayoutAttributes.h"
 
-@implementation AAPLCollectionViewGridLayoutAttributes
+@implementation AAPLCollectionViewGridLayoutAttributes {
+    /// The separator offsets as CGFloats. Immutable, so copies share it.
+    NSData *_separatorOffsetData;
+}
+
+- (const CGFloat *)separatorOffsets
+{
+    return _separatorOffsetData.bytes;
+}
+
+- (NSUInteger)numberOfSeparatorOffsets
+{
+    return _separatorOffsetData.length / sizeof(CGFloat);
+}
+
+- (void)setSeparatorOffsets:(const CGFloat *)separatorOffsets count:(NSUInteger)count
+{
+    _separatorOffsetData = (count ? [NSData dataWithBytes:separatorOffsets length:count * sizeof(CGFloat)] : nil);
+}
 
 - (NSUInteger)hash
 {
@@ -20,6 +38,7 @@
     result = (NSUInteger)(prime * result + _padding.left);
     result = (NSUInteger)(prime * result + _padding.bottom);
     result = (NSUInteger)(prime * result + _padding.right);
+    result = prime * result + [_separatorOffsetData hash];
 
 	return result;
 }
@@ -42,6 +61,9 @@
     if (_selectedBackgroundColor != other->_selectedBackgroundColor && ![_selectedBackgroundColor isEqual:other->_selectedBackgroundColor])
         return NO;
 
+    if (_separatorOffsetData != other->_separatorOffsetData && ![_separatorOffsetData isEqualToData:other->_separatorOffsetData])
+        return NO;
+
 	return UIEdgeInsetsEqualToEdgeInsets(_padding, other->_padding);
 }
 
@@ -54,6 +76,7 @@
     attributes->_selectedBackgroundColor = _selectedBackgroundColor;
     attributes->_padding = _padding;
     attributes->_unpinnedY = _unpinnedY;
+    attributes->_separatorOffsetData = _separatorOffsetData;
     return attributes;
 }
 
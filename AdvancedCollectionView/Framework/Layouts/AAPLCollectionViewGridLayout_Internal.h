@@ -6,7 +6,9 @@
 #import "AAPLCollectionViewGridLayout.h"
 #import "AAPLCollectionViewGridLayoutAttributes.h"
 #import "AAPLDataSourceDelegate.h"
+#import "AAPLLayoutIndex.h"
 #import "AAPLLayoutMetrics.h"
+#import "AAPLUniformItems.h"
 
 typedef CGSize (^AAPLLayoutMeasureBlock)(NSUInteger itemIndex, CGRect frame);
 typedef CGSize (^AAPLLayoutMeasureKindBlock)(NSString *kind, NSUInteger itemIndex, CGRect frame);
@@ -27,20 +29,27 @@ typedef CGSize (^AAPLLayoutMeasureKindBlock)(NSString *kind, NSUInteger itemInde
 
 @end
 
-/// Layout information about an item (cell)
-@interface AAPLGridLayoutItemInfo : NSObject
+/// Per item flags stored alongside the item frames of a section
+typedef uint8_t AAPLGridLayoutItemFlags;
 
-@property (nonatomic) CGRect frame;
-@property (nonatomic) BOOL needSizeUpdate;
-
-@end
+enum {
+    /// The item has a variable height and hasn't been measured yet
+    AAPLGridLayoutItemFlagNeedSizeUpdate = 1 << 0,
+};
 
 /// Layout information for a section
 @interface AAPLGridLayoutSectionInfo : NSObject
 @property (nonatomic) CGRect frame;
 @property (nonatomic, weak) AAPLGridLayoutInfo *layoutInfo;
 
-@property (nonatomic, readonly) NSMutableArray *items;
+/// The number of items in the section. Items don't get an object each; their frames and flags are stored in contiguous arrays, or not at all for a uniform section.
+@property (nonatomic, readonly) NSUInteger numberOfItems;
+/// Whether the items all have the same fixed height, apart from any that were remeasured. A uniform section keeps no per item storage: item frames are computed from the item index and only remeasured items are recorded.
+@property (nonatomic, readonly, getter=isUniform) BOOL uniform;
+/// The frames of the items, valid for numberOfItems entries. NULL for a uniform section; use -frameForItemAtIndex: unless the section is known to have variable heights.
+@property (nonatomic, readonly) CGRect *itemFrames;
+/// The flags of the items, valid for numberOfItems entries. NULL for a uniform section, whose items never need a size update.
+@property (nonatomic, readonly) AAPLGridLayoutItemFlags *itemFlags;
 @property (nonatomic, readonly) NSMutableDictionary *supplementalItemArraysByKind;
 - (void)enumerateArraysOfOtherSupplementalItems:(void(^)(NSString *kind, NSArray *items, BOOL *stop))block;
 @property (nonatomic, readonly) AAPLGridLayoutSupplementalItemInfo *placeholder;
@@ -53,14 +62,33 @@ typedef CGSize (^AAPLLayoutMeasureKindBlock)(NSString *kind, NSUInteger itemInde
 @property (nonatomic, strong) UIColor *sectionSeparatorColor;
 @property (nonatomic) BOOL showsSectionSeparatorWhenLastSection;
 @property (nonatomic, readonly) CGFloat columnWidth;
+/// When non-zero, items needing a size update are laid out at their current height and measured later by the layout
+@property (nonatomic) CGFloat estimatedRowHeight;
 
 @property (nonatomic, strong) NSMutableArray *pinnableHeaderAttributes;
 @property (nonatomic, strong) NSMutableArray *nonPinnableHeaderAttributes;
 @property (nonatomic, strong) AAPLCollectionViewGridLayoutAttributes *backgroundAttribute;
+/// The range of this section's attributes within the layout's array of attributes. Items and row separators aren't included, because they are created on demand.
+@property (nonatomic) NSRange layoutAttributesRange;
+/// An index of this section's attributes by vertical extent, leaving out the pinnable headers, which move with the content offset. The values are positions within layoutAttributesRange, so the index stays valid when the range moves. Built by the layout along with the attributes.
+@property (nonatomic, readonly) AAPLLayoutIndexRef layoutIndex;
+/// The bottom of the lowest element in the section, including the items and separators. The next section starts here.
+@property (nonatomic) CGFloat contentMaxY;
 
 - (AAPLGridLayoutSupplementalItemInfo *)addSupplementalItemOfKind:(NSString *)kind;
 - (AAPLGridLayoutSupplementalItemInfo *)addSupplementalItemAsPlaceholder;
-- (AAPLGridLayoutItemInfo *)addItem;
+/// Append items that all start out with the same frame and flags. The section stays uniform while the items have no flags and share a fixed height.
+- (void)addItemsWithCount:(NSUInteger)count frame:(CGRect)frame flags:(AAPLGridLayoutItemFlags)flags;
+
+/// The frame of an item, in constant time for a uniform section without remeasured items
+- (CGRect)frameForItemAtIndex:(NSUInteger)itemIndex;
+/// Record the measured height of an item. The section must be laid out again before the items below it and the section frame are up to date.
+- (void)setHeight:(CGFloat)height forItemAtIndex:(NSUInteger)itemIndex;
+/// The index of the first item whose bottom reaches y, or numberOfItems if every item ends above it. Found by division for a uniform section without remeasured items and by binary search otherwise.
+- (NSUInteger)indexOfFirstItemReachingY:(CGFloat)y;
+
+/// Move the section and all of its items and supplementary items vertically without recomputing them
+- (void)offsetFramesByY:(CGFloat)deltaY;
 
 - (void)computeLayoutForSection:(NSUInteger)sectionIndex origin:(CGPoint)start measureItem:(CGSize(^)(NSIndexPath *, CGRect))measureItemBlock measureSupplementaryItem:(CGSize(^)(NSString *, NSIndexPath *, CGRect))measureSupplementaryItemBlock;
 
@@ -71,20 +99,14 @@ typedef CGSize (^AAPLLayoutMeasureKindBlock)(NSString *kind, NSUInteger itemInde
 
 @property (nonatomic) CGSize size;
 @property (nonatomic) CGFloat contentOffsetY;
-@property (nonatomic, strong) NSMutableDictionary *sections;
+/// The sections other than the global section, in section order
+@property (nonatomic, readonly) NSMutableArray *sections;
+@property (nonatomic, strong) AAPLGridLayoutSectionInfo *globalSection;
+@property (nonatomic, readonly) NSUInteger numberOfSections;
 
+/// Sections must be added in order. The global section may be added at any time.
 - (AAPLGridLayoutSectionInfo *)addSectionWithIndex:(NSInteger)sectionIndex;
-
-- (void)invalidate;
-
-@end
-
-/// Used to look up supplementary & decoration attributes
-@interface AAPLIndexPathKind : NSObject<NSCopying>
-
-- (instancetype)initWithIndexPath:(NSIndexPath *)indexPath kind:(NSString *)kind;
-
-@property (nonatomic, readonly) NSIndexPath *indexPath;
-@property (nonatomic, readonly) NSString *kind;
+/// Returns the section at the index, or the global section for AAPLGlobalSection. Returns nil if there is no such section.
+- (AAPLGridLayoutSectionInfo *)sectionAtIndex:(NSUInteger)sectionIndex;
 
 @end
@@ -8,10 +8,13 @@
 @implementation AAPLGridLayoutSupplementalItemInfo
 @end
 
-@implementation AAPLGridLayoutItemInfo
-@end
-
-@implementation AAPLGridLayoutSectionInfo
+@implementation AAPLGridLayoutSectionInfo {
+    NSUInteger _itemCapacity;
+    /// For a uniform section, the frame of the first item. The other items are stacked below it at the same height.
+    CGRect _uniformItemFrame;
+    /// The positions of the items of a uniform section relative to _uniformItemFrame, and the heights of those that were remeasured. NULL once the section has per item storage.
+    AAPLUniformItemsRef _uniformItems;
+}
 
 - (instancetype)init
 {
@@ -19,13 +22,23 @@
     if (!self)
         return nil;
 
-    _items = [NSMutableArray array];
 	_supplementalItemArraysByKind = [NSMutableDictionary dictionary];
     _pinnableHeaderAttributes = [NSMutableArray array];
+    _layoutIndex = AAPLLayoutIndexCreate();
+    _uniformItems = AAPLUniformItemsCreate();
+    _uniform = YES;
 
     return self;
 }
 
+- (void)dealloc
+{
+    free(_itemFrames);
+    free(_itemFlags);
+    AAPLUniformItemsRelease(_uniformItems);
+    AAPLLayoutIndexRelease(_layoutIndex);
+}
+
 - (NSMutableArray *)nonPinnableHeaderAttributes
 {
     // Lazy initialise this, because it's only used for the global section
@@ -63,11 +76,99 @@
 	}];
 }
 
-- (AAPLGridLayoutItemInfo *)addItem
+- (void)addItemsWithCount:(NSUInteger)count frame:(CGRect)frame flags:(AAPLGridLayoutItemFlags)flags
+{
+    if (!count)
+        return;
+
+    if (_uniform) {
+        CGFloat height = CGRectGetHeight(frame);
+        if (!flags && height != AAPLRowHeightRemainder && (!_numberOfItems || height == CGRectGetHeight(_uniformItemFrame))) {
+            if (!_numberOfItems)
+                _uniformItemFrame = frame;
+            _numberOfItems += count;
+            return;
+        }
+        [self convertToPerItemStorage];
+    }
+
+    NSUInteger numberOfItems = _numberOfItems + count;
+    if (numberOfItems > _itemCapacity) {
+        NSUInteger capacity = MAX(numberOfItems, 2 * _itemCapacity);
+        _itemFrames = reallocf(_itemFrames, capacity * sizeof(CGRect));
+        _itemFlags = reallocf(_itemFlags, capacity * sizeof(AAPLGridLayoutItemFlags));
+        NSAssert(_itemFrames && _itemFlags, @"Unable to allocate storage for %lu items", (unsigned long)capacity);
+        _itemCapacity = capacity;
+    }
+
+    for (NSUInteger itemIndex = _numberOfItems; itemIndex < numberOfItems; ++itemIndex) {
+        _itemFrames[itemIndex] = frame;
+        _itemFlags[itemIndex] = flags;
+    }
+    _numberOfItems = numberOfItems;
+}
+
+/// Give every item its own frame and flags, so items can differ in more than a few remeasured heights
+- (void)convertToPerItemStorage
+{
+    NSAssert(_uniform, @"Section already has per item storage");
+
+    NSUInteger numberOfItems = _numberOfItems;
+    _itemCapacity = numberOfItems;
+    if (numberOfItems) {
+        _itemFrames = malloc(numberOfItems * sizeof(CGRect));
+        _itemFlags = calloc(numberOfItems, sizeof(AAPLGridLayoutItemFlags));
+        NSAssert(_itemFrames && _itemFlags, @"Unable to allocate storage for %lu items", (unsigned long)numberOfItems);
+        for (NSUInteger itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+            _itemFrames[itemIndex] = [self frameForItemAtIndex:itemIndex];
+    }
+
+    AAPLUniformItemsRelease(_uniformItems);
+    _uniformItems = NULL;
+    _uniform = NO;
+}
+
+- (CGRect)frameForItemAtIndex:(NSUInteger)itemIndex
 {
-    AAPLGridLayoutItemInfo *itemInfo = [[AAPLGridLayoutItemInfo alloc] init];
-    [self.items addObject:itemInfo];
-    return itemInfo;
+    NSParameterAssert(itemIndex < _numberOfItems);
+
+    if (!_uniform)
+        return _itemFrames[itemIndex];
+
+    CGRect frame = _uniformItemFrame;
+    double height;
+    frame.origin.y += AAPLUniformItemsGetItemMinY(_uniformItems, itemIndex, CGRectGetHeight(frame), &height);
+    frame.size.height = height;
+    return frame;
+}
+
+- (void)setHeight:(CGFloat)height forItemAtIndex:(NSUInteger)itemIndex
+{
+    NSParameterAssert(itemIndex < _numberOfItems);
+
+    if (!_uniform) {
+        _itemFrames[itemIndex].size.height = height;
+        return;
+    }
+
+    AAPLUniformItemsSetHeight(_uniformItems, itemIndex, height, CGRectGetHeight(_uniformItemFrame));
+}
+
+- (NSUInteger)indexOfFirstItemReachingY:(CGFloat)y
+{
+    if (_uniform)
+        return AAPLUniformItemsGetIndexOfFirstItemReachingY(_uniformItems, _numberOfItems, CGRectGetHeight(_uniformItemFrame), y - CGRectGetMinY(_uniformItemFrame));
+
+    // Items are stacked vertically, so the first one reaching y can be found with a binary search
+    NSUInteger low = 0, high = _numberOfItems;
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (CGRectGetMaxY(_itemFrames[middle]) < y)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
 }
 
 - (CGFloat)columnWidth
@@ -92,7 +193,7 @@
 	const CGFloat availableHeight = size.height - start.y;
 	const CGSize sizeForMeasuring = { size.width, UILayoutFittingExpandedSize.height };
 	const UIEdgeInsets margins = self.insets;
-	const NSUInteger numberOfItems = self.items.count;
+	const NSUInteger numberOfItems = _numberOfItems;
 	
 	__block CGPoint origin = start;
 	
@@ -159,23 +260,29 @@
 		__block CGPoint itemOrigin = CGPointMake( start.x + margins.left, contentBeginY );
 		const CGFloat itemWidth = self.columnWidth;
 
-		[self.items enumerateObjectsUsingBlock:^(AAPLGridLayoutItemInfo *item, NSUInteger itemIndex, BOOL *stop) {
-			CGRect itemFrame = (CGRect){ itemOrigin, { itemWidth, CGRectGetHeight(item.frame) }};
-			if (itemFrame.size.height == AAPLRowHeightRemainder) {
-				itemFrame.size.height = size.height - itemFrame.origin.y;
-			}
+		// Uniform items only need the first frame; the rest follow from it and the remeasured items
+		if (_uniform) {
+			CGFloat rowHeight = CGRectGetHeight(_uniformItemFrame);
+			_uniformItemFrame = (CGRect){ itemOrigin, { itemWidth, rowHeight }};
+			itemOrigin.y += AAPLUniformItemsGetHeight(_uniformItems, numberOfItems, rowHeight);
+		}
+		else {
+			for (NSUInteger itemIndex = 0; itemIndex < numberOfItems; ++itemIndex) {
+				CGRect itemFrame = (CGRect){ itemOrigin, { itemWidth, CGRectGetHeight(_itemFrames[itemIndex]) }};
+				if (itemFrame.size.height == AAPLRowHeightRemainder) {
+					itemFrame.size.height = size.height - itemFrame.origin.y;
+				}
 
-			if (item.needSizeUpdate && measureItemBlock) {
-				item.needSizeUpdate = NO;
-				item.frame = itemFrame;
-				itemFrame.size.height = measureItemBlock(indexPath(itemIndex), itemFrame).height;
-				item.frame = itemFrame;
-			} else {
-				item.frame = itemFrame;
-			}
+				// Estimated items are measured by the layout once they're close to being visible
+				if ((_itemFlags[itemIndex] & AAPLGridLayoutItemFlagNeedSizeUpdate) && measureItemBlock && !_estimatedRowHeight) {
+					_itemFlags[itemIndex] &= ~AAPLGridLayoutItemFlagNeedSizeUpdate;
+					itemFrame.size.height = measureItemBlock(indexPath(itemIndex), itemFrame).height;
+				}
 
-			itemOrigin.y += itemFrame.size.height;
-		}];
+				_itemFrames[itemIndex] = itemFrame;
+				itemOrigin.y += itemFrame.size.height;
+			}
+		}
 
 		origin.y = MAX(backgroundEndY, itemOrigin.y) + margins.bottom;
 
@@ -195,6 +302,27 @@
 	self.frame = (CGRect){ start, { size.width, origin.y - start.y }};
 }
 
+- (void)offsetFramesByY:(CGFloat)deltaY
+{
+    _frame = CGRectOffset(_frame, 0, deltaY);
+    _contentMaxY += deltaY;
+
+    if (_uniform)
+        _uniformItemFrame.origin.y += deltaY;
+    else {
+        for (NSUInteger itemIndex = 0; itemIndex < _numberOfItems; ++itemIndex)
+            _itemFrames[itemIndex].origin.y += deltaY;
+    }
+
+    [_supplementalItemArraysByKind enumerateKeysAndObjectsUsingBlock:^(NSString *kind, NSArray *items, BOOL *stop) {
+        for (AAPLGridLayoutSupplementalItemInfo *item in items)
+            item.frame = CGRectOffset(item.frame, 0, deltaY);
+    }];
+
+    if (_placeholder)
+        _placeholder.frame = CGRectOffset(_placeholder.frame, 0, deltaY);
+}
+
 - (NSString *)description
 {
 	return [NSString stringWithFormat:@"<%@: %p %@>", NSStringFromClass(self.class), (__bridge void *)self, NSStringFromCGRect(_frame)];
@@ -224,11 +352,19 @@
         [result appendFormat:@"\n    placeholder = %@", _placeholder];
     }
 
-	if (_items.count) {
+	if (_numberOfItems && _uniform) {
+		[result appendFormat:@"\n    items = %lu uniform from %@", (unsigned long)_numberOfItems, NSStringFromCGRect(_uniformItemFrame)];
+
+		for (size_t position = 0; position < AAPLUniformItemsGetNumberOfHeights(_uniformItems); ++position) {
+			NSUInteger itemIndex = AAPLUniformItemsGetItemIndexAtPosition(_uniformItems, position);
+			[result appendFormat:@"\n        remeasured %lu = %@", (unsigned long)itemIndex, NSStringFromCGRect([self frameForItemAtIndex:itemIndex])];
+		}
+	}
+	else if (_numberOfItems) {
 		[result appendString:@"\n    items = @[\n"];
 
-		for (AAPLGridLayoutItemInfo *items in _items) {
-			[result appendFormat:@"        %@\n", items];
+		for (NSUInteger itemIndex = 0; itemIndex < _numberOfItems; ++itemIndex) {
+			[result appendFormat:@"        %@\n", NSStringFromCGRect(_itemFrames[itemIndex])];
 		}
 
         [result appendString:@"    ]"];
@@ -273,21 +409,36 @@
     self = [super init];
     if (!self)
         return nil;
-    _sections = [NSMutableDictionary dictionary];
+    _sections = [NSMutableArray array];
     return self;
 }
 
+- (NSUInteger)numberOfSections
+{
+    return [_sections count];
+}
+
 - (AAPLGridLayoutSectionInfo *)addSectionWithIndex:(NSInteger)sectionIndex
 {
     AAPLGridLayoutSectionInfo *section = [[AAPLGridLayoutSectionInfo alloc] init];
     section.layoutInfo = self;
-    self.sections[@(sectionIndex)] = section;
+
+    if (AAPLGlobalSection == (NSUInteger)sectionIndex)
+        _globalSection = section;
+    else {
+        NSAssert((NSUInteger)sectionIndex == [_sections count], @"Sections must be added in order");
+        [_sections addObject:section];
+    }
     return section;
 }
 
-- (void)invalidate
+- (AAPLGridLayoutSectionInfo *)sectionAtIndex:(NSUInteger)sectionIndex
 {
-    [self.sections removeAllObjects];
+    if (AAPLGlobalSection == sectionIndex)
+        return _globalSection;
+    if (sectionIndex >= [_sections count])
+        return nil;
+    return _sections[sectionIndex];
 }
 
 - (NSString *)description
@@ -301,6 +452,9 @@
     NSMutableString *result = [NSMutableString string];
     [result appendString:[self description]];
 
+    if (_globalSection)
+        [result appendFormat:@"\n    globalSection = %@", [_globalSection valueForKey:@"recursiveDescription"]];
+
     if ([_sections count]) {
         [result appendString:@"\n    sections = @[\n"];
 
@@ -314,52 +468,3 @@
 #endif
 
 @end
-
-@implementation AAPLIndexPathKind
-
-- (instancetype)initWithIndexPath:(NSIndexPath *)indexPath kind:(NSString *)kind
-{
-	self = [super init];
-	if (!self) return nil;
-	
-	_indexPath = [indexPath copy];
-	_kind = [kind copy];
-	
-	return self;
-}
-
-- (id)copyWithZone:(NSZone *)zone
-{
-	return self;
-}
-
-- (NSUInteger)hash
-{
-	NSUInteger prime = 31;
-	NSUInteger result = 1;
-	
-	result = prime * result + [_indexPath hash];
-	result = prime * result + [_kind hash];
-	return result;
-}
-
-- (BOOL)isEqual:(id)object
-{
-	if (self == object)
-		return YES;
-	
-	if (![object isKindOfClass:AAPLIndexPathKind.class])
-		return NO;
-	
-	AAPLIndexPathKind *other = object;
-	
-	if (_indexPath == other->_indexPath && _kind == other->_kind)
-		return YES;
-	
-	if (!_indexPath || ![_indexPath isEqual:other->_indexPath])
-		return NO;
-	
-	return _kind && [_kind isEqualToString:other->_kind];
-}
-
-@end
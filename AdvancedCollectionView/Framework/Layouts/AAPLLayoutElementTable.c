@@ -0,0 +1,154 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLLayoutElementTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// An empty slot has a NULL value, which is why values may not be NULL.
+typedef struct {
+    AAPLLayoutElementKey key;
+    const void *value;
+} AAPLLayoutElementTableEntry;
+
+struct AAPLLayoutElementTable {
+    AAPLLayoutElementTableEntry *entries;
+    AAPLLayoutElementTableValueCallBacks callBacks;
+    size_t count;
+    /// Always a power of two, so a hash is reduced to a slot with a mask
+    size_t capacity;
+};
+
+static inline uint64_t AAPLLayoutElementKeyHash(AAPLLayoutElementKey key)
+{
+    // Sections and items are small and dense, so mix them thoroughly before masking off the low bits
+    uint64_t hash = ((uint64_t)key.section << 32) ^ (uint64_t)key.item ^ ((uint64_t)key.kind << 56);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static inline bool AAPLLayoutElementKeyEqual(AAPLLayoutElementKey key1, AAPLLayoutElementKey key2)
+{
+    return key1.kind == key2.kind && key1.section == key2.section && key1.item == key2.item;
+}
+
+/// The slot holding the key, or the empty slot where it belongs. There is always at least one empty slot.
+static AAPLLayoutElementTableEntry *AAPLLayoutElementTableFindEntry(AAPLLayoutElementTableEntry *entries, size_t capacity, AAPLLayoutElementKey key)
+{
+    size_t mask = capacity - 1;
+    size_t slot = (size_t)AAPLLayoutElementKeyHash(key) & mask;
+
+    for (;;) {
+        AAPLLayoutElementTableEntry *entry = &entries[slot];
+        if (!entry->value || AAPLLayoutElementKeyEqual(entry->key, key))
+            return entry;
+        slot = (slot + 1) & mask;
+    }
+}
+
+AAPLLayoutElementTableRef AAPLLayoutElementTableCreate(const AAPLLayoutElementTableValueCallBacks *callBacks)
+{
+    AAPLLayoutElementTableRef table = calloc(1, sizeof(struct AAPLLayoutElementTable));
+    if (table && callBacks)
+        table->callBacks = *callBacks;
+    return table;
+}
+
+void AAPLLayoutElementTableRelease(AAPLLayoutElementTableRef table)
+{
+    if (!table)
+        return;
+    AAPLLayoutElementTableRemoveAllValues(table);
+    free(table->entries);
+    free(table);
+}
+
+void AAPLLayoutElementTableRemoveAllValues(AAPLLayoutElementTableRef table)
+{
+    if (!table->count)
+        return;
+
+    if (table->callBacks.release) {
+        for (size_t slot = 0; slot < table->capacity; ++slot) {
+            const void *value = table->entries[slot].value;
+            if (value)
+                table->callBacks.release(value);
+        }
+    }
+
+    memset(table->entries, 0, table->capacity * sizeof(AAPLLayoutElementTableEntry));
+    table->count = 0;
+}
+
+size_t AAPLLayoutElementTableGetCount(AAPLLayoutElementTableRef table)
+{
+    return table->count;
+}
+
+const void *AAPLLayoutElementTableGetValue(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key)
+{
+    if (!table->count)
+        return NULL;
+    return AAPLLayoutElementTableFindEntry(table->entries, table->capacity, key)->value;
+}
+
+/// Keep the load factor at or below 1/2 so probe sequences stay short.
+static bool AAPLLayoutElementTableGrow(AAPLLayoutElementTableRef table)
+{
+    size_t capacity = table->capacity ? 2 * table->capacity : 64;
+    AAPLLayoutElementTableEntry *entries = calloc(capacity, sizeof(AAPLLayoutElementTableEntry));
+    if (!entries)
+        return false;
+
+    for (size_t slot = 0; slot < table->capacity; ++slot) {
+        AAPLLayoutElementTableEntry *entry = &table->entries[slot];
+        if (entry->value)
+            *AAPLLayoutElementTableFindEntry(entries, capacity, entry->key) = *entry;
+    }
+
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return true;
+}
+
+bool AAPLLayoutElementTableSetValue(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key, const void *value)
+{
+    if (!value)
+        return false;
+
+    if (2 * (table->count + 1) > table->capacity && !AAPLLayoutElementTableGrow(table))
+        return false;
+
+    if (table->callBacks.retain)
+        value = table->callBacks.retain(value);
+
+    AAPLLayoutElementTableEntry *entry = AAPLLayoutElementTableFindEntry(table->entries, table->capacity, key);
+    if (entry->value) {
+        if (table->callBacks.release)
+            table->callBacks.release(entry->value);
+    }
+    else {
+        entry->key = key;
+        ++table->count;
+    }
+
+    entry->value = value;
+    return true;
+}
+
+void AAPLLayoutElementTableApplyFunction(AAPLLayoutElementTableRef table, AAPLLayoutElementTableApplierFunction applier, void *context)
+{
+    for (size_t slot = 0; slot < table->capacity; ++slot) {
+        AAPLLayoutElementTableEntry *entry = &table->entries[slot];
+        if (entry->value && !applier(entry->key, entry->value, context))
+            break;
+    }
+}
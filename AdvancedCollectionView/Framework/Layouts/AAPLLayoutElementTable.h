@@ -0,0 +1,67 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_LAYOUT_ELEMENT_TABLE_H
+#define AAPL_LAYOUT_ELEMENT_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Identifies a supplementary or decoration element: an interned element kind plus the section and item of its index path. Keys are plain values, so building one for a lookup never allocates.
+typedef struct {
+    uint32_t kind;
+    size_t section;
+    size_t item;
+} AAPLLayoutElementKey;
+
+static inline AAPLLayoutElementKey AAPLLayoutElementKeyMake(uint32_t kind, size_t section, size_t item)
+{
+    AAPLLayoutElementKey key = { kind, section, item };
+    return key;
+}
+
+/// A hash table from element keys to values using open addressing, used by the grid layout to find the attributes of supplementary and decoration views. This is plain C, so it has no dependency on UIKit.
+typedef struct AAPLLayoutElementTable *AAPLLayoutElementTableRef;
+
+/// How the table takes ownership of its values. Pass CFRetain and CFRelease to store objects. Either function may be NULL.
+typedef struct {
+    const void *(*retain)(const void *value);
+    void (*release)(const void *value);
+} AAPLLayoutElementTableValueCallBacks;
+
+/// Called for each entry of the table. Return false to stop the enumeration.
+typedef bool (*AAPLLayoutElementTableApplierFunction)(AAPLLayoutElementKey key, const void *value, void *context);
+
+/// Create a new empty table. Returns NULL if memory could not be allocated.
+AAPLLayoutElementTableRef AAPLLayoutElementTableCreate(const AAPLLayoutElementTableValueCallBacks *callBacks);
+
+/// Release a table, all of its values and all of its storage.
+void AAPLLayoutElementTableRelease(AAPLLayoutElementTableRef table);
+
+/// Remove all entries while keeping the allocated storage around for the next build.
+void AAPLLayoutElementTableRemoveAllValues(AAPLLayoutElementTableRef table);
+
+/// The number of entries in the table.
+size_t AAPLLayoutElementTableGetCount(AAPLLayoutElementTableRef table);
+
+/// Find the value for a key. Returns NULL if the table has no entry for the key.
+const void *AAPLLayoutElementTableGetValue(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key);
+
+/// Add an entry or replace the value of an existing one. The value must not be NULL. Returns false if memory could not be allocated, in which case the table is unchanged.
+bool AAPLLayoutElementTableSetValue(AAPLLayoutElementTableRef table, AAPLLayoutElementKey key, const void *value);
+
+/// Enumerate every entry in no particular order. The table must not be modified during the enumeration.
+void AAPLLayoutElementTableApplyFunction(AAPLLayoutElementTableRef table, AAPLLayoutElementTableApplierFunction applier, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
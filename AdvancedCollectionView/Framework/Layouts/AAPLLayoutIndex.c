@@ -0,0 +1,183 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLLayoutIndex.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct {
+    double minY;
+    double maxY;
+    size_t value;
+} AAPLLayoutIndexEntry;
+
+struct AAPLLayoutIndex {
+    AAPLLayoutIndexEntry *entries;
+    /// A complete binary tree over the sorted entries holding the largest maxY below each node. Node 1 is the root, the children of node i are 2i and 2i + 1, and the leaves start at leafCount. Has room for 2 * capacity nodes.
+    double *maxYTree;
+    /// The number of leaves: the smallest power of two no smaller than count
+    size_t leafCount;
+    /// How far the entries have moved since they were added
+    double offsetY;
+    size_t count;
+    size_t capacity;
+    bool sorted;
+};
+
+AAPLLayoutIndexRef AAPLLayoutIndexCreate(void)
+{
+    AAPLLayoutIndexRef index = calloc(1, sizeof(struct AAPLLayoutIndex));
+    if (index)
+        index->sorted = true;
+    return index;
+}
+
+void AAPLLayoutIndexRelease(AAPLLayoutIndexRef index)
+{
+    if (!index)
+        return;
+    free(index->entries);
+    free(index->maxYTree);
+    free(index);
+}
+
+void AAPLLayoutIndexRemoveAllEntries(AAPLLayoutIndexRef index)
+{
+    index->count = 0;
+    index->offsetY = 0;
+    index->sorted = true;
+}
+
+bool AAPLLayoutIndexAddEntry(AAPLLayoutIndexRef index, double minY, double maxY, size_t value)
+{
+    if (index->count == index->capacity) {
+        // Indexes are often kept per section, so start small
+        size_t capacity = index->capacity ? 2 * index->capacity : 8;
+        AAPLLayoutIndexEntry *entries = realloc(index->entries, capacity * sizeof(AAPLLayoutIndexEntry));
+        if (!entries)
+            return false;
+        index->entries = entries;
+
+        double *maxYTree = realloc(index->maxYTree, 2 * capacity * sizeof(double));
+        if (!maxYTree)
+            return false;
+        index->maxYTree = maxYTree;
+        index->capacity = capacity;
+    }
+
+    minY -= index->offsetY;
+    maxY -= index->offsetY;
+
+    if (index->count && minY < index->entries[index->count - 1].minY)
+        index->sorted = false;
+
+    AAPLLayoutIndexEntry *entry = &index->entries[index->count++];
+    entry->minY = minY;
+    entry->maxY = maxY;
+    entry->value = value;
+    return true;
+}
+
+size_t AAPLLayoutIndexGetCount(AAPLLayoutIndexRef index)
+{
+    return index->count;
+}
+
+void AAPLLayoutIndexOffsetEntries(AAPLLayoutIndexRef index, double deltaY)
+{
+    index->offsetY += deltaY;
+}
+
+static int AAPLLayoutIndexCompareEntries(const void *a, const void *b)
+{
+    const AAPLLayoutIndexEntry *entry1 = a, *entry2 = b;
+
+    if (entry1->minY < entry2->minY)
+        return -1;
+    if (entry1->minY > entry2->minY)
+        return 1;
+
+    // Break ties on the value so the order is the same from one build to the next
+    if (entry1->value < entry2->value)
+        return -1;
+    if (entry1->value > entry2->value)
+        return 1;
+    return 0;
+}
+
+void AAPLLayoutIndexFinalize(AAPLLayoutIndexRef index)
+{
+    if (!index->sorted) {
+        qsort(index->entries, index->count, sizeof(AAPLLayoutIndexEntry), AAPLLayoutIndexCompareEntries);
+        index->sorted = true;
+    }
+
+    // The capacity is a power of two, so the tree always fits
+    size_t count = index->count;
+    size_t leafCount = 1;
+    while (leafCount < count)
+        leafCount *= 2;
+    index->leafCount = leafCount;
+
+    if (!count)
+        return;
+
+    double *tree = index->maxYTree;
+    for (size_t position = 0; position < leafCount; ++position)
+        tree[leafCount + position] = (position < count ? index->entries[position].maxY : -HUGE_VAL);
+    for (size_t node = leafCount - 1; node > 0; --node)
+        tree[node] = fmax(tree[2 * node], tree[2 * node + 1]);
+}
+
+typedef struct {
+    AAPLLayoutIndexRef index;
+    /// Only entries before this position start above maxY
+    size_t end;
+    double minY;
+    AAPLLayoutIndexApplierFunction applier;
+    void *context;
+    size_t visited;
+} AAPLLayoutIndexQuery;
+
+/// Visit the entries below a node that reach minY, in order. Subtrees that end above minY are skipped without looking at their entries. Returns false once the applier has asked to stop.
+static bool AAPLLayoutIndexVisitNode(AAPLLayoutIndexQuery *query, size_t node, size_t nodeStart, size_t nodeLength)
+{
+    if (nodeStart >= query->end || query->index->maxYTree[node] < query->minY)
+        return true;
+
+    if (1 == nodeLength) {
+        ++query->visited;
+        return query->applier(query->index->entries[nodeStart].value, query->context);
+    }
+
+    size_t halfLength = nodeLength / 2;
+    if (!AAPLLayoutIndexVisitNode(query, 2 * node, nodeStart, halfLength))
+        return false;
+    return AAPLLayoutIndexVisitNode(query, 2 * node + 1, nodeStart + halfLength, halfLength);
+}
+
+size_t AAPLLayoutIndexEnumerateEntriesInRange(AAPLLayoutIndexRef index, double minY, double maxY, AAPLLayoutIndexApplierFunction applier, void *context)
+{
+    minY -= index->offsetY;
+    maxY -= index->offsetY;
+
+    // Entries starting below maxY can't overlap
+    size_t low = 0, high = index->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (index->entries[middle].minY <= maxY)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (!low)
+        return 0;
+
+    AAPLLayoutIndexQuery query = { index, low, minY, applier, context, 0 };
+    AAPLLayoutIndexVisitNode(&query, 1, 0, index->leafCount);
+    return query.visited;
+}
@@ -0,0 +1,52 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_LAYOUT_INDEX_H
+#define AAPL_LAYOUT_INDEX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// An index of vertical intervals used by the grid layout to answer rect queries without visiting every layout attribute. This is plain C, so it has no dependency on UIKit.
+///
+/// Each entry is an interval [minY, maxY] associated with a caller defined value (typically the position of a layout attribute in an array).
+typedef struct AAPLLayoutIndex *AAPLLayoutIndexRef;
+
+/// Called for each candidate entry of a query. Return false to stop the enumeration.
+typedef bool (*AAPLLayoutIndexApplierFunction)(size_t value, void *context);
+
+/// Create a new empty index. Returns NULL if memory could not be allocated.
+AAPLLayoutIndexRef AAPLLayoutIndexCreate(void);
+
+/// Release an index and all of its storage.
+void AAPLLayoutIndexRelease(AAPLLayoutIndexRef index);
+
+/// Remove all entries while keeping the allocated storage around for the next build.
+void AAPLLayoutIndexRemoveAllEntries(AAPLLayoutIndexRef index);
+
+/// Append an entry. Entries may be added in any order, but adding them in ascending minY order avoids a sort when the index is finalized. Returns false if memory could not be allocated.
+bool AAPLLayoutIndexAddEntry(AAPLLayoutIndexRef index, double minY, double maxY, size_t value);
+
+/// The number of entries in the index.
+size_t AAPLLayoutIndexGetCount(AAPLLayoutIndexRef index);
+
+/// Move every entry vertically. This takes constant time: the offset is applied to queries and to entries added later rather than to the stored entries. Removing all entries resets it.
+void AAPLLayoutIndexOffsetEntries(AAPLLayoutIndexRef index, double deltaY);
+
+/// Prepare the index for queries. Must be called after the last entry is added and before the index is queried.
+void AAPLLayoutIndexFinalize(AAPLLayoutIndexRef index);
+
+/// Enumerate the values of every entry overlapping the closed interval [minY, maxY] in ascending minY order. Touching intervals are included, so callers should still check the exact geometry. Entries ending above minY are skipped a whole subtree at a time, so a tall entry doesn't make the query visit the short ones after it: this is O((K + 1) log N) where K is the number of overlapping entries, however the intervals are distributed. Returns the number of values passed to the applier.
+size_t AAPLLayoutIndexEnumerateEntriesInRange(AAPLLayoutIndexRef index, double minY, double maxY, AAPLLayoutIndexApplierFunction applier, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import <UIKit/UIKit.h>
+
+/// A cache of measured item heights. Heights are keyed by a stable item identifier supplied by the data source along with the width the item was measured at and the version of its content. Because the identifier doesn't depend on the item's position, cached heights remain valid when the data source reloads or items move.
+@interface AAPLLayoutMeasurementCache : NSObject
+
+/// Look up the height of an item measured at the given width. Returns NO if the item hasn't been measured at this width or its content version has changed since it was measured.
+- (BOOL)getHeight:(CGFloat *)height forIdentifier:(id<NSCopying>)identifier width:(CGFloat)width version:(NSUInteger)version;
+
+/// Remember the measured height of an item. Heights for an older content version of the same item are discarded.
+- (void)setHeight:(CGFloat)height forIdentifier:(id<NSCopying>)identifier width:(CGFloat)width version:(NSUInteger)version;
+
+/// Forget the heights measured for a single item.
+- (void)removeHeightsForIdentifier:(id<NSCopying>)identifier;
+
+/// Forget all measured heights, for example when the content size category changes.
+- (void)removeAllHeights;
+
+/// The number of items whose heights the cache aims to keep. Past this, and under memory pressure, heights are evicted and those items are measured again when they are laid out. The default is 10,000. Zero means no limit.
+@property (nonatomic) NSUInteger countLimit;
+
+/// The number of lookups that found a height.
+@property (nonatomic, readonly) NSUInteger hitCount;
+/// The number of lookups that didn't find a height and required measuring the item.
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/// Reset the hit and miss counts to zero.
+- (void)resetCounts;
+
+@end
@@ -0,0 +1,134 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLLayoutMeasurementCache.h"
+
+/// Items are usually measured at one or two widths (portrait and landscape), so each entry keeps a couple of slots rather than a dictionary.
+#define AAPL_MEASUREMENT_CACHE_WIDTH_SLOTS 2
+
+/// Each entry is well under 100 bytes plus its identifier, so the default limit keeps the cache to around a megabyte
+#define AAPL_MEASUREMENT_CACHE_DEFAULT_COUNT_LIMIT 10000
+
+@interface AAPLLayoutMeasurementCacheEntry : NSObject
+@end
+
+@implementation AAPLLayoutMeasurementCacheEntry {
+@public
+    NSUInteger _version;
+    NSUInteger _count;
+    /// The slot replaced the next time a new width is measured
+    NSUInteger _nextSlot;
+    CGFloat _widths[AAPL_MEASUREMENT_CACHE_WIDTH_SLOTS];
+    CGFloat _heights[AAPL_MEASUREMENT_CACHE_WIDTH_SLOTS];
+}
+@end
+
+@interface AAPLLayoutMeasurementCache ()
+@property (nonatomic, strong) NSCache *entries;
+@property (nonatomic, readwrite) NSUInteger hitCount;
+@property (nonatomic, readwrite) NSUInteger missCount;
+@end
+
+@implementation AAPLLayoutMeasurementCache
+
+- (instancetype)init
+{
+    self = [super init];
+    if (!self)
+        return nil;
+
+    // Identifiers come from every item the layout has measured, including items long since removed, so they must not accumulate without bound
+    _entries = [[NSCache alloc] init];
+    _entries.countLimit = AAPL_MEASUREMENT_CACHE_DEFAULT_COUNT_LIMIT;
+    return self;
+}
+
+- (BOOL)getHeight:(CGFloat *)height forIdentifier:(id<NSCopying>)identifier width:(CGFloat)width version:(NSUInteger)version
+{
+    NSParameterAssert(identifier != nil);
+
+    AAPLLayoutMeasurementCacheEntry *entry = [_entries objectForKey:identifier];
+    if (entry && entry->_version == version) {
+        for (NSUInteger slot = 0; slot < entry->_count; ++slot) {
+            if (entry->_widths[slot] != width)
+                continue;
+            if (height)
+                *height = entry->_heights[slot];
+            _hitCount++;
+            return YES;
+        }
+    }
+
+    _missCount++;
+    return NO;
+}
+
+- (void)setHeight:(CGFloat)height forIdentifier:(id<NSCopying>)identifier width:(CGFloat)width version:(NSUInteger)version
+{
+    NSParameterAssert(identifier != nil);
+
+    AAPLLayoutMeasurementCacheEntry *entry = [_entries objectForKey:identifier];
+    if (!entry) {
+        entry = [[AAPLLayoutMeasurementCacheEntry alloc] init];
+        [_entries setObject:entry forKey:identifier];
+    }
+
+    // Heights measured for older content are no longer useful
+    if (entry->_version != version) {
+        entry->_version = version;
+        entry->_count = 0;
+        entry->_nextSlot = 0;
+    }
+
+    NSUInteger slot = 0;
+    while (slot < entry->_count && entry->_widths[slot] != width)
+        ++slot;
+
+    if (slot == entry->_count) {
+        if (entry->_count < AAPL_MEASUREMENT_CACHE_WIDTH_SLOTS)
+            entry->_count++;
+        else {
+            slot = entry->_nextSlot;
+            entry->_nextSlot = (slot + 1) % AAPL_MEASUREMENT_CACHE_WIDTH_SLOTS;
+        }
+    }
+
+    entry->_widths[slot] = width;
+    entry->_heights[slot] = height;
+}
+
+- (void)removeHeightsForIdentifier:(id<NSCopying>)identifier
+{
+    if (identifier)
+        [_entries removeObjectForKey:identifier];
+}
+
+- (void)removeAllHeights
+{
+    [_entries removeAllObjects];
+}
+
+- (NSUInteger)countLimit
+{
+    return _entries.countLimit;
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit
+{
+    _entries.countLimit = countLimit;
+}
+
+- (void)resetCounts
+{
+    _hitCount = 0;
+    _missCount = 0;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@: %p countLimit=%lu hits=%lu misses=%lu>", NSStringFromClass(self.class), (__bridge void *)self, (unsigned long)_entries.countLimit, (unsigned long)_hitCount, (unsigned long)_missCount];
+}
+
+@end
@@ -13,6 +13,12 @@ extern CGFloat const AAPLRowHeightRemainder;
 
 extern CGFloat const AAPLRowHeightDefault;
 
+/// Returns the next value of a process wide counter. Metrics take a new version from it each time they change, so versions are never reused.
+extern NSUInteger AAPLLayoutMetricsNextVersion(void);
+
+/// Returns the last version handed out by AAPLLayoutMetricsNextVersion(). While it doesn't change, no metrics anywhere have changed.
+extern NSUInteger AAPLLayoutMetricsCurrentVersion(void);
+
 typedef UICollectionReusableView *(^AAPLLayoutSupplementaryItemCreationBlock)(UICollectionView *collectionView, NSString *kind, NSString *identifier, NSIndexPath *indexPath);
 typedef void (^AAPLLayoutSupplementaryItemConfigurationBlock)(id view, id dataSource, NSIndexPath *indexPath);
 
@@ -62,6 +68,9 @@ typedef void (^AAPLLayoutSupplementaryItemConfigurationBlock)(id view, id dataSo
 /// An block used to configure an instance of the supplementary view.
 @property (nonatomic, copy) AAPLLayoutSupplementaryItemConfigurationBlock configureView;
 
+/// Changes whenever a property of these metrics is set. Copies keep the version of the original.
+@property (nonatomic, readonly) NSUInteger version;
+
 @end
 
 /// Definition of how a section within a collection view should be presented.
@@ -70,6 +79,9 @@ typedef void (^AAPLLayoutSupplementaryItemConfigurationBlock)(id view, id dataSo
 /// The height of each row in the section. A value of AAPLRowHeightVariable will cause the layout to invoke -collectionView:sizeFittingSize:forItemAtIndexPath: on the data source for each cell. Sections will inherit a default value from the data source of 44.
 @property (nonatomic) CGFloat rowHeight;
 
+/// When rowHeight is AAPLRowHeightVariable, a non-zero estimated row height defers measuring each row until it comes close to the visible area. Until then, the row is laid out with this height. Default is 0, which measures every row when the layout is first computed.
+@property (nonatomic) CGFloat estimatedRowHeight;
+
 /// Padding around the cells for this section. The top & bottom padding will be applied between the headers & footers and the cells. The left & right padding will be applied between the view edges and the cells.
 @property (nonatomic) UIEdgeInsets padding;
 
@@ -109,5 +121,8 @@ typedef void (^AAPLLayoutSupplementaryItemConfigurationBlock)(id view, id dataSo
 @property (nonatomic, copy) NSArray *supplementaryViews;
 @property (nonatomic) BOOL hasPlaceholder;
 
+/// Changes whenever a property of these metrics or of their supplementary views is set. Copies keep the version of the original.
+@property (nonatomic, readonly) NSUInteger version;
+
 
 @end
@@ -4,11 +4,24 @@
  */
 
 #import "AAPLLayoutMetrics.h"
+#import <libkern/OSAtomic.h>
 
 CGFloat const AAPLRowHeightVariable = -1000;
 CGFloat const AAPLRowHeightRemainder = -1001;
 CGFloat const AAPLRowHeightDefault = 44;
 
+static volatile int64_t AAPLLayoutMetricsVersion = 0;
+
+NSUInteger AAPLLayoutMetricsNextVersion(void)
+{
+    return (NSUInteger)OSAtomicIncrement64(&AAPLLayoutMetricsVersion);
+}
+
+NSUInteger AAPLLayoutMetricsCurrentVersion(void)
+{
+    return (NSUInteger)AAPLLayoutMetricsVersion;
+}
+
 @implementation AAPLLayoutSupplementaryMetrics
 
 - (instancetype)init
@@ -42,9 +55,82 @@ CGFloat const AAPLRowHeightDefault = 44;
 	item->_selectedBackgroundColor = _selectedBackgroundColor;
 	item->_padding = _padding;
 	item->_zIndex = _zIndex;
+	item->_version = _version;
 	return item;
 }
 
+- (void)setVisibleWhileShowingPlaceholder:(BOOL)visibleWhileShowingPlaceholder
+{
+    _visibleWhileShowingPlaceholder = visibleWhileShowingPlaceholder;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setShouldPin:(BOOL)shouldPin
+{
+    _shouldPin = shouldPin;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setHeight:(CGFloat)height
+{
+    _height = height;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setHidden:(BOOL)hidden
+{
+    _hidden = hidden;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setPadding:(UIEdgeInsets)padding
+{
+    _padding = padding;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setZIndex:(NSInteger)zIndex
+{
+    _zIndex = zIndex;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setSupplementaryViewClass:(Class)supplementaryViewClass
+{
+    _supplementaryViewClass = supplementaryViewClass;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setBackgroundColor:(UIColor *)backgroundColor
+{
+    _backgroundColor = backgroundColor;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setSelectedBackgroundColor:(UIColor *)selectedBackgroundColor
+{
+    _selectedBackgroundColor = selectedBackgroundColor;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setReuseIdentifier:(NSString *)reuseIdentifier
+{
+    _reuseIdentifier = [reuseIdentifier copy];
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setCreateView:(AAPLLayoutSupplementaryItemCreationBlock)createView
+{
+    _createView = [createView copy];
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setConfigureView:(AAPLLayoutSupplementaryItemConfigurationBlock)configureView
+{
+    _configureView = [configureView copy];
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
 - (NSString *)reuseIdentifier
 {
     if (_reuseIdentifier)
@@ -74,6 +160,7 @@ CGFloat const AAPLRowHeightDefault = 44;
 
 @implementation AAPLLayoutSectionMetrics {
 	NSMutableArray *_supplementaryViews;
+    NSUInteger _version;
     struct {
         BOOL showsSectionSeparatorWhenLastSection;
         BOOL backgroundColor;
@@ -97,6 +184,7 @@ CGFloat const AAPLRowHeightDefault = 44;
         return nil;
 
     metrics->_rowHeight = _rowHeight;
+    metrics->_estimatedRowHeight = _estimatedRowHeight;
     metrics->_padding = _padding;
     metrics->_separatorInsets = _separatorInsets;
     metrics->_backgroundColor = _backgroundColor;
@@ -108,41 +196,93 @@ CGFloat const AAPLRowHeightDefault = 44;
     metrics->_showsSectionSeparatorWhenLastSection = _showsSectionSeparatorWhenLastSection;
 	metrics->_supplementaryViews = [_supplementaryViews mutableCopy];
     metrics->_flags = _flags;
+    metrics->_version = _version;
     return metrics;
 }
 
+- (NSUInteger)version
+{
+    // Supplementary metrics are shared rather than copied, so they keep their own versions
+    NSUInteger version = _version;
+    for (AAPLLayoutSupplementaryMetrics *supplementaryMetrics in _supplementaryViews)
+        version = MAX(version, supplementaryMetrics.version);
+    return version;
+}
+
+- (void)setRowHeight:(CGFloat)rowHeight
+{
+    _rowHeight = rowHeight;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setEstimatedRowHeight:(CGFloat)estimatedRowHeight
+{
+    _estimatedRowHeight = estimatedRowHeight;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setPadding:(UIEdgeInsets)padding
+{
+    _padding = padding;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setSeparatorInsets:(UIEdgeInsets)separatorInsets
+{
+    _separatorInsets = separatorInsets;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setSectionSeparatorInsets:(UIEdgeInsets)sectionSeparatorInsets
+{
+    _sectionSeparatorInsets = sectionSeparatorInsets;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
 - (void)setBackgroundColor:(UIColor *)backgroundColor
 {
     _backgroundColor = backgroundColor;
     _flags.backgroundColor = YES;
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)setSelectedBackgroundColor:(UIColor *)selectedBackgroundColor
 {
     _selectedBackgroundColor = selectedBackgroundColor;
     _flags.selectedBackgroundColor = YES;
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)setSeparatorColor:(UIColor *)separatorColor
 {
     _separatorColor = separatorColor;
     _flags.separatorColor = YES;
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)setSectionSeparatorColor:(UIColor *)sectionSeparatorColor
 {
     _sectionSeparatorColor = sectionSeparatorColor;
     _flags.sectionSeparatorColor = YES;
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)setShowsSectionSeparatorWhenLastSection:(BOOL)showsSectionSeparatorWhenLastSection
 {
     _showsSectionSeparatorWhenLastSection = showsSectionSeparatorWhenLastSection;
     _flags.showsSectionSeparatorWhenLastSection = YES;
+    _version = AAPLLayoutMetricsNextVersion();
+}
+
+- (void)setHasPlaceholder:(BOOL)hasPlaceholder
+{
+    _hasPlaceholder = hasPlaceholder;
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (void)setSupplementaryViews:(NSArray *)supplementaryViews {
 	_supplementaryViews = [NSMutableArray arrayWithArray:supplementaryViews];
+    _version = AAPLLayoutMetricsNextVersion();
 }
 
 - (AAPLLayoutSupplementaryMetrics *)newHeader
@@ -163,6 +303,7 @@ CGFloat const AAPLRowHeightDefault = 44;
 	} else {
 		[_supplementaryViews addObject:metrics];
 	}
+    _version = AAPLLayoutMetricsNextVersion();
 	return metrics;
 }
 
@@ -183,6 +324,9 @@ CGFloat const AAPLRowHeightDefault = 44;
     if (metrics.rowHeight)
         self.rowHeight = metrics.rowHeight;
 
+    if (metrics.estimatedRowHeight)
+        self.estimatedRowHeight = metrics.estimatedRowHeight;
+
     if (metrics->_flags.backgroundColor)
         self.backgroundColor = metrics.backgroundColor;
 
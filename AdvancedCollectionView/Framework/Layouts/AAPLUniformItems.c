@@ -0,0 +1,157 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLUniformItems.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// An item remeasured to a height other than the row height
+typedef struct {
+    size_t itemIndex;
+    double height;
+    /// The sum of the differences from the row height of this item and the remeasured items before it, which is how far the items after it are moved down
+    double offset;
+} AAPLUniformItemsHeight;
+
+struct AAPLUniformItems {
+    /// Sorted by item index
+    AAPLUniformItemsHeight *heights;
+    size_t count;
+    size_t capacity;
+};
+
+/// The position of the first remeasured item at or after itemIndex
+static size_t AAPLUniformItemsGetPosition(AAPLUniformItemsRef items, size_t itemIndex)
+{
+    size_t low = 0, high = items->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (items->heights[middle].itemIndex < itemIndex)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+AAPLUniformItemsRef AAPLUniformItemsCreate(void)
+{
+    return calloc(1, sizeof(struct AAPLUniformItems));
+}
+
+void AAPLUniformItemsRelease(AAPLUniformItemsRef items)
+{
+    if (!items)
+        return;
+    free(items->heights);
+    free(items);
+}
+
+void AAPLUniformItemsRemoveAllHeights(AAPLUniformItemsRef items)
+{
+    items->count = 0;
+}
+
+size_t AAPLUniformItemsGetNumberOfHeights(AAPLUniformItemsRef items)
+{
+    return items->count;
+}
+
+size_t AAPLUniformItemsGetItemIndexAtPosition(AAPLUniformItemsRef items, size_t position)
+{
+    return items->heights[position].itemIndex;
+}
+
+bool AAPLUniformItemsSetHeight(AAPLUniformItemsRef items, size_t itemIndex, double height, double rowHeight)
+{
+    size_t position = AAPLUniformItemsGetPosition(items, itemIndex);
+    bool recorded = (position < items->count && items->heights[position].itemIndex == itemIndex);
+    double oldHeight = (recorded ? items->heights[position].height : rowHeight);
+    if (height == oldHeight)
+        return true;
+
+    if (!recorded) {
+        if (items->count == items->capacity) {
+            // Only a few items are ever remeasured, so start small
+            size_t capacity = items->capacity ? 2 * items->capacity : 8;
+            AAPLUniformItemsHeight *heights = realloc(items->heights, capacity * sizeof(AAPLUniformItemsHeight));
+            if (!heights)
+                return false;
+            items->heights = heights;
+            items->capacity = capacity;
+        }
+
+        AAPLUniformItemsHeight *entry = &items->heights[position];
+        memmove(entry + 1, entry, (items->count - position) * sizeof(AAPLUniformItemsHeight));
+        ++items->count;
+        entry->itemIndex = itemIndex;
+        entry->offset = (position ? items->heights[position - 1].offset : 0);
+    }
+
+    items->heights[position].height = height;
+
+    // Every item after this one moves by the change in height
+    double deltaY = height - oldHeight;
+    for (size_t heightPosition = position; heightPosition < items->count; ++heightPosition)
+        items->heights[heightPosition].offset += deltaY;
+    return true;
+}
+
+double AAPLUniformItemsGetItemMinY(AAPLUniformItemsRef items, size_t itemIndex, double rowHeight, double *height)
+{
+    double minY = itemIndex * rowHeight;
+    if (height)
+        *height = rowHeight;
+
+    if (items->count) {
+        size_t position = AAPLUniformItemsGetPosition(items, itemIndex);
+        if (position)
+            minY += items->heights[position - 1].offset;
+        if (height && position < items->count && items->heights[position].itemIndex == itemIndex)
+            *height = items->heights[position].height;
+    }
+
+    return minY;
+}
+
+double AAPLUniformItemsGetHeight(AAPLUniformItemsRef items, size_t numberOfItems, double rowHeight)
+{
+    if (!numberOfItems)
+        return 0;
+
+    double height;
+    double minY = AAPLUniformItemsGetItemMinY(items, numberOfItems - 1, rowHeight, &height);
+    return minY + height;
+}
+
+size_t AAPLUniformItemsGetIndexOfFirstItemReachingY(AAPLUniformItemsRef items, size_t numberOfItems, double rowHeight, double y)
+{
+    if (!numberOfItems)
+        return 0;
+
+    size_t low = 0, high = numberOfItems;
+
+    if (!items->count && rowHeight > 0) {
+        // Item n ends n + 1 row heights below the top of the first item. Rounding may be off by an item, which the binary search below settles.
+        double rows = ceil(y / rowHeight) - 1;
+        size_t itemIndex = (rows <= 0 ? 0 : (size_t)fmin(rows, (double)numberOfItems));
+        low = (itemIndex ? itemIndex - 1 : 0);
+        high = (itemIndex + 1 < numberOfItems ? itemIndex + 1 : numberOfItems);
+    }
+
+    // Items are stacked vertically, so the first one reaching y can be found with a binary search
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        double height;
+        double minY = AAPLUniformItemsGetItemMinY(items, middle, rowHeight, &height);
+        if (minY + height < y)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
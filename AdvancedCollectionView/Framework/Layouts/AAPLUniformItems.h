@@ -0,0 +1,52 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_UNIFORM_ITEMS_H
+#define AAPL_UNIFORM_ITEMS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// The vertical positions of a column of items that share a row height, used by the grid layout for sections with a fixed row height. Nothing is stored per item: positions are computed from the item index, and only items remeasured to another height are recorded, in a short sorted list. This is plain C, so it has no dependency on UIKit.
+///
+/// Positions are relative to the top of the first item. The row height is passed to each call rather than stored, so the caller's frame stays the one source of truth.
+typedef struct AAPLUniformItems *AAPLUniformItemsRef;
+
+/// Create a column with no remeasured items. Returns NULL if memory could not be allocated.
+AAPLUniformItemsRef AAPLUniformItemsCreate(void);
+
+/// Release a column and all of its storage.
+void AAPLUniformItemsRelease(AAPLUniformItemsRef items);
+
+/// Forget every remeasured height.
+void AAPLUniformItemsRemoveAllHeights(AAPLUniformItemsRef items);
+
+/// The number of remeasured items.
+size_t AAPLUniformItemsGetNumberOfHeights(AAPLUniformItemsRef items);
+
+/// The index of a remeasured item. Positions are in ascending item index order.
+size_t AAPLUniformItemsGetItemIndexAtPosition(AAPLUniformItemsRef items, size_t position);
+
+/// Record the height of an item. Setting the row height again keeps the item recorded. Takes time linear in the number of remeasured items after this one. Returns false if memory could not be allocated, in which case the column is unchanged.
+bool AAPLUniformItemsSetHeight(AAPLUniformItemsRef items, size_t itemIndex, double height, double rowHeight);
+
+/// The top of an item and, if height isn't NULL, its height. Constant time without remeasured items, and a binary search over them otherwise.
+double AAPLUniformItemsGetItemMinY(AAPLUniformItemsRef items, size_t itemIndex, double rowHeight, double *height);
+
+/// The bottom of the last of numberOfItems items, which is their total height.
+double AAPLUniformItemsGetHeight(AAPLUniformItemsRef items, size_t numberOfItems, double rowHeight);
+
+/// The index of the first of numberOfItems items whose bottom reaches y, or numberOfItems if every item ends above it. Found by division without remeasured items and by binary search otherwise.
+size_t AAPLUniformItemsGetIndexOfFirstItemReachingY(AAPLUniformItemsRef items, size_t numberOfItems, double rowHeight, double y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import <Foundation/Foundation.h>
+
+/// Returns the value that identifies an object across changes to its content. Identifiers are compared with -isEqual: and -hash.
+typedef id (^AAPLArrayDiffIdentifierBlock)(id object);
+
+/// The minimal set of deletes, inserts and moves that turns one array into another, plus the objects that kept their identity but changed.
+///
+/// Objects are matched by identifier in O(N) using a hash table, with repeated identifiers matched in order of appearance. The matched objects that keep their relative order are found with a longest increasing subsequence in O(N log N); only the remaining ones are reported as moves.
+@interface AAPLArrayDiff : NSObject
+
+/// Compute the changes from fromArray to toArray. When identifierBlock is nil, each object is its own identifier.
++ (instancetype)diffFromArray:(NSArray *)fromArray toArray:(NSArray *)toArray identifierBlock:(AAPLArrayDiffIdentifierBlock)identifierBlock;
+
+/// Indexes in the original array of the objects that were removed.
+@property (nonatomic, readonly) NSIndexSet *deletedIndexes;
+/// Indexes in the new array of the objects that were added.
+@property (nonatomic, readonly) NSIndexSet *insertedIndexes;
+/// Indexes in the original array of the objects that changed position relative to the objects around them.
+@property (nonatomic, readonly) NSIndexSet *movedIndexes;
+/// Indexes in the original array of the objects whose identifier matched an object in the new array that is not -isEqual: to it. These may also be moved.
+@property (nonatomic, readonly) NSIndexSet *updatedIndexes;
+
+/// Whether there are any deletes, inserts, moves or updates.
+@property (nonatomic, readonly) BOOL hasChanges;
+
+/// The index in the new array of the object at index in the original array, or NSNotFound if it was deleted.
+- (NSUInteger)newIndexForIndex:(NSUInteger)index;
+
+/// Call the block for each move in ascending order of the original index.
+- (void)enumerateMovesUsingBlock:(void(^)(NSUInteger fromIndex, NSUInteger toIndex, BOOL *stop))block;
+
+@end
@@ -0,0 +1,191 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLArrayDiff.h"
+
+enum {
+    AAPLArrayDiffItemMoved = 1 << 0,
+    AAPLArrayDiffItemUpdated = 1 << 1,
+};
+
+/// Mark the positions of a longest strictly increasing subsequence of values using patience sorting. This is O(N log N).
+static void AAPLArrayDiffMarkLongestIncreasingSubsequence(const NSUInteger *values, NSUInteger count, BOOL *marks)
+{
+    if (!count)
+        return;
+
+    // tails[length - 1] is the position of the smallest value ending an increasing subsequence of that length
+    NSUInteger *tails = malloc(count * sizeof(NSUInteger));
+    NSUInteger *predecessors = malloc(count * sizeof(NSUInteger));
+    NSUInteger length = 0;
+
+    for (NSUInteger position = 0; position < count; ++position) {
+        NSUInteger low = 0, high = length;
+        while (low < high) {
+            NSUInteger middle = low + (high - low) / 2;
+            if (values[tails[middle]] < values[position])
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        predecessors[position] = low ? tails[low - 1] : NSNotFound;
+        tails[low] = position;
+        if (low == length)
+            ++length;
+    }
+
+    for (NSUInteger position = tails[length - 1]; position != NSNotFound; position = predecessors[position])
+        marks[position] = YES;
+
+    free(tails);
+    free(predecessors);
+}
+
+static NSArray *AAPLArrayDiffIdentifiers(NSArray *array, AAPLArrayDiffIdentifierBlock identifierBlock)
+{
+    if (!identifierBlock)
+        return array;
+
+    NSMutableArray *identifiers = [NSMutableArray arrayWithCapacity:array.count];
+    for (id object in array) {
+        id identifier = identifierBlock(object);
+        NSCAssert(identifier != nil, @"identifier block returned nil for %@", object);
+        [identifiers addObject:identifier];
+    }
+    return identifiers;
+}
+
+@implementation AAPLArrayDiff {
+    /// The index in the new array of each object in the original array, or NSNotFound if it was deleted
+    NSUInteger *_newIndexes;
+    NSUInteger _numberOfOldItems;
+}
+
++ (instancetype)diffFromArray:(NSArray *)fromArray toArray:(NSArray *)toArray identifierBlock:(AAPLArrayDiffIdentifierBlock)identifierBlock
+{
+    return [[self alloc] initWithFromArray:fromArray toArray:toArray identifierBlock:identifierBlock];
+}
+
+- (instancetype)initWithFromArray:(NSArray *)fromArray toArray:(NSArray *)toArray identifierBlock:(AAPLArrayDiffIdentifierBlock)identifierBlock
+{
+    self = [super init];
+    if (!self)
+        return nil;
+
+    NSUInteger oldCount = fromArray.count;
+    NSUInteger newCount = toArray.count;
+    NSArray *oldIdentifiers = AAPLArrayDiffIdentifiers(fromArray, identifierBlock);
+    NSArray *newIdentifiers = AAPLArrayDiffIdentifiers(toArray, identifierBlock);
+
+    _numberOfOldItems = oldCount;
+    _newIndexes = malloc(MAX(oldCount, 1) * sizeof(NSUInteger));
+    NSUInteger *nextOccurrences = malloc(MAX(oldCount, 1) * sizeof(NSUInteger));
+    uint8_t *flags = calloc(MAX(oldCount, 1), sizeof(uint8_t));
+
+    // Map each identifier to its first unmatched position in the original array. Later positions with the same identifier are chained through nextOccurrences.
+    CFMutableDictionaryRef firstOccurrences = CFDictionaryCreateMutable(kCFAllocatorDefault, (CFIndex)oldCount, &kCFTypeDictionaryKeyCallBacks, NULL);
+    for (NSUInteger oldIndex = oldCount; oldIndex-- > 0;) {
+        const void *identifier = (__bridge const void *)oldIdentifiers[oldIndex];
+        const void *firstOccurrence;
+        nextOccurrences[oldIndex] = CFDictionaryGetValueIfPresent(firstOccurrences, identifier, &firstOccurrence) ? (NSUInteger)firstOccurrence : NSNotFound;
+        CFDictionarySetValue(firstOccurrences, identifier, (const void *)oldIndex);
+        _newIndexes[oldIndex] = NSNotFound;
+    }
+
+    // The original positions of the matched objects, in their new order
+    NSUInteger *matchedOldIndexes = malloc(MAX(newCount, 1) * sizeof(NSUInteger));
+    NSUInteger numberOfMatches = 0;
+    NSMutableIndexSet *insertedIndexes = [NSMutableIndexSet indexSet];
+
+    for (NSUInteger newIndex = 0; newIndex < newCount; ++newIndex) {
+        const void *identifier = (__bridge const void *)newIdentifiers[newIndex];
+        const void *firstOccurrence;
+        if (!CFDictionaryGetValueIfPresent(firstOccurrences, identifier, &firstOccurrence)) {
+            [insertedIndexes addIndex:newIndex];
+            continue;
+        }
+
+        NSUInteger oldIndex = (NSUInteger)firstOccurrence;
+        NSUInteger nextOccurrence = nextOccurrences[oldIndex];
+        if (NSNotFound == nextOccurrence)
+            CFDictionaryRemoveValue(firstOccurrences, identifier);
+        else
+            CFDictionarySetValue(firstOccurrences, identifier, (const void *)nextOccurrence);
+
+        _newIndexes[oldIndex] = newIndex;
+        matchedOldIndexes[numberOfMatches++] = oldIndex;
+
+        // Without an identifier block, matching objects are already equal
+        if (identifierBlock && ![fromArray[oldIndex] isEqual:toArray[newIndex]])
+            flags[oldIndex] |= AAPLArrayDiffItemUpdated;
+    }
+
+    CFRelease(firstOccurrences);
+
+    // Objects in the longest run that kept their relative order stay put, everything else that matched has moved
+    BOOL *inPlace = calloc(MAX(numberOfMatches, 1), sizeof(BOOL));
+    AAPLArrayDiffMarkLongestIncreasingSubsequence(matchedOldIndexes, numberOfMatches, inPlace);
+    for (NSUInteger position = 0; position < numberOfMatches; ++position) {
+        if (!inPlace[position])
+            flags[matchedOldIndexes[position]] |= AAPLArrayDiffItemMoved;
+    }
+
+    // Build the index sets in ascending order so each index extends the last range
+    NSMutableIndexSet *deletedIndexes = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *movedIndexes = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *updatedIndexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger oldIndex = 0; oldIndex < oldCount; ++oldIndex) {
+        if (NSNotFound == _newIndexes[oldIndex])
+            [deletedIndexes addIndex:oldIndex];
+        if (flags[oldIndex] & AAPLArrayDiffItemMoved)
+            [movedIndexes addIndex:oldIndex];
+        if (flags[oldIndex] & AAPLArrayDiffItemUpdated)
+            [updatedIndexes addIndex:oldIndex];
+    }
+
+    free(inPlace);
+    free(matchedOldIndexes);
+    free(flags);
+    free(nextOccurrences);
+
+    _deletedIndexes = [deletedIndexes copy];
+    _insertedIndexes = [insertedIndexes copy];
+    _movedIndexes = [movedIndexes copy];
+    _updatedIndexes = [updatedIndexes copy];
+
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_newIndexes);
+}
+
+- (BOOL)hasChanges
+{
+    return _deletedIndexes.count || _insertedIndexes.count || _movedIndexes.count || _updatedIndexes.count;
+}
+
+- (NSUInteger)newIndexForIndex:(NSUInteger)index
+{
+    NSParameterAssert(index < _numberOfOldItems);
+    return _newIndexes[index];
+}
+
+- (void)enumerateMovesUsingBlock:(void (^)(NSUInteger, NSUInteger, BOOL *))block
+{
+    NSParameterAssert(block != nil);
+    [_movedIndexes enumerateIndexesUsingBlock:^(NSUInteger fromIndex, BOOL *stop) {
+        block(fromIndex, _newIndexes[fromIndex], stop);
+    }];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@: %p deleted=%@ inserted=%@ moved=%@ updated=%@>", NSStringFromClass(self.class), (__bridge void *)self, _deletedIndexes, _insertedIndexes, _movedIndexes, _updatedIndexes];
+}
+
+@end
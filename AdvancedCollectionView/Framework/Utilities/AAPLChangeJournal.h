@@ -0,0 +1,65 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import <UIKit/UIKit.h>
+
+/// Records item changes one after another and merges them into the smallest equivalent batch update. Data sources keep one while their placeholder is showing, and AAPLCollectionViewController uses one to coalesce updates, so a burst of changes costs a single collection view update.
+///
+/// Changes are merged as they are recorded: removing an item that was inserted cancels both, refreshing an item more than once refreshes it once, and refreshing an inserted item does nothing. Unless includesSectionChanges is set, section changes aren't deferred, so the section methods only move the recorded changes along with their sections.
+@interface AAPLChangeJournal : NSObject
+
+/// Whether section changes are part of the batch as well, rather than applied by the caller as they happen. Set it before recording any changes.
+@property (nonatomic) BOOL includesSectionChanges;
+
+/// Whether any changes have been recorded.
+@property (nonatomic, readonly) BOOL hasChanges;
+
+/// Record items inserted at index paths in the resulting state, as with -[UICollectionView insertItemsAtIndexPaths:].
+- (void)insertItemsAtIndexPaths:(NSArray *)indexPaths;
+/// Record items removed at index paths in the current state, as with -[UICollectionView deleteItemsAtIndexPaths:].
+- (void)removeItemsAtIndexPaths:(NSArray *)indexPaths;
+/// Record items refreshed at index paths in the current state.
+- (void)refreshItemsAtIndexPaths:(NSArray *)indexPaths;
+/// Record an item moving from an index path in the current state to an index path in the resulting state.
+- (void)moveItemAtIndexPath:(NSIndexPath *)indexPath toIndexPath:(NSIndexPath *)newIndexPath;
+
+/// Sections inserted at indexes in the resulting state.
+- (void)insertSections:(NSIndexSet *)sections;
+/// Sections removed at indexes in the current state. Recorded changes to items in these sections are dropped.
+- (void)removeSections:(NSIndexSet *)sections;
+/// A section moved from an index in the current state to an index in the resulting state.
+- (void)moveSection:(NSInteger)section toSection:(NSInteger)newSection;
+
+/// Sections reloaded in place. Their items will be read again, so recorded changes to items in these sections are dropped.
+- (void)refreshSections:(NSIndexSet *)sections;
+
+/// Forget all recorded changes.
+- (void)removeAllChanges;
+
+// The merged changes in the terms of a batch update: removed and refreshed index paths and the sources of moves refer to the items before the first recorded change, inserted index paths and the destinations of moves refer to the items after the last one. An item that was both moved and refreshed is removed and inserted instead.
+
+/// Index paths of the original items that were removed.
+@property (nonatomic, readonly) NSArray *removedIndexPaths;
+/// Index paths of the items that were added.
+@property (nonatomic, readonly) NSArray *insertedIndexPaths;
+/// Index paths of the original items that were refreshed in place.
+@property (nonatomic, readonly) NSArray *refreshedIndexPaths;
+
+/// Call the block for each original item that moved.
+- (void)enumerateMovesUsingBlock:(void(^)(NSIndexPath *fromIndexPath, NSIndexPath *toIndexPath, BOOL *stop))block;
+
+// The merged section changes, when includesSectionChanges is set, in the same terms. Items in removed, inserted and refreshed sections are read again, so the item changes leave them out: an item that moved into one of them from elsewhere is removed, and one that moved out of a removed or refreshed section is inserted. A section that was both moved and refreshed is removed and inserted instead.
+
+/// Indexes of the original sections that were removed.
+@property (nonatomic, readonly) NSIndexSet *removedSections;
+/// Indexes of the sections that were added.
+@property (nonatomic, readonly) NSIndexSet *insertedSections;
+/// Indexes of the original sections that were refreshed in place.
+@property (nonatomic, readonly) NSIndexSet *refreshedSections;
+
+/// Call the block for each original section that moved.
+- (void)enumerateSectionMovesUsingBlock:(void(^)(NSInteger section, NSInteger newSection, BOOL *stop))block;
+
+@end
@@ -0,0 +1,648 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLChangeJournal.h"
+
+/// Consecutive items of a section. Original items are identified by their index path before the first recorded change, inserted items have NSNotFound as their section. In the list of sections, a run is consecutive sections and its item is the original index of the first one.
+typedef struct {
+    NSUInteger section;
+    NSUInteger item;
+    /// NSNotFound for the untouched remainder of the section, which is always the last run
+    NSUInteger length;
+    BOOL moved;
+} AAPLChangeJournalRun;
+
+/// The items of one section in their current order, as runs of original and inserted items. Also used for the sections themselves.
+@interface AAPLChangeJournalRunList : NSObject
+- (instancetype)initWithSection:(NSUInteger)section;
+@property (nonatomic, readonly) AAPLChangeJournalRun *runs;
+@property (nonatomic, readonly) NSUInteger numberOfRuns;
+/// The index of a run holding only the item at the position. Runs are split as needed.
+- (NSUInteger)runIndexForItemAtPosition:(NSUInteger)position;
+- (void)insertRun:(AAPLChangeJournalRun)run atPosition:(NSUInteger)position;
+- (AAPLChangeJournalRun)removeRunForItemAtPosition:(NSUInteger)position;
+@end
+
+@implementation AAPLChangeJournalRunList {
+    NSUInteger _capacity;
+}
+
+- (instancetype)initWithSection:(NSUInteger)section
+{
+    self = [super init];
+    if (!self)
+        return nil;
+
+    _capacity = 4;
+    _runs = malloc(_capacity * sizeof(AAPLChangeJournalRun));
+    _runs[0] = (AAPLChangeJournalRun){ section, 0, NSNotFound, NO };
+    _numberOfRuns = 1;
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_runs);
+}
+
+- (void)insertRun:(AAPLChangeJournalRun)run atIndex:(NSUInteger)index
+{
+    if (_numberOfRuns == _capacity) {
+        _capacity *= 2;
+        _runs = reallocf(_runs, _capacity * sizeof(AAPLChangeJournalRun));
+    }
+
+    memmove(&_runs[index + 1], &_runs[index], (_numberOfRuns - index) * sizeof(AAPLChangeJournalRun));
+    _runs[index] = run;
+    ++_numberOfRuns;
+}
+
+/// The index of the run starting at the position, splitting the run containing it if needed. The last run never ends, so every position is in some run.
+- (NSUInteger)runIndexStartingAtPosition:(NSUInteger)position
+{
+    NSUInteger start = 0;
+    for (NSUInteger index = 0; index < _numberOfRuns; ++index) {
+        AAPLChangeJournalRun run = _runs[index];
+        if (position == start)
+            return index;
+
+        if (NSNotFound == run.length || position < start + run.length) {
+            NSUInteger offset = position - start;
+            AAPLChangeJournalRun tail = run;
+            if (NSNotFound != tail.section)
+                tail.item += offset;
+            if (NSNotFound != tail.length)
+                tail.length -= offset;
+            _runs[index].length = offset;
+            [self insertRun:tail atIndex:index + 1];
+            return index + 1;
+        }
+
+        start += run.length;
+    }
+
+    NSAssert(NO, @"The last run of a section should never end");
+    return NSNotFound;
+}
+
+- (NSUInteger)runIndexForItemAtPosition:(NSUInteger)position
+{
+    NSUInteger index = [self runIndexStartingAtPosition:position];
+    if (1 != _runs[index].length)
+        [self runIndexStartingAtPosition:position + 1];
+    return index;
+}
+
+- (void)insertRun:(AAPLChangeJournalRun)run atPosition:(NSUInteger)position
+{
+    [self insertRun:run atIndex:[self runIndexStartingAtPosition:position]];
+}
+
+- (AAPLChangeJournalRun)removeRunForItemAtPosition:(NSUInteger)position
+{
+    NSUInteger index = [self runIndexForItemAtPosition:position];
+    AAPLChangeJournalRun run = _runs[index];
+
+    --_numberOfRuns;
+    memmove(&_runs[index], &_runs[index + 1], (_numberOfRuns - index) * sizeof(AAPLChangeJournalRun));
+    return run;
+}
+
+@end
+
+static NSIndexPath *AAPLChangeJournalOriginalIndexPath(AAPLChangeJournalRun run)
+{
+    return [NSIndexPath indexPathForItem:(NSInteger)run.item inSection:(NSInteger)run.section];
+}
+
+/// Renumber the sections of a set of index paths, dropping those whose section maps to NSNotFound.
+static NSMutableSet *AAPLChangeJournalMapIndexPaths(NSSet *indexPaths, NSUInteger (^map)(NSUInteger section))
+{
+    NSMutableSet *result = [NSMutableSet setWithCapacity:indexPaths.count];
+    for (NSIndexPath *indexPath in indexPaths) {
+        NSUInteger section = map((NSUInteger)indexPath.section);
+        if (NSNotFound != section)
+            [result addObject:[NSIndexPath indexPathForItem:indexPath.item inSection:(NSInteger)section]];
+    }
+    return result;
+}
+
+@implementation AAPLChangeJournal {
+    /// Only sections with recorded changes, keyed by their current index
+    NSMutableDictionary *_sections;
+    NSMutableSet *_originalRemovedIndexPaths;
+    NSMutableSet *_originalRefreshedIndexPaths;
+    /// The sections in their current order, when section changes are included
+    AAPLChangeJournalRunList *_sectionOrder;
+    NSMutableIndexSet *_originalRemovedSections;
+    NSMutableIndexSet *_originalRefreshedSections;
+    /// Pairs of original and resulting index paths
+    NSArray *_moves;
+    /// Pairs of original and resulting section indexes
+    NSArray *_sectionMoves;
+    BOOL _merged;
+}
+
+@synthesize removedIndexPaths = _removedIndexPaths;
+@synthesize insertedIndexPaths = _insertedIndexPaths;
+@synthesize refreshedIndexPaths = _refreshedIndexPaths;
+@synthesize removedSections = _removedSections;
+@synthesize insertedSections = _insertedSections;
+@synthesize refreshedSections = _refreshedSections;
+
+- (instancetype)init
+{
+    self = [super init];
+    if (!self)
+        return nil;
+
+    _sections = [NSMutableDictionary dictionary];
+    _originalRemovedIndexPaths = [NSMutableSet set];
+    _originalRefreshedIndexPaths = [NSMutableSet set];
+    _originalRemovedSections = [NSMutableIndexSet indexSet];
+    _originalRefreshedSections = [NSMutableIndexSet indexSet];
+    return self;
+}
+
+- (void)setIncludesSectionChanges:(BOOL)includesSectionChanges
+{
+    NSAssert(!_sections.count && !_originalRemovedIndexPaths.count && !_originalRefreshedIndexPaths.count && !_sectionOrder, @"Section changes must be included before any changes are recorded");
+    _includesSectionChanges = includesSectionChanges;
+}
+
+/// The original index of the section at the current index, or NSNotFound for an inserted section.
+- (NSUInteger)originalSectionAtIndex:(NSUInteger)sectionIndex
+{
+    if (!_includesSectionChanges)
+        return sectionIndex;
+
+    AAPLChangeJournalRunList *sectionOrder = [self sectionOrder];
+    AAPLChangeJournalRun run = sectionOrder.runs[[sectionOrder runIndexForItemAtPosition:sectionIndex]];
+    return NSNotFound == run.section ? NSNotFound : run.item;
+}
+
+- (AAPLChangeJournalRunList *)sectionOrder
+{
+    if (!_sectionOrder)
+        _sectionOrder = [[AAPLChangeJournalRunList alloc] initWithSection:0];
+    _merged = NO;
+    return _sectionOrder;
+}
+
+- (AAPLChangeJournalRunList *)sectionAtIndex:(NSInteger)sectionIndex
+{
+    NSParameterAssert(sectionIndex >= 0);
+
+    AAPLChangeJournalRunList *section = _sections[@(sectionIndex)];
+    if (!section) {
+        section = [[AAPLChangeJournalRunList alloc] initWithSection:[self originalSectionAtIndex:(NSUInteger)sectionIndex]];
+        _sections[@(sectionIndex)] = section;
+    }
+
+    _merged = NO;
+    return section;
+}
+
+- (void)insertItemsAtIndexPaths:(NSArray *)indexPaths
+{
+    // Inserted index paths refer to the resulting state, so inserting them in ascending order puts each one where it belongs
+    for (NSIndexPath *indexPath in [indexPaths sortedArrayUsingSelector:@selector(compare:)]) {
+        AAPLChangeJournalRunList *section = [self sectionAtIndex:indexPath.section];
+        [section insertRun:(AAPLChangeJournalRun){ NSNotFound, 0, 1, NO } atPosition:(NSUInteger)indexPath.item];
+    }
+}
+
+- (void)removeItemsAtIndexPaths:(NSArray *)indexPaths
+{
+    // Removed index paths refer to the current state, so remove them from the end to keep the others valid
+    for (NSIndexPath *indexPath in [[indexPaths sortedArrayUsingSelector:@selector(compare:)] reverseObjectEnumerator]) {
+        AAPLChangeJournalRunList *section = [self sectionAtIndex:indexPath.section];
+        AAPLChangeJournalRun run = [section removeRunForItemAtPosition:(NSUInteger)indexPath.item];
+
+        // Removing an inserted item cancels the insert
+        if (NSNotFound == run.section)
+            continue;
+
+        NSIndexPath *originalIndexPath = AAPLChangeJournalOriginalIndexPath(run);
+        [_originalRemovedIndexPaths addObject:originalIndexPath];
+        [_originalRefreshedIndexPaths removeObject:originalIndexPath];
+    }
+}
+
+- (void)refreshItemsAtIndexPaths:(NSArray *)indexPaths
+{
+    for (NSIndexPath *indexPath in indexPaths) {
+        AAPLChangeJournalRunList *section = [self sectionAtIndex:indexPath.section];
+        AAPLChangeJournalRun run = section.runs[[section runIndexForItemAtPosition:(NSUInteger)indexPath.item]];
+
+        // An inserted item will show its current content anyway
+        if (NSNotFound != run.section)
+            [_originalRefreshedIndexPaths addObject:AAPLChangeJournalOriginalIndexPath(run)];
+    }
+}
+
+- (void)moveItemAtIndexPath:(NSIndexPath *)indexPath toIndexPath:(NSIndexPath *)newIndexPath
+{
+    AAPLChangeJournalRun run = [[self sectionAtIndex:indexPath.section] removeRunForItemAtPosition:(NSUInteger)indexPath.item];
+    if (NSNotFound != run.section)
+        run.moved = YES;
+    [[self sectionAtIndex:newIndexPath.section] insertRun:run atPosition:(NSUInteger)newIndexPath.item];
+}
+
+/// Renumber the sections of every recorded change. Sections that map to NSNotFound have been removed.
+- (void)mapSectionsUsingBlock:(NSUInteger (^)(NSUInteger section))map
+{
+    if (!_sections.count && !_originalRemovedIndexPaths.count && !_originalRefreshedIndexPaths.count)
+        return;
+
+    // Original items that moved into a removed section from a section that remains are removed from there
+    [_sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, AAPLChangeJournalRunList *section, BOOL *stop) {
+        if (NSNotFound != map(key.unsignedIntegerValue))
+            return;
+        for (NSUInteger index = 0; index < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun run = section.runs[index];
+            if (NSNotFound != run.section && run.section != key.unsignedIntegerValue) {
+                [_originalRemovedIndexPaths addObject:AAPLChangeJournalOriginalIndexPath(run)];
+                [_originalRefreshedIndexPaths removeObject:AAPLChangeJournalOriginalIndexPath(run)];
+            }
+        }
+    }];
+
+    _originalRemovedIndexPaths = AAPLChangeJournalMapIndexPaths(_originalRemovedIndexPaths, map);
+    _originalRefreshedIndexPaths = AAPLChangeJournalMapIndexPaths(_originalRefreshedIndexPaths, map);
+
+    NSMutableDictionary *sections = [NSMutableDictionary dictionaryWithCapacity:_sections.count];
+    [_sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, AAPLChangeJournalRunList *section, BOOL *stop) {
+        NSUInteger sectionIndex = map(key.unsignedIntegerValue);
+        if (NSNotFound == sectionIndex)
+            return;
+
+        // Original items that moved out of a removed section are new as far as their new section is concerned
+        for (NSUInteger index = 0; index < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun *run = &section.runs[index];
+            if (NSNotFound == run->section)
+                continue;
+            run->section = map(run->section);
+            if (NSNotFound == run->section)
+                run->moved = NO;
+        }
+
+        sections[@(sectionIndex)] = section;
+    }];
+
+    _sections = sections;
+    _merged = NO;
+}
+
+/// Renumber the sections of the recorded changes in the current state only, because the original sections are those of the batch.
+- (void)mapSectionKeysUsingBlock:(NSUInteger (^)(NSUInteger section))map
+{
+    NSMutableDictionary *sections = [NSMutableDictionary dictionaryWithCapacity:_sections.count];
+    [_sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, AAPLChangeJournalRunList *section, BOOL *stop) {
+        NSUInteger sectionIndex = map(key.unsignedIntegerValue);
+        if (NSNotFound != sectionIndex)
+            sections[@(sectionIndex)] = section;
+    }];
+
+    _sections = sections;
+    _merged = NO;
+}
+
+- (void)insertSections:(NSIndexSet *)sections
+{
+    [sections enumerateIndexesUsingBlock:^(NSUInteger insertedSection, BOOL *stop) {
+        NSUInteger (^map)(NSUInteger) = ^NSUInteger(NSUInteger section) {
+            return section >= insertedSection ? section + 1 : section;
+        };
+
+        if (!_includesSectionChanges) {
+            [self mapSectionsUsingBlock:map];
+            return;
+        }
+
+        [[self sectionOrder] insertRun:(AAPLChangeJournalRun){ NSNotFound, 0, 1, NO } atPosition:insertedSection];
+        [self mapSectionKeysUsingBlock:map];
+    }];
+}
+
+- (void)removeSections:(NSIndexSet *)sections
+{
+    [sections enumerateIndexesWithOptions:NSEnumerationReverse usingBlock:^(NSUInteger removedSection, BOOL *stop) {
+        NSUInteger (^map)(NSUInteger) = ^NSUInteger(NSUInteger section) {
+            if (section == removedSection)
+                return NSNotFound;
+            return section > removedSection ? section - 1 : section;
+        };
+
+        if (!_includesSectionChanges) {
+            [self mapSectionsUsingBlock:map];
+            return;
+        }
+
+        AAPLChangeJournalRun run = [[self sectionOrder] removeRunForItemAtPosition:removedSection];
+        NSUInteger originalSection = NSNotFound == run.section ? NSNotFound : run.item;
+
+        // Original items that moved into the removed section from another one are removed from there
+        AAPLChangeJournalRunList *section = _sections[@(removedSection)];
+        for (NSUInteger index = 0; index < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun itemRun = section.runs[index];
+            if (NSNotFound != itemRun.section && itemRun.section != originalSection) {
+                [_originalRemovedIndexPaths addObject:AAPLChangeJournalOriginalIndexPath(itemRun)];
+                [_originalRefreshedIndexPaths removeObject:AAPLChangeJournalOriginalIndexPath(itemRun)];
+            }
+        }
+
+        if (NSNotFound != originalSection) {
+            [_originalRemovedSections addIndex:originalSection];
+            [_originalRefreshedSections removeIndex:originalSection];
+        }
+
+        [self mapSectionKeysUsingBlock:map];
+    }];
+}
+
+- (void)moveSection:(NSInteger)fromSection toSection:(NSInteger)toSection
+{
+    NSParameterAssert(fromSection >= 0 && toSection >= 0);
+
+    NSUInteger (^map)(NSUInteger) = ^NSUInteger(NSUInteger section) {
+        if (section == (NSUInteger)fromSection)
+            return (NSUInteger)toSection;
+        NSUInteger remainingSection = section > (NSUInteger)fromSection ? section - 1 : section;
+        return remainingSection >= (NSUInteger)toSection ? remainingSection + 1 : remainingSection;
+    };
+
+    if (!_includesSectionChanges) {
+        [self mapSectionsUsingBlock:map];
+        return;
+    }
+
+    AAPLChangeJournalRunList *sectionOrder = [self sectionOrder];
+    AAPLChangeJournalRun run = [sectionOrder removeRunForItemAtPosition:(NSUInteger)fromSection];
+    if (NSNotFound != run.section)
+        run.moved = YES;
+    [sectionOrder insertRun:run atPosition:(NSUInteger)toSection];
+    [self mapSectionKeysUsingBlock:map];
+}
+
+- (void)refreshSections:(NSIndexSet *)sections
+{
+    if (!sections.count)
+        return;
+
+    if (_includesSectionChanges) {
+        [self recordRefreshedSections:sections];
+        return;
+    }
+
+    NSMutableDictionary *remainingSections = [NSMutableDictionary dictionaryWithCapacity:_sections.count];
+    [_sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, AAPLChangeJournalRunList *section, BOOL *stop) {
+        NSUInteger sectionIndex = key.unsignedIntegerValue;
+        BOOL refreshed = [sections containsIndex:sectionIndex];
+
+        for (NSUInteger index = 0; index < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun *run = &section.runs[index];
+            if (NSNotFound == run->section || refreshed == [sections containsIndex:run->section])
+                continue;
+
+            // Original items that moved into a refreshed section are removed from where they were, and those that moved out of one are new where they are now
+            if (refreshed) {
+                [_originalRemovedIndexPaths addObject:AAPLChangeJournalOriginalIndexPath(*run)];
+                [_originalRefreshedIndexPaths removeObject:AAPLChangeJournalOriginalIndexPath(*run)];
+            }
+            else {
+                run->section = NSNotFound;
+                run->moved = NO;
+            }
+        }
+
+        if (!refreshed)
+            remainingSections[key] = section;
+    }];
+
+    NSUInteger (^unlessRefreshed)(NSUInteger) = ^NSUInteger(NSUInteger section) {
+        return [sections containsIndex:section] ? NSNotFound : section;
+    };
+    _originalRemovedIndexPaths = AAPLChangeJournalMapIndexPaths(_originalRemovedIndexPaths, unlessRefreshed);
+    _originalRefreshedIndexPaths = AAPLChangeJournalMapIndexPaths(_originalRefreshedIndexPaths, unlessRefreshed);
+    _sections = remainingSections;
+    _merged = NO;
+}
+
+/// The collection view reloads refreshed sections, so the changes recorded in them are worked out when the changes are merged. Only the items now in them that came from other sections need noting, because they may have changed as well.
+- (void)recordRefreshedSections:(NSIndexSet *)sections
+{
+    [sections enumerateIndexesUsingBlock:^(NSUInteger refreshedSection, BOOL *stop) {
+        NSUInteger originalSection = [self originalSectionAtIndex:refreshedSection];
+        if (NSNotFound != originalSection)
+            [_originalRefreshedSections addIndex:originalSection];
+
+        AAPLChangeJournalRunList *section = _sections[@(refreshedSection)];
+        for (NSUInteger index = 0; index < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun run = section.runs[index];
+            if (NSNotFound != run.section && run.section != originalSection)
+                [_originalRefreshedIndexPaths addObject:AAPLChangeJournalOriginalIndexPath(run)];
+        }
+    }];
+    _merged = NO;
+}
+
+- (void)removeAllChanges
+{
+    [_sections removeAllObjects];
+    [_originalRemovedIndexPaths removeAllObjects];
+    [_originalRefreshedIndexPaths removeAllObjects];
+    [_originalRemovedSections removeAllIndexes];
+    [_originalRefreshedSections removeAllIndexes];
+    _sectionOrder = nil;
+    _merged = NO;
+}
+
+/// Work out the section changes in batch terms. Returns the original sections whose items the collection view reads again: those removed, and those refreshed.
+- (NSIndexSet *)mergeSectionChanges
+{
+    NSMutableIndexSet *removedSections = [_originalRemovedSections mutableCopy];
+    NSMutableIndexSet *insertedSections = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *refreshedSections = [_originalRefreshedSections mutableCopy];
+    NSMutableArray *sectionMoves = [NSMutableArray array];
+
+    NSUInteger position = 0;
+    for (NSUInteger index = 0; index + 1 < _sectionOrder.numberOfRuns; ++index) {
+        AAPLChangeJournalRun run = _sectionOrder.runs[index];
+
+        if (NSNotFound == run.section)
+            [insertedSections addIndexesInRange:NSMakeRange(position, run.length)];
+        else if (run.moved) {
+            for (NSUInteger offset = 0; offset < run.length; ++offset) {
+                NSUInteger originalSection = run.item + offset;
+
+                // A section can't be moved and reloaded in the same batch
+                if ([refreshedSections containsIndex:originalSection]) {
+                    [refreshedSections removeIndex:originalSection];
+                    [removedSections addIndex:originalSection];
+                    [insertedSections addIndex:position + offset];
+                }
+                else
+                    [sectionMoves addObject:@[@(originalSection), @(position + offset)]];
+            }
+        }
+
+        position += run.length;
+    }
+
+    _removedSections = removedSections;
+    _insertedSections = insertedSections;
+    _refreshedSections = refreshedSections;
+    _sectionMoves = sectionMoves;
+
+    NSMutableIndexSet *reloadedSections = [_originalRemovedSections mutableCopy];
+    [reloadedSections addIndexes:_originalRefreshedSections];
+    return reloadedSections;
+}
+
+- (void)mergeChanges
+{
+    if (_merged)
+        return;
+
+    // Changes to items in sections the collection view reads again can't be part of the batch
+    NSIndexSet *reloadedSections = [self mergeSectionChanges];
+    NSMutableArray *removedIndexPaths = [NSMutableArray array];
+    for (NSIndexPath *indexPath in _originalRemovedIndexPaths) {
+        if (![reloadedSections containsIndex:(NSUInteger)indexPath.section])
+            [removedIndexPaths addObject:indexPath];
+    }
+    NSMutableSet *refreshedIndexPaths = [NSMutableSet setWithCapacity:_originalRefreshedIndexPaths.count];
+    for (NSIndexPath *indexPath in _originalRefreshedIndexPaths) {
+        if (![reloadedSections containsIndex:(NSUInteger)indexPath.section])
+            [refreshedIndexPaths addObject:indexPath];
+    }
+    NSMutableArray *insertedIndexPaths = [NSMutableArray array];
+    NSMutableArray *moves = [NSMutableArray array];
+
+    [_sections enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, AAPLChangeJournalRunList *section, BOOL *stop) {
+        NSInteger sectionIndex = key.integerValue;
+        NSUInteger originalSection = [self originalSectionAtIndex:(NSUInteger)sectionIndex];
+        // The collection view reads all the items of inserted and reloaded sections
+        BOOL reloaded = NSNotFound == originalSection || [reloadedSections containsIndex:originalSection];
+        NSUInteger position = 0;
+
+        // The last run is the untouched remainder of the section, which needs no updates
+        for (NSUInteger index = 0; index + 1 < section.numberOfRuns; ++index) {
+            AAPLChangeJournalRun run = section.runs[index];
+
+            if (NSNotFound == run.section) {
+                for (NSUInteger offset = 0; !reloaded && offset < run.length; ++offset)
+                    [insertedIndexPaths addObject:[NSIndexPath indexPathForItem:(NSInteger)(position + offset) inSection:sectionIndex]];
+            }
+            else if (reloaded) {
+                // Original items that moved into a reloaded section from another one are removed from there
+                NSIndexPath *fromIndexPath = AAPLChangeJournalOriginalIndexPath(run);
+                if (run.section != originalSection && ![reloadedSections containsIndex:run.section]) {
+                    [refreshedIndexPaths removeObject:fromIndexPath];
+                    [removedIndexPaths addObject:fromIndexPath];
+                }
+            }
+            else if (run.moved) {
+                NSIndexPath *fromIndexPath = AAPLChangeJournalOriginalIndexPath(run);
+                NSIndexPath *toIndexPath = [NSIndexPath indexPathForItem:(NSInteger)position inSection:sectionIndex];
+
+                // Items can't be moved out of a reloaded section, and an item can't be moved and reloaded in the same batch
+                if ([reloadedSections containsIndex:run.section])
+                    [insertedIndexPaths addObject:toIndexPath];
+                else if ([refreshedIndexPaths containsObject:fromIndexPath]) {
+                    [refreshedIndexPaths removeObject:fromIndexPath];
+                    [removedIndexPaths addObject:fromIndexPath];
+                    [insertedIndexPaths addObject:toIndexPath];
+                }
+                else
+                    [moves addObject:@[fromIndexPath, toIndexPath]];
+            }
+
+            position += run.length;
+        }
+    }];
+
+    _removedIndexPaths = [removedIndexPaths sortedArrayUsingSelector:@selector(compare:)];
+    _insertedIndexPaths = [insertedIndexPaths sortedArrayUsingSelector:@selector(compare:)];
+    _refreshedIndexPaths = [refreshedIndexPaths.allObjects sortedArrayUsingSelector:@selector(compare:)];
+    _moves = moves;
+    _merged = YES;
+}
+
+- (BOOL)hasChanges
+{
+    [self mergeChanges];
+    return _removedIndexPaths.count || _insertedIndexPaths.count || _refreshedIndexPaths.count || _moves.count || _removedSections.count || _insertedSections.count || _refreshedSections.count || _sectionMoves.count;
+}
+
+- (NSArray *)removedIndexPaths
+{
+    [self mergeChanges];
+    return _removedIndexPaths;
+}
+
+- (NSArray *)insertedIndexPaths
+{
+    [self mergeChanges];
+    return _insertedIndexPaths;
+}
+
+- (NSArray *)refreshedIndexPaths
+{
+    [self mergeChanges];
+    return _refreshedIndexPaths;
+}
+
+- (void)enumerateMovesUsingBlock:(void (^)(NSIndexPath *, NSIndexPath *, BOOL *))block
+{
+    NSParameterAssert(block != nil);
+    [self mergeChanges];
+
+    BOOL stop = NO;
+    for (NSArray *move in _moves) {
+        block(move[0], move[1], &stop);
+        if (stop)
+            break;
+    }
+}
+
+- (NSIndexSet *)removedSections
+{
+    [self mergeChanges];
+    return _removedSections;
+}
+
+- (NSIndexSet *)insertedSections
+{
+    [self mergeChanges];
+    return _insertedSections;
+}
+
+- (NSIndexSet *)refreshedSections
+{
+    [self mergeChanges];
+    return _refreshedSections;
+}
+
+- (void)enumerateSectionMovesUsingBlock:(void (^)(NSInteger, NSInteger, BOOL *))block
+{
+    NSParameterAssert(block != nil);
+    [self mergeChanges];
+
+    BOOL stop = NO;
+    for (NSArray *move in _sectionMoves) {
+        block([move[0] integerValue], [move[1] integerValue], &stop);
+        if (stop)
+            break;
+    }
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@: %p removed=%@ inserted=%@ refreshed=%@ moves=%@ removedSections=%@ insertedSections=%@ refreshedSections=%@ sectionMoves=%@>", NSStringFromClass(self.class), (__bridge void *)self, self.removedIndexPaths, self.insertedIndexPaths, self.refreshedIndexPaths, _moves, _removedSections, _insertedSections, _refreshedSections, _sectionMoves];
+}
+
+@end
@@ -18,6 +18,9 @@
 /// The number of sections in this mapping
 @property (nonatomic, readonly) NSInteger sectionCount;
 
+/// The global section of the first local section. Local sections map to consecutive global sections.
+@property (nonatomic, readonly) NSUInteger globalSectionOffset;
+
 /// Return the local section for a global section
 - (NSUInteger)localSectionForGlobalSection:(NSUInteger)globalSection;
 
@@ -36,9 +39,12 @@
 /// Return an array of global index paths from an array of local index paths
 - (NSArray *)globalIndexPathsForLocalIndexPaths:(NSArray *)localIndexPaths;
 
-/// Update the mapping of local sections to global sections.
+/// Update the mapping of local sections to global sections. Returns the global section following the last section of this mapping.
 - (NSUInteger)updateMappingsStartingWithGlobalSection:(NSUInteger)globalSection;
 
+/// Move the mapping by delta global sections without asking the data source for its number of sections.
+- (void)offsetGlobalSectionsBy:(NSInteger)delta;
+
 @end
 
 @interface AAPLComposedCollectionView : NSObject
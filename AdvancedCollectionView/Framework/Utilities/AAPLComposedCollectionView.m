@@ -10,13 +10,6 @@
 #import "AAPLDataSource.h"
 #import <objc/runtime.h>
 
-@interface AAPLComposedMapping ()
-
-@property (nonatomic, strong) NSMutableDictionary *globalToLocalSections;
-@property (nonatomic, strong) NSMutableDictionary *localToGlobalSections;
-
-@end
-
 @implementation AAPLComposedMapping
 
 - (instancetype)init
@@ -31,8 +24,6 @@
         return nil;
 
     _dataSource = dataSource;
-    _globalToLocalSections = [NSMutableDictionary dictionary];
-    _localToGlobalSections = [NSMutableDictionary dictionary];
     return self;
 }
 
@@ -40,24 +31,22 @@
 {
     AAPLComposedMapping *result = [[AAPLComposedMapping allocWithZone:zone] init];
     result.dataSource = self.dataSource;
-    result.globalToLocalSections = self.globalToLocalSections;
-    result.localToGlobalSections = self.localToGlobalSections;
+    result->_globalSectionOffset = _globalSectionOffset;
+    result->_sectionCount = _sectionCount;
 
     return result;
 }
 
 - (NSUInteger)localSectionForGlobalSection:(NSUInteger)globalSection
 {
-    NSNumber *localSection = _globalToLocalSections[@(globalSection)];
-    NSAssert(localSection != nil,@"globalSection %ld not found in globalToLocalSections: %@",(long)globalSection,_globalToLocalSections);
-    return [localSection unsignedIntegerValue];
+    NSAssert(globalSection >= _globalSectionOffset && globalSection < _globalSectionOffset + _sectionCount, @"globalSection %ld not found in mapping of sections %ld..<%ld", (long)globalSection, (long)_globalSectionOffset, (long)(_globalSectionOffset + _sectionCount));
+    return globalSection - _globalSectionOffset;
 }
 
 - (NSUInteger)globalSectionForLocalSection:(NSUInteger)localSection
 {
-    NSNumber *globalSection = _localToGlobalSections[@(localSection)];
-    NSAssert(globalSection != nil,@"localSection %ld not found in localToGlobalSections:%@",(long)localSection,_localToGlobalSections);
-    return [globalSection unsignedIntegerValue];
+    NSAssert(localSection < (NSUInteger)_sectionCount, @"localSection %ld not found in mapping of %ld sections", (long)localSection, (long)_sectionCount);
+    return localSection + _globalSectionOffset;
 }
 
 - (NSIndexPath *)localIndexPathForGlobalIndexPath:(NSIndexPath *)globalIndexPath
@@ -72,24 +61,16 @@
     return [NSIndexPath indexPathForItem:localIndexPath.item inSection:section];
 }
 
-- (void)addMappingFromGlobalSection:(NSUInteger)globalSection toLocalSection:(NSUInteger)localSection
-{
-    NSNumber *globalNum = @(globalSection);
-    NSNumber *localNum = @(localSection);
-    NSAssert(_localToGlobalSections[localNum] == nil, @"collision while trying to add to a mapping");
-    _globalToLocalSections[globalNum] = localNum;
-    _localToGlobalSections[localNum] = globalNum;
-}
-
 - (NSUInteger)updateMappingsStartingWithGlobalSection:(NSUInteger)globalSection
 {
     _sectionCount = _dataSource.numberOfSections;
-    [_globalToLocalSections removeAllObjects];
-    [_localToGlobalSections removeAllObjects];
+    _globalSectionOffset = globalSection;
+    return globalSection + _sectionCount;
+}
 
-    for (NSUInteger localSection = 0; localSection<_sectionCount; localSection++)
-        [self addMappingFromGlobalSection:globalSection++ toLocalSection:localSection];
-    return globalSection;
+- (void)offsetGlobalSectionsBy:(NSInteger)delta
+{
+    _globalSectionOffset += delta;
 }
 
 - (NSArray *)localIndexPathsForGlobalIndexPaths:(NSArray *)globalIndexPaths
@@ -27,6 +27,15 @@ typedef void (^AAPLLoadingUpdateBlock)(id object);
 /// A block called when loading completes.
 typedef void (^AAPLLoadingCompletionBlock)(NSString *state, NSError *error, AAPLLoadingUpdateBlock update);
 
+/// How urgently a load is needed. Loads do their work on a global queue of the matching priority.
+typedef NS_ENUM(NSInteger, AAPLLoadingPriority) {
+    /// Content that isn't on screen, such as a screen the user has moved away from.
+    AAPLLoadingPriorityBackground,
+    AAPLLoadingPriorityDefault,
+    /// Content for the screen the user is looking at.
+    AAPLLoadingPriorityUserInitiated,
+};
+
 /// A helper class passed to the content loading block of an AAPLLoadableContentViewController.
 @interface AAPLLoading : NSObject
 
@@ -42,6 +51,21 @@ typedef void (^AAPLLoadingCompletionBlock)(NSString *state, NSError *error, AAPL
 /// Is this the current loading operation? When -loadContentWithBlock: is called it should inform previous instances of AAPLLoading that they are no longer the current instance.
 @property (nonatomic, getter=isCurrent) BOOL current;
 
+/// Stop this load. The loading block should check isCancelled between steps and stop doing work once it's set. Cancellation handlers are called and the completion handler is called as if the load had been ignored. Loads that finish after being cancelled are ignored as well. May be called on any thread.
+- (void)cancel;
+
+/// Has this load been cancelled? Safe to check from any thread.
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/// Add a block to call when the load is cancelled, for instance to cancel a network request. If the load has already been cancelled, the block is called right away. Handlers are called on the thread that cancels the load.
+- (void)addCancellationHandler:(dispatch_block_t)handler;
+
+/// The priority of this load. Default is AAPLLoadingPriorityDefault.
+@property (nonatomic) AAPLLoadingPriority priority;
+
+/// A global queue matching the priority, for the loading block to do its work on.
+@property (nonatomic, readonly) dispatch_queue_t queue;
+
 - (instancetype)initWithCompletionHandler:(AAPLLoadingCompletionBlock)handler;
 
 @end
@@ -4,6 +4,7 @@
  */
 
 #import "AAPLContentLoading.h"
+#import <libkern/OSAtomic.h>
 
 NSString *const AAPLLoadStateInitial = @"Initial";
 NSString *const AAPLLoadStateLoadingContent = @"LoadingState";
@@ -15,10 +16,15 @@ NSString *const AAPLLoadStateError = @"ErrorState";
 @interface AAPLLoading ()
 
 @property (nonatomic, copy) AAPLLoadingCompletionBlock block;
+@property (nonatomic, strong) NSMutableArray *cancellationHandlers;
 
 @end
 
-@implementation AAPLLoading
+@implementation AAPLLoading {
+    volatile int32_t _cancelled;
+    /// Set by whichever of completion and cancellation comes first
+    volatile int32_t _finished;
+}
 
 - (instancetype)initWithCompletionHandler:(AAPLLoadingCompletionBlock)handler
 {
@@ -27,19 +33,83 @@ NSString *const AAPLLoadStateError = @"ErrorState";
 	if (!self) return nil;
 	self.block = handler;
 	self.current = YES;
+	_priority = AAPLLoadingPriorityDefault;
 	return self;
 }
 
 - (void)doneWithNewState:(NSString *)newState error:(NSError *)error update:(AAPLLoadingUpdateBlock)update
 {
+    // Loads may finish on any thread, possibly while being cancelled on another
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_finished))
+        return;
+
 	AAPLLoadingCompletionBlock block = self.block;
 	self.block = nil;
 
+    if (self.cancelled) {
+        newState = nil;
+        update = NULL;
+    }
+
     dispatch_async(dispatch_get_main_queue(), ^{
         block(newState, error, update);
     });
 }
 
+- (BOOL)isCancelled
+{
+    return _cancelled != 0;
+}
+
+- (void)cancel
+{
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_cancelled))
+        return;
+
+    self.current = NO;
+
+    NSArray *handlers;
+    @synchronized(self) {
+        handlers = _cancellationHandlers;
+        _cancellationHandlers = nil;
+    }
+
+    for (dispatch_block_t handler in handlers)
+        handler();
+
+    // Let go of the completion handler and whatever it holds on to
+    [self ignore];
+}
+
+- (void)addCancellationHandler:(dispatch_block_t)handler
+{
+    NSParameterAssert(handler != nil);
+
+    @synchronized(self) {
+        if (!self.cancelled) {
+            if (!_cancellationHandlers)
+                _cancellationHandlers = [NSMutableArray array];
+            [_cancellationHandlers addObject:[handler copy]];
+            return;
+        }
+    }
+
+    handler();
+}
+
+- (dispatch_queue_t)queue
+{
+    switch (_priority) {
+        case AAPLLoadingPriorityBackground:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+        case AAPLLoadingPriorityUserInitiated:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+        case AAPLLoadingPriorityDefault:
+        default:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    }
+}
+
 - (void)ignore
 {
     [self doneWithNewState:nil error:nil update:NULL];
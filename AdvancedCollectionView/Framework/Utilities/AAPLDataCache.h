@@ -0,0 +1,54 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import <Foundation/Foundation.h>
+
+/// Delivers a value fetched after a cache miss. Pass nil and an error if the value couldn't be fetched. May be called on any thread.
+typedef void (^AAPLDataCacheFetchCompletion)(id propertyList, NSError *error);
+
+/// Fetches a value the cache doesn't have, calling the completion once it's done.
+typedef void (^AAPLDataCacheFetchBlock)(AAPLDataCacheFetchCompletion completion);
+
+/// A two tier cache of property lists. The memory tier keeps the most recently used values within a byte limit, and the disk tier keeps them as binary property list files within another, so they survive relaunches. The cost of a value is the size of its binary encoding. Requests for a key that is already being fetched wait for that fetch instead of starting another. Safe to use from any thread.
+@interface AAPLDataCache : NSObject
+
+/// Create a cache that keeps its files in a directory with this name inside the caches directory.
+- (instancetype)initWithName:(NSString *)name memoryCostLimit:(NSUInteger)memoryCostLimit diskCostLimit:(NSUInteger)diskCostLimit;
+
+@property (nonatomic, readonly, copy) NSString *name;
+/// The most bytes of values kept in memory. When exceeded, the least recently used values are evicted.
+@property (nonatomic, readonly) NSUInteger memoryCostLimit;
+/// The most bytes of values kept on disk. When exceeded, the least recently used files are removed.
+@property (nonatomic, readonly) NSUInteger diskCostLimit;
+
+/// Get the value for key from memory, then from disk, then by calling fetchBlock on a background queue. The handler is called right away for a value in memory and on the main queue otherwise. Values that are fetched are stored in both tiers.
+- (void)fetchObjectForKey:(NSString *)key usingBlock:(AAPLDataCacheFetchBlock)fetchBlock completionHandler:(void(^)(id propertyList, NSError *error))handler;
+
+/// The value for key if it's in memory, without looking on disk. Counts as a hit or a miss.
+- (id)objectInMemoryForKey:(NSString *)key;
+
+/// Store a value in both tiers. The value must be a property list.
+- (void)setObject:(id)propertyList forKey:(NSString *)key;
+- (void)removeObjectForKey:(NSString *)key;
+- (void)removeAllObjects;
+
+#pragma mark - Statistics
+
+@property (readonly) NSUInteger numberOfMemoryHits;
+@property (readonly) NSUInteger numberOfDiskHits;
+/// Requests that had to be fetched, not counting the ones that shared a fetch already in progress.
+@property (readonly) NSUInteger numberOfMisses;
+/// Requests that waited for a fetch already in progress.
+@property (readonly) NSUInteger numberOfSharedFetches;
+@property (readonly) NSUInteger numberOfMemoryEvictions;
+@property (readonly) NSUInteger numberOfDiskEvictions;
+/// The bytes of values in memory.
+@property (readonly) NSUInteger memoryCost;
+/// The bytes of values on disk.
+@property (readonly) NSUInteger diskCost;
+/// The fraction of requests answered from memory or disk.
+@property (readonly) double hitRate;
+
+@end
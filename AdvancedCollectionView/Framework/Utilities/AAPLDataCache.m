@@ -0,0 +1,404 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLDataCache.h"
+
+/// A value in the memory tier, in a list from most to least recently used
+@interface AAPLDataCacheEntry : NSObject
+@property (nonatomic, copy) NSString *key;
+@property (nonatomic, strong) id value;
+@property (nonatomic) NSUInteger cost;
+@property (nonatomic, strong) AAPLDataCacheEntry *next;
+@property (nonatomic, unsafe_unretained) AAPLDataCacheEntry *previous;
+@end
+
+@implementation AAPLDataCacheEntry
+@end
+
+/// The name of the file for a key, a 64 bit FNV-1a hash. Files also hold their key, so a collision is a miss rather than the wrong value.
+static NSString *AAPLDataCacheFileNameForKey(NSString *key)
+{
+    const char *bytes = key.UTF8String;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *byte = bytes; *byte; ++byte) {
+        hash ^= (uint8_t)*byte;
+        hash *= 0x100000001b3ULL;
+    }
+    return [NSString stringWithFormat:@"%016llx.plist", hash];
+}
+
+@interface AAPLDataCache ()
+@property (readwrite) NSUInteger numberOfMemoryHits;
+@property (readwrite) NSUInteger numberOfDiskHits;
+@property (readwrite) NSUInteger numberOfMisses;
+@property (readwrite) NSUInteger numberOfSharedFetches;
+@property (readwrite) NSUInteger numberOfMemoryEvictions;
+@property (readwrite) NSUInteger numberOfDiskEvictions;
+@property (readwrite) NSUInteger memoryCost;
+@property (readwrite) NSUInteger diskCost;
+@end
+
+@implementation AAPLDataCache {
+    // The memory tier and the fetches in progress are guarded by @synchronized(self)
+    NSMutableDictionary *_entries;
+    AAPLDataCacheEntry *_mostRecentlyUsedEntry;
+    AAPLDataCacheEntry *_leastRecentlyUsedEntry;
+    /// The handlers waiting for each key being fetched
+    NSMutableDictionary *_pendingHandlers;
+
+    // The disk tier is only touched on _diskQueue
+    dispatch_queue_t _diskQueue;
+    NSURL *_directoryURL;
+    /// File names from least to most recently used, and the size of each file. Loaded from the directory on first use.
+    NSMutableOrderedSet *_fileNames;
+    NSMutableDictionary *_fileSizes;
+}
+
+- (instancetype)initWithName:(NSString *)name memoryCostLimit:(NSUInteger)memoryCostLimit diskCostLimit:(NSUInteger)diskCostLimit
+{
+    NSParameterAssert(name.length > 0);
+
+    self = [super init];
+    if (!self)
+        return nil;
+
+    _name = [name copy];
+    _memoryCostLimit = memoryCostLimit;
+    _diskCostLimit = diskCostLimit;
+    _entries = [NSMutableDictionary dictionary];
+    _pendingHandlers = [NSMutableDictionary dictionary];
+
+    NSString *queueName = [NSString stringWithFormat:@"com.example.apple-samplecode.AdvancedCollectionView.DataCache.%@", name];
+    _diskQueue = dispatch_queue_create(queueName.UTF8String, DISPATCH_QUEUE_SERIAL);
+
+    NSURL *cachesURL = [[[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+    _directoryURL = [cachesURL URLByAppendingPathComponent:name isDirectory:YES];
+
+    return self;
+}
+
+- (double)hitRate
+{
+    NSUInteger hits, requests;
+    @synchronized(self) {
+        hits = _numberOfMemoryHits + _numberOfDiskHits;
+        requests = hits + _numberOfMisses + _numberOfSharedFetches;
+    }
+    return requests ? (double)hits / requests : 0;
+}
+
+#pragma mark - Memory tier
+
+/// Must be called within @synchronized(self)
+- (void)unlinkEntry:(AAPLDataCacheEntry *)entry
+{
+    AAPLDataCacheEntry *next = entry.next;
+    AAPLDataCacheEntry *previous = entry.previous;
+
+    if (previous)
+        previous.next = next;
+    else
+        _mostRecentlyUsedEntry = next;
+
+    if (next)
+        next.previous = previous;
+    else
+        _leastRecentlyUsedEntry = previous;
+
+    entry.next = nil;
+    entry.previous = nil;
+}
+
+/// Must be called within @synchronized(self)
+- (void)linkEntryAsMostRecentlyUsed:(AAPLDataCacheEntry *)entry
+{
+    entry.next = _mostRecentlyUsedEntry;
+    _mostRecentlyUsedEntry.previous = entry;
+    _mostRecentlyUsedEntry = entry;
+    if (!_leastRecentlyUsedEntry)
+        _leastRecentlyUsedEntry = entry;
+}
+
+/// Must be called within @synchronized(self)
+- (id)memoryObjectForKey:(NSString *)key
+{
+    AAPLDataCacheEntry *entry = _entries[key];
+    if (!entry)
+        return nil;
+
+    if (entry != _mostRecentlyUsedEntry) {
+        [self unlinkEntry:entry];
+        [self linkEntryAsMostRecentlyUsed:entry];
+    }
+    return entry.value;
+}
+
+/// Must be called within @synchronized(self)
+- (void)setMemoryObject:(id)value cost:(NSUInteger)cost forKey:(NSString *)key
+{
+    [self removeMemoryObjectForKey:key];
+
+    // A value that can never fit would only push out everything else
+    if (cost > _memoryCostLimit)
+        return;
+
+    AAPLDataCacheEntry *entry = [[AAPLDataCacheEntry alloc] init];
+    entry.key = key;
+    entry.value = value;
+    entry.cost = cost;
+    _entries[key] = entry;
+    [self linkEntryAsMostRecentlyUsed:entry];
+    _memoryCost += cost;
+
+    while (_memoryCost > _memoryCostLimit) {
+        AAPLDataCacheEntry *leastRecentlyUsedEntry = _leastRecentlyUsedEntry;
+        [self removeMemoryObjectForKey:leastRecentlyUsedEntry.key];
+        ++_numberOfMemoryEvictions;
+    }
+}
+
+/// Must be called within @synchronized(self)
+- (void)removeMemoryObjectForKey:(NSString *)key
+{
+    AAPLDataCacheEntry *entry = _entries[key];
+    if (!entry)
+        return;
+
+    [self unlinkEntry:entry];
+    [_entries removeObjectForKey:key];
+    _memoryCost -= entry.cost;
+}
+
+#pragma mark - Disk tier
+
+/// Must be called on _diskQueue
+- (void)loadFileIndexIfNeeded
+{
+    if (_fileNames)
+        return;
+
+    _fileNames = [NSMutableOrderedSet orderedSet];
+    _fileSizes = [NSMutableDictionary dictionary];
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager createDirectoryAtURL:_directoryURL withIntermediateDirectories:YES attributes:nil error:NULL];
+
+    NSArray *keys = @[NSURLFileSizeKey, NSURLContentModificationDateKey];
+    NSArray *fileURLs = [fileManager contentsOfDirectoryAtURL:_directoryURL includingPropertiesForKeys:keys options:NSDirectoryEnumerationSkipsHiddenFiles error:NULL];
+
+    // Files are touched when they're read, so the modification date orders them by use
+    fileURLs = [fileURLs sortedArrayUsingComparator:^(NSURL *url1, NSURL *url2) {
+        NSDate *date1, *date2;
+        [url1 getResourceValue:&date1 forKey:NSURLContentModificationDateKey error:NULL];
+        [url2 getResourceValue:&date2 forKey:NSURLContentModificationDateKey error:NULL];
+        return [date1 compare:date2];
+    }];
+
+    NSUInteger diskCost = 0;
+    for (NSURL *fileURL in fileURLs) {
+        NSNumber *fileSize;
+        [fileURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:NULL];
+        [_fileNames addObject:fileURL.lastPathComponent];
+        _fileSizes[fileURL.lastPathComponent] = fileSize ?: @0;
+        diskCost += fileSize.unsignedIntegerValue;
+    }
+
+    self.diskCost = diskCost;
+}
+
+/// Read the value for key and the cost of its encoding. Must be called on _diskQueue.
+- (id)diskObjectForKey:(NSString *)key cost:(NSUInteger *)cost
+{
+    [self loadFileIndexIfNeeded];
+
+    NSString *fileName = AAPLDataCacheFileNameForKey(key);
+    if (![_fileNames containsObject:fileName])
+        return nil;
+
+    NSURL *fileURL = [_directoryURL URLByAppendingPathComponent:fileName];
+    NSData *data = [NSData dataWithContentsOfURL:fileURL];
+    NSDictionary *file = (data ? [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:NULL] : nil);
+    if (![file isKindOfClass:[NSDictionary class]] || ![file[@"key"] isEqual:key])
+        return nil;
+
+    [_fileNames removeObject:fileName];
+    [_fileNames addObject:fileName];
+    [fileURL setResourceValue:[NSDate date] forKey:NSURLContentModificationDateKey error:NULL];
+
+    if (cost)
+        *cost = data.length;
+    return file[@"value"];
+}
+
+/// Must be called on _diskQueue
+- (void)writeDiskData:(NSData *)data forKey:(NSString *)key
+{
+    [self loadFileIndexIfNeeded];
+
+    NSString *fileName = AAPLDataCacheFileNameForKey(key);
+    [self removeFileWithName:fileName];
+
+    if (data.length > _diskCostLimit)
+        return;
+    if (![data writeToURL:[_directoryURL URLByAppendingPathComponent:fileName] atomically:YES])
+        return;
+
+    [_fileNames addObject:fileName];
+    _fileSizes[fileName] = @(data.length);
+    self.diskCost += data.length;
+
+    while (self.diskCost > _diskCostLimit) {
+        [self removeFileWithName:_fileNames.firstObject];
+        @synchronized(self) {
+            ++_numberOfDiskEvictions;
+        }
+    }
+}
+
+/// Must be called on _diskQueue
+- (void)removeFileWithName:(NSString *)fileName
+{
+    NSNumber *fileSize = _fileSizes[fileName];
+    if (!fileSize)
+        return;
+
+    [[NSFileManager defaultManager] removeItemAtURL:[_directoryURL URLByAppendingPathComponent:fileName] error:NULL];
+    [_fileNames removeObject:fileName];
+    [_fileSizes removeObjectForKey:fileName];
+    self.diskCost -= fileSize.unsignedIntegerValue;
+}
+
+#pragma mark - Public API
+
+- (id)objectInMemoryForKey:(NSString *)key
+{
+    NSParameterAssert(key != nil);
+
+    @synchronized(self) {
+        id value = [self memoryObjectForKey:key];
+        if (value)
+            ++_numberOfMemoryHits;
+        else
+            ++_numberOfMisses;
+        return value;
+    }
+}
+
+- (void)fetchObjectForKey:(NSString *)key usingBlock:(AAPLDataCacheFetchBlock)fetchBlock completionHandler:(void (^)(id, NSError *))handler
+{
+    NSParameterAssert(key != nil);
+    NSParameterAssert(fetchBlock != nil);
+    NSParameterAssert(handler != nil);
+
+    id value;
+    @synchronized(self) {
+        value = [self memoryObjectForKey:key];
+        if (value)
+            ++_numberOfMemoryHits;
+        else {
+            NSMutableArray *handlers = _pendingHandlers[key];
+            if (handlers) {
+                [handlers addObject:[handler copy]];
+                ++_numberOfSharedFetches;
+                return;
+            }
+            _pendingHandlers[key] = [NSMutableArray arrayWithObject:[handler copy]];
+        }
+    }
+
+    if (value) {
+        handler(value, nil);
+        return;
+    }
+
+    dispatch_async(_diskQueue, ^{
+        NSUInteger cost = 0;
+        id diskValue = [self diskObjectForKey:key cost:&cost];
+        if (diskValue) {
+            @synchronized(self) {
+                ++_numberOfDiskHits;
+                [self setMemoryObject:diskValue cost:cost forKey:key];
+            }
+            [self finishFetchForKey:key value:diskValue error:nil];
+            return;
+        }
+
+        @synchronized(self) {
+            ++_numberOfMisses;
+        }
+
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            fetchBlock(^(id fetchedValue, NSError *error) {
+                if (fetchedValue)
+                    [self setObject:fetchedValue forKey:key];
+                [self finishFetchForKey:key value:fetchedValue error:error];
+            });
+        });
+    });
+}
+
+- (void)finishFetchForKey:(NSString *)key value:(id)value error:(NSError *)error
+{
+    NSArray *handlers;
+    @synchronized(self) {
+        handlers = _pendingHandlers[key];
+        [_pendingHandlers removeObjectForKey:key];
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        for (void (^handler)(id, NSError *) in handlers)
+            handler(value, error);
+    });
+}
+
+- (void)setObject:(id)propertyList forKey:(NSString *)key
+{
+    NSParameterAssert(propertyList != nil);
+    NSParameterAssert(key != nil);
+
+    NSError *error;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:@{ @"key" : key, @"value" : propertyList } format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+    NSAssert(data != nil, @"cached values must be property lists: %@", error);
+    if (!data)
+        return;
+
+    @synchronized(self) {
+        [self setMemoryObject:propertyList cost:data.length forKey:key];
+    }
+
+    dispatch_async(_diskQueue, ^{
+        [self writeDiskData:data forKey:key];
+    });
+}
+
+- (void)removeObjectForKey:(NSString *)key
+{
+    NSParameterAssert(key != nil);
+
+    @synchronized(self) {
+        [self removeMemoryObjectForKey:key];
+    }
+
+    dispatch_async(_diskQueue, ^{
+        [self loadFileIndexIfNeeded];
+        [self removeFileWithName:AAPLDataCacheFileNameForKey(key)];
+    });
+}
+
+- (void)removeAllObjects
+{
+    @synchronized(self) {
+        for (NSString *key in _entries.allKeys)
+            [self removeMemoryObjectForKey:key];
+    }
+
+    dispatch_async(_diskQueue, ^{
+        [self loadFileIndexIfNeeded];
+        for (NSString *fileName in [[_fileNames array] copy])
+            [self removeFileWithName:fileName];
+    });
+}
+
+@end
@@ -0,0 +1,336 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLJSONArrayScanner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    /// Before the top level value
+    AAPLJSONArrayScannerStateDocument,
+    /// Before a member name or the end of the top level object
+    AAPLJSONArrayScannerStateMemberStart,
+    AAPLJSONArrayScannerStateMemberName,
+    AAPLJSONArrayScannerStateMemberColon,
+    /// Before a member value
+    AAPLJSONArrayScannerStateMemberValue,
+    /// Before an array element or the end of the array
+    AAPLJSONArrayScannerStateElementStart,
+    /// Within an array element or a member value
+    AAPLJSONArrayScannerStateValue,
+    AAPLJSONArrayScannerStateDone,
+    AAPLJSONArrayScannerStateStopped,
+    AAPLJSONArrayScannerStateFailed,
+} AAPLJSONArrayScannerState;
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} AAPLJSONArrayScannerBuffer;
+
+struct AAPLJSONArrayScanner {
+    char *key;
+    size_t keyLength;
+    AAPLJSONArrayScannerCallbacks callbacks;
+    void *context;
+
+    AAPLJSONArrayScannerState state;
+    /// Whether the value being scanned is an array element rather than a member value
+    bool inElement;
+    bool inString;
+    bool escaped;
+    /// Nesting of objects and arrays within the value being scanned
+    size_t depth;
+
+    /// The bytes of a name or value split across calls
+    AAPLJSONArrayScannerBuffer name;
+    AAPLJSONArrayScannerBuffer value;
+
+    size_t numberOfElements;
+};
+
+static bool AAPLJSONArrayScannerBufferAppend(AAPLJSONArrayScannerBuffer *buffer, const char *bytes, size_t length)
+{
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < buffer->length + length)
+            capacity *= 2;
+        char *newBytes = realloc(buffer->bytes, capacity);
+        if (!newBytes)
+            return false;
+        buffer->bytes = newBytes;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+    return true;
+}
+
+static inline bool AAPLJSONArrayScannerIsWhiteSpace(char c)
+{
+    return ' ' == c || '\n' == c || '\r' == c || '\t' == c;
+}
+
+static AAPLJSONArrayScannerResult AAPLJSONArrayScannerFail(AAPLJSONArrayScannerRef scanner)
+{
+    scanner->state = AAPLJSONArrayScannerStateFailed;
+    return AAPLJSONArrayScannerResultError;
+}
+
+AAPLJSONArrayScannerRef AAPLJSONArrayScannerCreate(const char *key, const AAPLJSONArrayScannerCallbacks *callbacks, void *context)
+{
+    AAPLJSONArrayScannerRef scanner = calloc(1, sizeof(struct AAPLJSONArrayScanner));
+    if (!scanner)
+        return NULL;
+
+    if (key) {
+        scanner->keyLength = strlen(key);
+        scanner->key = malloc(scanner->keyLength + 1);
+        if (!scanner->key) {
+            free(scanner);
+            return NULL;
+        }
+        memcpy(scanner->key, key, scanner->keyLength + 1);
+    }
+
+    scanner->callbacks = *callbacks;
+    scanner->context = context;
+    scanner->state = AAPLJSONArrayScannerStateDocument;
+    return scanner;
+}
+
+void AAPLJSONArrayScannerRelease(AAPLJSONArrayScannerRef scanner)
+{
+    if (!scanner)
+        return;
+    free(scanner->key);
+    free(scanner->name.bytes);
+    free(scanner->value.bytes);
+    free(scanner);
+}
+
+/// Start scanning a value at the current byte
+static void AAPLJSONArrayScannerBeginValue(AAPLJSONArrayScannerRef scanner, bool inElement)
+{
+    scanner->state = AAPLJSONArrayScannerStateValue;
+    scanner->inElement = inElement;
+    scanner->inString = false;
+    scanner->escaped = false;
+    scanner->depth = 0;
+    scanner->value.length = 0;
+}
+
+AAPLJSONArrayScannerResult AAPLJSONArrayScannerAppendBytes(AAPLJSONArrayScannerRef scanner, const char *bytes, size_t length)
+{
+    // Where the name or value being scanned starts within these bytes
+    size_t spanStart = 0;
+    size_t position = 0;
+
+    while (position < length) {
+        char c = bytes[position];
+
+        switch (scanner->state) {
+            case AAPLJSONArrayScannerStateDocument:
+                if (AAPLJSONArrayScannerIsWhiteSpace(c)) {
+                    ++position;
+                    break;
+                }
+                if (c != (scanner->key ? '{' : '['))
+                    return AAPLJSONArrayScannerFail(scanner);
+                scanner->state = (scanner->key ? AAPLJSONArrayScannerStateMemberStart : AAPLJSONArrayScannerStateElementStart);
+                ++position;
+                break;
+
+            case AAPLJSONArrayScannerStateMemberStart:
+                if (AAPLJSONArrayScannerIsWhiteSpace(c) || ',' == c) {
+                    ++position;
+                    break;
+                }
+                if ('}' == c)
+                    scanner->state = AAPLJSONArrayScannerStateDone;
+                else if ('"' == c) {
+                    scanner->state = AAPLJSONArrayScannerStateMemberName;
+                    scanner->escaped = false;
+                    scanner->name.length = 0;
+                    spanStart = position + 1;
+                }
+                else
+                    return AAPLJSONArrayScannerFail(scanner);
+                ++position;
+                break;
+
+            case AAPLJSONArrayScannerStateMemberName:
+                for (; position < length; ++position) {
+                    c = bytes[position];
+                    if (scanner->escaped)
+                        scanner->escaped = false;
+                    else if ('\\' == c)
+                        scanner->escaped = true;
+                    else if ('"' == c)
+                        break;
+                }
+                if (position == length)
+                    break;
+                if (!AAPLJSONArrayScannerBufferAppend(&scanner->name, bytes + spanStart, position - spanStart))
+                    return AAPLJSONArrayScannerFail(scanner);
+                scanner->state = AAPLJSONArrayScannerStateMemberColon;
+                ++position;
+                break;
+
+            case AAPLJSONArrayScannerStateMemberColon:
+                if (':' == c)
+                    scanner->state = AAPLJSONArrayScannerStateMemberValue;
+                else if (!AAPLJSONArrayScannerIsWhiteSpace(c))
+                    return AAPLJSONArrayScannerFail(scanner);
+                ++position;
+                break;
+
+            case AAPLJSONArrayScannerStateMemberValue:
+                if (AAPLJSONArrayScannerIsWhiteSpace(c)) {
+                    ++position;
+                    break;
+                }
+                if ('[' == c && scanner->name.length == scanner->keyLength && !memcmp(scanner->name.bytes, scanner->key, scanner->keyLength)) {
+                    scanner->state = AAPLJSONArrayScannerStateElementStart;
+                    ++position;
+                    break;
+                }
+                AAPLJSONArrayScannerBeginValue(scanner, false);
+                spanStart = position;
+                break;
+
+            case AAPLJSONArrayScannerStateElementStart:
+                if (AAPLJSONArrayScannerIsWhiteSpace(c) || ',' == c) {
+                    ++position;
+                    break;
+                }
+                if (']' == c) {
+                    scanner->state = (scanner->key ? AAPLJSONArrayScannerStateMemberStart : AAPLJSONArrayScannerStateDone);
+                    ++position;
+                    break;
+                }
+                AAPLJSONArrayScannerBeginValue(scanner, true);
+                spanStart = position;
+                break;
+
+            case AAPLJSONArrayScannerStateValue: {
+                char closer = (scanner->inElement ? ']' : '}');
+                bool finished = false;
+
+                for (; position < length; ++position) {
+                    c = bytes[position];
+                    if (scanner->inString) {
+                        if (scanner->escaped)
+                            scanner->escaped = false;
+                        else if ('\\' == c)
+                            scanner->escaped = true;
+                        else if ('"' == c)
+                            scanner->inString = false;
+                    }
+                    else if ('"' == c)
+                        scanner->inString = true;
+                    else if ('{' == c || '[' == c)
+                        ++scanner->depth;
+                    else if ('}' == c || ']' == c) {
+                        if (!scanner->depth) {
+                            if (c != closer)
+                                return AAPLJSONArrayScannerFail(scanner);
+                            finished = true;
+                            break;
+                        }
+                        --scanner->depth;
+                    }
+                    else if (',' == c && !scanner->depth) {
+                        finished = true;
+                        break;
+                    }
+                }
+
+                if (!finished)
+                    break;
+
+                // Only a value split across calls has been buffered
+                const char *value = bytes + spanStart;
+                size_t valueLength = position - spanStart;
+                if (scanner->value.length) {
+                    if (!AAPLJSONArrayScannerBufferAppend(&scanner->value, value, valueLength))
+                        return AAPLJSONArrayScannerFail(scanner);
+                    value = scanner->value.bytes;
+                    valueLength = scanner->value.length;
+                }
+
+                while (valueLength && AAPLJSONArrayScannerIsWhiteSpace(value[valueLength - 1]))
+                    --valueLength;
+                if (!valueLength)
+                    return AAPLJSONArrayScannerFail(scanner);
+
+                bool shouldContinue = true;
+                if (scanner->inElement) {
+                    ++scanner->numberOfElements;
+                    shouldContinue = scanner->callbacks.element(value, valueLength, scanner->context);
+                }
+                else if (scanner->callbacks.member)
+                    shouldContinue = scanner->callbacks.member(scanner->name.bytes, scanner->name.length, value, valueLength, scanner->context);
+
+                scanner->value.length = 0;
+
+                if (',' == c)
+                    scanner->state = (scanner->inElement ? AAPLJSONArrayScannerStateElementStart : AAPLJSONArrayScannerStateMemberStart);
+                else if (scanner->inElement && scanner->key)
+                    scanner->state = AAPLJSONArrayScannerStateMemberStart;
+                else
+                    scanner->state = AAPLJSONArrayScannerStateDone;
+                ++position;
+
+                if (!shouldContinue) {
+                    scanner->state = AAPLJSONArrayScannerStateStopped;
+                    return AAPLJSONArrayScannerResultStopped;
+                }
+                break;
+            }
+
+            case AAPLJSONArrayScannerStateDone:
+                if (!AAPLJSONArrayScannerIsWhiteSpace(c))
+                    return AAPLJSONArrayScannerFail(scanner);
+                ++position;
+                break;
+
+            case AAPLJSONArrayScannerStateStopped:
+                return AAPLJSONArrayScannerResultStopped;
+
+            case AAPLJSONArrayScannerStateFailed:
+                return AAPLJSONArrayScannerResultError;
+        }
+    }
+
+    // Keep the start of a name or value that continues in the next call
+    if (AAPLJSONArrayScannerStateMemberName == scanner->state) {
+        if (!AAPLJSONArrayScannerBufferAppend(&scanner->name, bytes + spanStart, length - spanStart))
+            return AAPLJSONArrayScannerFail(scanner);
+    }
+    else if (AAPLJSONArrayScannerStateValue == scanner->state) {
+        if (!AAPLJSONArrayScannerBufferAppend(&scanner->value, bytes + spanStart, length - spanStart))
+            return AAPLJSONArrayScannerFail(scanner);
+    }
+
+    if (AAPLJSONArrayScannerStateStopped == scanner->state)
+        return AAPLJSONArrayScannerResultStopped;
+    if (AAPLJSONArrayScannerStateFailed == scanner->state)
+        return AAPLJSONArrayScannerResultError;
+    return AAPLJSONArrayScannerResultContinue;
+}
+
+bool AAPLJSONArrayScannerIsComplete(AAPLJSONArrayScannerRef scanner)
+{
+    return AAPLJSONArrayScannerStateDone == scanner->state;
+}
+
+size_t AAPLJSONArrayScannerGetNumberOfElements(AAPLJSONArrayScannerRef scanner)
+{
+    return scanner->numberOfElements;
+}
@@ -0,0 +1,57 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_JSON_ARRAY_SCANNER_H
+#define AAPL_JSON_ARRAY_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Splits a JSON array into the bytes of its elements as the document arrives, so each element can be decoded on its own and a large document never has to be held or parsed as a whole. The array is either the whole document or the value of one member of a top level object. Only the structure is checked; decoding the elements is up to the caller. This is plain C with no dependency on Foundation.
+///
+/// Like NSJSONSerialization, the scanner tolerates a trailing comma after the last element of the array and the last member of the top level object.
+typedef struct AAPLJSONArrayScanner *AAPLJSONArrayScannerRef;
+
+typedef struct {
+    /// Called with the bytes of each array element, without surrounding white space. The bytes are only valid during the call. Return false to stop scanning.
+    bool (*element)(const char *bytes, size_t length, void *context);
+    /// Called with the name, without quotes or unescaping, and the value bytes of every other top level member. May be NULL. Return false to stop scanning.
+    bool (*member)(const char *name, size_t nameLength, const char *value, size_t valueLength, void *context);
+} AAPLJSONArrayScannerCallbacks;
+
+typedef enum {
+    /// All bytes were scanned and more are expected, or the document is complete.
+    AAPLJSONArrayScannerResultContinue,
+    /// A callback returned false. The scanner won't accept more bytes.
+    AAPLJSONArrayScannerResultStopped,
+    /// The bytes aren't the structure that was expected. The scanner won't accept more bytes.
+    AAPLJSONArrayScannerResultError,
+} AAPLJSONArrayScannerResult;
+
+/// Create a scanner for the array that is the value of the top level member named key, which is compared with the raw bytes of member names. When key is NULL, the document itself must be an array. The callbacks are copied. Returns NULL if memory could not be allocated.
+AAPLJSONArrayScannerRef AAPLJSONArrayScannerCreate(const char *key, const AAPLJSONArrayScannerCallbacks *callbacks, void *context);
+
+/// Release a scanner and its buffers.
+void AAPLJSONArrayScannerRelease(AAPLJSONArrayScannerRef scanner);
+
+/// Scan the next bytes of the document, calling back for each element and member they complete. Bytes may be split anywhere. Elements that lie entirely within the bytes are passed to the callback without being copied; only an element split across calls is buffered, so memory is bounded by the largest element.
+AAPLJSONArrayScannerResult AAPLJSONArrayScannerAppendBytes(AAPLJSONArrayScannerRef scanner, const char *bytes, size_t length);
+
+/// Whether the whole document has been scanned. Check this once there are no more bytes to tell a complete document from a truncated one.
+bool AAPLJSONArrayScannerIsComplete(AAPLJSONArrayScannerRef scanner);
+
+/// The number of array elements passed to the callback so far.
+size_t AAPLJSONArrayScannerGetNumberOfElements(AAPLJSONArrayScannerRef scanner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
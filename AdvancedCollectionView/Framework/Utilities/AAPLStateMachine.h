@@ -20,15 +20,18 @@ extern NSString *const AAPLInvalidStateTransitionException;
 
 @end
 
+/// The state is stored before -stateWillChangeFrom:to: and -stateDidChangeFrom:to: are sent, and both are sent with the state the transition was actually made from.
 @interface AAPLStateMachine : NSObject
 
+/// Reading the current state never blocks. States are interned as small integers, so a state machine can have at most 64 states; using more raises NSInvalidArgumentException.
 @property (copy) NSString *currentState;
+/// Maps each state to the state or array of states it may change to. Set this before the state machine is used from more than one thread.
 @property (copy) NSDictionary *validTransitions;
 
 /// If set, AAPLStateMachine invokes transition methods on this delegate instead of self. This allows AAPLStateMachine to be used where subclassing doesn't make sense. The delegate is invoked on the same thread as -setCurrentState:
 @property (weak) id <AAPLStateMachineDelegate> delegate;
 
-/// For subclasses. Base implementation raises AAPLInvalidStateTransitionException. Need not invoke super unless desired. Should return the desired state if it doesn't raise, or nil for no change.
+/// For subclasses. Base implementation raises AAPLInvalidStateTransitionException. Need not invoke super unless desired. Should return the desired state if it doesn't raise, or nil for no change. A returned state that isn't a valid transition from fromState is also no change.
 - (NSString *)missingTransitionFromState:(NSString *)fromState toState:(NSString *)toState;
 
 @end
@@ -4,15 +4,20 @@
 */
 
 #import "AAPLStateMachine.h"
+#import "AAPLStateTable.h"
 #import <objc/message.h>
-#import <libkern/OSAtomic.h>
 
 NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionException";
 
 @interface AAPLStateMachine () <AAPLStateMachineDelegate> {
-	OSSpinLock _lock;
 	__weak id<AAPLStateMachineDelegate> _delegate;
-	NSString *_currentState;
+	/// Holds the current state and the valid transitions between interned states
+	AAPLStateTableRef _stateTable;
+	/// The interned states by number. Slots are written before the state can become current and never change afterwards, so readers don't need a lock. Interning and changing the transitions hold @synchronized(self).
+	__unsafe_unretained NSString *_states[AAPLStateTableMaximumNumberOfStates];
+	/// Keeps the interned states alive
+	NSMutableArray *_internedStates;
+	NSMutableDictionary *_stateNumbers;
 	struct {
 		BOOL targetRespondsToShouldChange;
 		BOOL targetRespondsToWillChange;
@@ -25,18 +30,91 @@ NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionEx
 
 @implementation AAPLStateMachine
 
+@synthesize validTransitions = _validTransitions;
+
 - (instancetype)init
 {
     self = [super init];
     if (!self)
         return nil;
 
-    _lock = OS_SPINLOCK_INIT;
+    _stateTable = AAPLStateTableCreate(AAPLStateTableMaximumNumberOfStates);
+    _internedStates = [NSMutableArray array];
+    _stateNumbers = [NSMutableDictionary dictionary];
 	[self updateTargetResponds];
 
     return self;
 }
 
+- (void)dealloc
+{
+    AAPLStateTableRelease(_stateTable);
+}
+
+/// The number of a state, interning it if it hasn't been seen before. Returns AAPLStateTableNoState for nil, or when the state is new and the state machine already has AAPLStateTableMaximumNumberOfStates states.
+- (uint32_t)numberForState:(NSString *)state
+{
+    if (!state)
+        return AAPLStateTableNoState;
+
+    @synchronized(self) {
+        NSNumber *number = _stateNumbers[state];
+        if (number)
+            return number.unsignedIntValue;
+
+        NSUInteger numberOfStates = _internedStates.count;
+        if (numberOfStates >= AAPLStateTableMaximumNumberOfStates)
+            return AAPLStateTableNoState;
+
+        state = [state copy];
+        [_internedStates addObject:state];
+        _states[numberOfStates] = state;
+        _stateNumbers[state] = @(numberOfStates);
+        return (uint32_t)numberOfStates;
+    }
+}
+
+/// The number of a state, raising an exception if it can't be interned.
+- (uint32_t)requiredNumberForState:(NSString *)state
+{
+    uint32_t number = [self numberForState:state];
+    if (AAPLStateTableNoState == number)
+        [NSException raise:NSInvalidArgumentException format:@"%@ can't add state %@, a state machine can have at most %d states", self, state, AAPLStateTableMaximumNumberOfStates];
+    return number;
+}
+
+- (NSString *)stateForNumber:(uint32_t)number
+{
+    if (AAPLStateTableNoState == number)
+        return nil;
+    return _states[number];
+}
+
+- (void)setValidTransitions:(NSDictionary *)validTransitions
+{
+    @synchronized(self) {
+        // Intern every state before changing anything, so too many states leave the old transitions in place
+        NSMutableArray *transitions = [NSMutableArray array];
+        [validTransitions enumerateKeysAndObjectsUsingBlock:^(NSString *fromState, id toStates, BOOL *stop) {
+            uint32_t fromNumber = [self requiredNumberForState:fromState];
+            for (NSString *toState in ([toStates isKindOfClass:[NSArray class]] ? toStates : @[toStates]))
+                [transitions addObject:@[@(fromNumber), @([self requiredNumberForState:toState])]];
+        }];
+
+        _validTransitions = [validTransitions copy];
+        AAPLStateTableRemoveAllTransitions(_stateTable);
+        for (NSArray *transition in transitions)
+            AAPLStateTableAddTransition(_stateTable, [transition[0] unsignedIntValue], [transition[1] unsignedIntValue]);
+    }
+}
+
+- (NSDictionary *)validTransitions
+{
+    @synchronized(self) {
+        return _validTransitions;
+    }
+}
+
 - (id <AAPLStateMachineDelegate>)target
 {
     id<AAPLStateMachineDelegate> delegate = self.delegate;
@@ -46,14 +124,8 @@ NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionEx
 
 - (id<AAPLStateMachineDelegate>)delegate
 {
-	id<AAPLStateMachineDelegate> delegate = nil;
-	
-	// for atomic-safety, _currentState must not be released between the load of _currentState and the retain invocation
-	OSSpinLockLock(&_lock);
-	delegate = _delegate;
-	OSSpinLockUnlock(&_lock);
-	
-	return delegate;
+	// Loading a weak reference is already safe against concurrent stores
+	return _delegate;
 }
 
 - (void)updateTargetResponds
@@ -62,7 +134,7 @@ NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionEx
 	id<AAPLStateMachineDelegate> target = delegate ?: self;
 	_flags.targetRespondsToShouldChange = [target respondsToSelector:@selector(shouldChangeToState:)];
 	_flags.targetRespondsToWillChange = [target respondsToSelector:@selector(stateWillChangeFrom:to:)];
-	_flags.targetRespondsToDidChange = [target respondsToSelector:@selector(stateWillChangeFrom:to:)];
+	_flags.targetRespondsToDidChange = [target respondsToSelector:@selector(stateDidChangeFrom:to:)];
 	_flags.delegateRespondsToMissingTransition = [target respondsToSelector:@selector(missingTransitionFromState:toState:)];
 }
 
@@ -70,48 +142,59 @@ NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionEx
 {
 	NSParameterAssert([delegate conformsToProtocol:@protocol(AAPLStateMachineDelegate)]);
 
-	OSSpinLockLock(&_lock);
 	_delegate = delegate;
-	OSSpinLockUnlock(&_lock);
 	
 	[self updateTargetResponds];
 }
 
 - (NSString *)currentState
 {
-    NSString *currentState = nil;
-    
-    // for atomic-safety, _currentState must not be released between the load of _currentState and the retain invocation
-    OSSpinLockLock(&_lock);
-    currentState = _currentState;
-    OSSpinLockUnlock(&_lock);
-    
-    return currentState;
+    // Interned states live as long as the state machine, so there is nothing to retain under a lock
+    return [self stateForNumber:AAPLStateTableGetCurrentState(_stateTable)];
 }
 
 - (void)setCurrentState:(NSString *)toState
 {
-	NSString *fromState = self.currentState;
-	
-	if ([fromState isEqual:toState]) {
-		return;
+	NSString *fromState;
+	NSString *appliedToState;
+
+	for (;;) {
+		fromState = self.currentState;
+
+		if ([fromState isEqual:toState]) {
+			return;
+		}
+
+		appliedToState = [self validateTransitionFromState:fromState toState:toState];
+		if (!appliedToState)
+			return;
+
+		uint32_t validatedFromNumber = [self numberForState:fromState];
+		uint32_t fromNumber;
+		BOOL changed;
+		@synchronized(self) {
+			changed = AAPLStateTableTransition(_stateTable, [self requiredNumberForState:appliedToState], &fromNumber);
+		}
+
+		if (changed) {
+			fromState = [self stateForNumber:fromNumber];
+			break;
+		}
+
+		// The state the missing transition handler asked for isn't a valid transition either
+		if (fromNumber == validatedFromNumber)
+			return;
+
+		// Another thread changed the state after it was validated, so validate against the new one
 	}
-	
-	NSString *appliedToState = [self validateTransitionFromState:fromState toState:toState];
-	if (!appliedToState)
-		return;
-	
-	// ...send will-change message for downstream KVO support...
+
 	id <AAPLStateMachineDelegate> target = [self target];
-	
+
+	// ...send will-change message for downstream KVO support...
 	if (_flags.targetRespondsToWillChange) {
 		[target stateWillChangeFrom:fromState to:appliedToState];
 	}
-	
-	OSSpinLockLock(&_lock);
-	_currentState = [appliedToState copy];
-	OSSpinLockUnlock(&_lock);
-	
+
 	if (_flags.targetRespondsToDidChange) {
 		[target stateDidChangeFrom:fromState to:appliedToState];
 	}
@@ -142,20 +225,8 @@ NSString *const AAPLInvalidStateTransitionException = @"InvalidStateTransitionEx
 
     // Raise exception if this is an illegal transition (toState must be a validTransition on fromState)
     if (fromState) {
-        id validTransitions = self.validTransitions[fromState];
-        BOOL transitionSpecified = YES;
-        
-        // Multiple valid transitions
-        if ([validTransitions isKindOfClass:[NSArray class]]) {
-            if (![validTransitions containsObject:toState]) {
-                transitionSpecified = NO;
-            }
-        }
-        // Otherwise, single valid transition object
-        else if (![validTransitions isEqual:toState]) {
-            transitionSpecified = NO;
-        }
-        
+        BOOL transitionSpecified = AAPLStateTableIsValidTransition(_stateTable, [self numberForState:fromState], [self numberForState:toState]);
+
         if (!transitionSpecified) {
             // Silently fail if implict transition to the same state
             if ([fromState isEqualToString:toState]) {
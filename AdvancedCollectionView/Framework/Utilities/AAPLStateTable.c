@@ -0,0 +1,94 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLStateTable.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct AAPLStateTable {
+    _Atomic uint32_t currentState;
+    uint32_t numberOfStates;
+    /// Bit n of transitions[m] is set when the transition from state m to state n is valid
+    uint64_t transitions[AAPLStateTableMaximumNumberOfStates];
+};
+
+AAPLStateTableRef AAPLStateTableCreate(uint32_t numberOfStates)
+{
+    if (numberOfStates > AAPLStateTableMaximumNumberOfStates)
+        return NULL;
+
+    AAPLStateTableRef table = calloc(1, sizeof(struct AAPLStateTable));
+    if (!table)
+        return NULL;
+
+    table->numberOfStates = numberOfStates;
+    atomic_init(&table->currentState, AAPLStateTableNoState);
+    return table;
+}
+
+void AAPLStateTableRelease(AAPLStateTableRef table)
+{
+    free(table);
+}
+
+uint32_t AAPLStateTableGetNumberOfStates(AAPLStateTableRef table)
+{
+    return table->numberOfStates;
+}
+
+void AAPLStateTableAddTransition(AAPLStateTableRef table, uint32_t fromState, uint32_t toState)
+{
+    if (fromState >= table->numberOfStates || toState >= table->numberOfStates)
+        return;
+    table->transitions[fromState] |= UINT64_C(1) << toState;
+}
+
+void AAPLStateTableRemoveAllTransitions(AAPLStateTableRef table)
+{
+    memset(table->transitions, 0, sizeof(table->transitions));
+}
+
+bool AAPLStateTableIsValidTransition(AAPLStateTableRef table, uint32_t fromState, uint32_t toState)
+{
+    if (toState >= table->numberOfStates)
+        return false;
+    if (AAPLStateTableNoState == fromState)
+        return true;
+    if (fromState >= table->numberOfStates)
+        return false;
+    return (table->transitions[fromState] >> toState) & 1;
+}
+
+uint32_t AAPLStateTableGetCurrentState(AAPLStateTableRef table)
+{
+    return atomic_load_explicit(&table->currentState, memory_order_acquire);
+}
+
+void AAPLStateTableSetCurrentState(AAPLStateTableRef table, uint32_t state)
+{
+    atomic_store_explicit(&table->currentState, state, memory_order_release);
+}
+
+bool AAPLStateTableTransition(AAPLStateTableRef table, uint32_t toState, uint32_t *fromState)
+{
+    uint32_t currentState = atomic_load_explicit(&table->currentState, memory_order_acquire);
+
+    // A failed exchange reloads the current state, so the loop only repeats when another thread changed it in between
+    for (;;) {
+        if (!AAPLStateTableIsValidTransition(table, currentState, toState)) {
+            if (fromState)
+                *fromState = currentState;
+            return false;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&table->currentState, &currentState, toState, memory_order_acq_rel, memory_order_acquire)) {
+            if (fromState)
+                *fromState = currentState;
+            return true;
+        }
+    }
+}
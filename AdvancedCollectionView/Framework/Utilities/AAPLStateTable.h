@@ -0,0 +1,57 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_STATE_TABLE_H
+#define AAPL_STATE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// The most states a table can hold. The valid transitions from each state are one 64 bit mask.
+#define AAPLStateTableMaximumNumberOfStates 64
+
+/// The state of a table before its first transition. Any transition from it is valid.
+#define AAPLStateTableNoState UINT32_MAX
+
+/// The current state of a state machine and its valid transitions, with states interned as small integers. The current state is held in an atomic, so reading it and changing it never block. This is plain C with no dependency on Foundation.
+typedef struct AAPLStateTable *AAPLStateTableRef;
+
+/// Create a table for states numbered from 0 to numberOfStates - 1 with no valid transitions, in AAPLStateTableNoState. Returns NULL if numberOfStates is larger than AAPLStateTableMaximumNumberOfStates or memory could not be allocated.
+AAPLStateTableRef AAPLStateTableCreate(uint32_t numberOfStates);
+
+/// Release a table and its storage.
+void AAPLStateTableRelease(AAPLStateTableRef table);
+
+/// The number of states the table was created with.
+uint32_t AAPLStateTableGetNumberOfStates(AAPLStateTableRef table);
+
+/// Allow transitions from one state to another. Transitions must be added before the table is shared between threads.
+void AAPLStateTableAddTransition(AAPLStateTableRef table, uint32_t fromState, uint32_t toState);
+
+/// Forget all valid transitions. Like adding transitions, this must happen before the table is shared between threads.
+void AAPLStateTableRemoveAllTransitions(AAPLStateTableRef table);
+
+/// Whether the table allows a transition. Transitions from AAPLStateTableNoState are always valid.
+bool AAPLStateTableIsValidTransition(AAPLStateTableRef table, uint32_t fromState, uint32_t toState);
+
+/// The current state. Wait-free.
+uint32_t AAPLStateTableGetCurrentState(AAPLStateTableRef table);
+
+/// Replace the current state without checking the transition. Wait-free.
+void AAPLStateTableSetCurrentState(AAPLStateTableRef table, uint32_t state);
+
+/// Move to a state if the transition from the current state is valid, even when other threads change the state at the same time. Lock-free. The state the transition was checked against is returned in fromState, which may be NULL. Returns false if the transition isn't valid, in which case the state is unchanged.
+bool AAPLStateTableTransition(AAPLStateTableRef table, uint32_t toState, uint32_t *fromState);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
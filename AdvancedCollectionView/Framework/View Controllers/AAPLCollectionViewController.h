@@ -7,4 +7,17 @@
 
 @interface AAPLCollectionViewController : UICollectionViewController
 
+/// Gather the item and section changes sent by the data source during one turn of the main run loop and apply them to the collection view as a single batch update, rather than updating for each notification. Batch updates from the data source and layout passes of the collection view apply any gathered changes first, and reloads and changing the data source discard them. While changes are pending the data source is ahead of the collection view, so code that asks the collection view for cells, index paths or item counts before the end of the turn must call -performCoalescedUpdates first. Default is NO.
+@property (nonatomic) BOOL coalescesUpdates;
+
+/// Apply the changes gathered so far as one batch update. Does nothing when no changes are pending.
+- (void)performCoalescedUpdates;
+
+/// The number of data source notifications folded into the most recent coalesced batch update.
+@property (nonatomic, readonly) NSUInteger numberOfNotificationsInLastCoalescedBatch;
+/// The total number of data source notifications that have been coalesced.
+@property (nonatomic, readonly) NSUInteger numberOfCoalescedNotifications;
+/// The number of batch updates the coalesced notifications were folded into. Notifications that cancelled out or were overtaken by a reload don't send a batch.
+@property (nonatomic, readonly) NSUInteger numberOfCoalescedBatches;
+
 @end
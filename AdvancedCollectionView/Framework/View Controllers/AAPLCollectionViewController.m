@@ -5,14 +5,20 @@
 
 #import "AAPLCollectionViewController.h"
 #import "AAPLDataSourceDelegate.h"
+#import "AAPLChangeJournal.h"
 
 static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 
 @interface AAPLCollectionViewController () <AAPLDataSourceDelegate>
-
 @end
 
-@implementation AAPLCollectionViewController
+@implementation AAPLCollectionViewController {
+    AAPLChangeJournal *_coalescedChanges;
+    NSUInteger _numberOfPendingNotifications;
+    CFRunLoopObserverRef _coalescingObserver;
+    /// Notifications sent from within a batch update of the data source already belong to that batch
+    BOOL _performingBatchUpdate;
+}
 
 - (void)loadView
 {
@@ -24,6 +30,11 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 - (void)dealloc
 {
 	[self.collectionView removeObserver:self forKeyPath:@"dataSource" context:AAPLDataSourceContext];
+
+    if (_coalescingObserver) {
+        CFRunLoopObserverInvalidate(_coalescingObserver);
+        CFRelease(_coalescingObserver);
+    }
 }
 
 - (void)viewWillAppear:(BOOL)animated
@@ -35,10 +46,34 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
     AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
     if ([dataSource isKindOfClass:AAPLDataSource.class]) {
         [dataSource registerReusableViewsWithCollectionView:collectionView];
+        dataSource.loadingPriority = AAPLLoadingPriorityUserInitiated;
         [dataSource setNeedsLoadContent];
     }
 }
 
+- (void)viewWillLayoutSubviews
+{
+    [super viewWillLayoutSubviews];
+
+    // Laying out reads the item counts of the data source, which already include the gathered changes
+    [self performCoalescedUpdates];
+}
+
+- (void)viewDidDisappear:(BOOL)animated
+{
+    [super viewDidDisappear:animated];
+
+    AAPLDataSource *dataSource = (AAPLDataSource *)self.collectionView.dataSource;
+    if (![dataSource isKindOfClass:AAPLDataSource.class])
+        return;
+
+    // Nobody is coming back for content of a screen that's gone, but a covered screen may still want its content when it's uncovered
+    if (self.isMovingFromParentViewController || self.isBeingDismissed)
+        [dataSource cancelLoading];
+    else
+        dataSource.loadingPriority = AAPLLoadingPriorityBackground;
+}
+
 - (void)setCollectionView:(UICollectionView *)collectionView
 {
     UICollectionView *oldCollectionView = self.collectionView;
@@ -56,6 +91,9 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 {
     //  For change contexts that aren't the data source, pass them to super.
 	if (context == AAPLDataSourceContext) {
+        // The collection view reloads from its new data source, so changes gathered from the old one no longer apply
+        [self discardCoalescedUpdates];
+
 		UICollectionView *collectionView = object;
 		AAPLDataSource *dataSource = (AAPLDataSource *)collectionView.dataSource;
 		if ([dataSource isKindOfClass:AAPLDataSource.class]) {
@@ -69,20 +107,121 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
     [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
 }
 
+#pragma mark - Coalescing updates
+
+- (void)setCoalescesUpdates:(BOOL)coalescesUpdates
+{
+    if (_coalescesUpdates == coalescesUpdates)
+        return;
+
+    _coalescesUpdates = coalescesUpdates;
+
+    if (!coalescesUpdates) {
+        [self performCoalescedUpdates];
+        CFRunLoopObserverInvalidate(_coalescingObserver);
+        CFRelease(_coalescingObserver);
+        _coalescingObserver = NULL;
+        return;
+    }
+
+    // Core Animation commits with a later order when the run loop is about to wait, so the batch goes out in the same frame as the changes
+    __weak typeof(&*self) weakself = self;
+    _coalescingObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+        [weakself performCoalescedUpdates];
+    });
+    CFRunLoopAddObserver(CFRunLoopGetMain(), _coalescingObserver, kCFRunLoopCommonModes);
+}
+
+- (BOOL)shouldCoalesceUpdates
+{
+    return _coalescesUpdates && !_performingBatchUpdate;
+}
+
+/// The journal gathering the changes of the current turn. Each call counts one notification.
+- (AAPLChangeJournal *)coalescedChangesForNotification
+{
+    if (!_coalescedChanges) {
+        // The data source has already applied every change it notifies, so section changes go in the same batch as the item changes before them
+        _coalescedChanges = [[AAPLChangeJournal alloc] init];
+        _coalescedChanges.includesSectionChanges = YES;
+    }
+    ++_numberOfPendingNotifications;
+    return _coalescedChanges;
+}
+
+/// Forget the changes gathered so far, because the collection view is about to read everything again.
+- (void)discardCoalescedUpdates
+{
+    _numberOfCoalescedNotifications += _numberOfPendingNotifications;
+    _numberOfPendingNotifications = 0;
+    _coalescedChanges = nil;
+}
+
+- (void)performCoalescedUpdates
+{
+    NSUInteger numberOfNotifications = _numberOfPendingNotifications;
+    AAPLChangeJournal *changes = _coalescedChanges;
+    _numberOfPendingNotifications = 0;
+    _coalescedChanges = nil;
+
+    if (!numberOfNotifications)
+        return;
+
+    _numberOfCoalescedNotifications += numberOfNotifications;
+
+    // The changes may have cancelled each other out, in which case no batch is sent
+    if (!changes.hasChanges)
+        return;
+
+    _numberOfNotificationsInLastCoalescedBatch = numberOfNotifications;
+    ++_numberOfCoalescedBatches;
+
+    UICollectionView *collectionView = self.collectionView;
+    [collectionView performBatchUpdates:^{
+        [collectionView deleteSections:changes.removedSections];
+        [collectionView insertSections:changes.insertedSections];
+        [collectionView reloadSections:changes.refreshedSections];
+        [changes enumerateSectionMovesUsingBlock:^(NSInteger section, NSInteger newSection, BOOL *stop) {
+            [collectionView moveSection:section toSection:newSection];
+        }];
+        [collectionView deleteItemsAtIndexPaths:changes.removedIndexPaths];
+        [collectionView insertItemsAtIndexPaths:changes.insertedIndexPaths];
+        [collectionView reloadItemsAtIndexPaths:changes.refreshedIndexPaths];
+        [changes enumerateMovesUsingBlock:^(NSIndexPath *fromIndexPath, NSIndexPath *toIndexPath, BOOL *stop) {
+            [collectionView moveItemAtIndexPath:fromIndexPath toIndexPath:toIndexPath];
+        }];
+    } completion:NULL];
+}
+
 #pragma mark - AAPLDataSourceDelegate methods
 
 - (void)dataSource:(AAPLDataSource *)dataSource didInsertItemsAtIndexPaths:(NSArray *)indexPaths
 {
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification insertItemsAtIndexPaths:indexPaths];
+        return;
+    }
+
     [self.collectionView insertItemsAtIndexPaths:indexPaths];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource didRemoveItemsAtIndexPaths:(NSArray *)indexPaths
 {
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification removeItemsAtIndexPaths:indexPaths];
+        return;
+    }
+
     [self.collectionView deleteItemsAtIndexPaths:indexPaths];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource didRefreshItemsAtIndexPaths:(NSArray *)indexPaths
 {
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification refreshItemsAtIndexPaths:indexPaths];
+        return;
+    }
+
     [self.collectionView reloadItemsAtIndexPaths:indexPaths];
 }
 
@@ -92,6 +231,12 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 	if ([layout conformsToProtocol:@protocol(AAPLDataSourceDelegate)] && [layout respondsToSelector:@selector(dataSource:didInsertSections:direction:)]) {
 		[layout dataSource:dataSource didInsertSections:sections direction:direction];
 	}
+
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification insertSections:sections];
+        return;
+    }
+
     [self.collectionView insertSections:sections];
 }
 
@@ -101,6 +246,12 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 	if ([layout conformsToProtocol:@protocol(AAPLDataSourceDelegate)] && [layout respondsToSelector:@selector(dataSource:didRemoveSections:direction:)]) {
 		[layout dataSource:dataSource didRemoveSections:sections direction:direction];
 	}
+
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification removeSections:sections];
+        return;
+    }
+
     [self.collectionView deleteSections:sections];
 }
 
@@ -110,27 +261,52 @@ static void *AAPLDataSourceContext = &AAPLDataSourceContext;
 	if ([layout conformsToProtocol:@protocol(AAPLDataSourceDelegate)] && [layout respondsToSelector:@selector(dataSource:didMoveSection:toSection:direction:)]) {
 		[layout dataSource:dataSource didMoveSection:section toSection:newSection direction:direction];
 	}
+
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification moveSection:section toSection:newSection];
+        return;
+    }
+
     [self.collectionView moveSection:section toSection:newSection];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource didMoveItemAtIndexPath:(NSIndexPath *)indexPath toIndexPath:(NSIndexPath *)newIndexPath
 {
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification moveItemAtIndexPath:indexPath toIndexPath:newIndexPath];
+        return;
+    }
+
     [self.collectionView moveItemAtIndexPath:indexPath toIndexPath:newIndexPath];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource didRefreshSections:(NSIndexSet *)sections
 {
+    if (self.shouldCoalesceUpdates) {
+        [self.coalescedChangesForNotification refreshSections:sections];
+        return;
+    }
+
 	[self.collectionView reloadSections:sections];
 }
 
 - (void)dataSourceDidReloadData:(AAPLDataSource *)dataSource
 {
+    // Reloading picks up every change, so the gathered ones only need counting
+    [self discardCoalescedUpdates];
     [self.collectionView reloadData];
 }
 
 - (void)dataSource:(AAPLDataSource *)dataSource performBatchUpdate:(void(^)(void))update completion:(void (^)(BOOL))completion
 {
-    [self.collectionView performBatchUpdates:update completion:completion];
+    [self performCoalescedUpdates];
+
+    [self.collectionView performBatchUpdates:^{
+        BOOL performingBatchUpdate = _performingBatchUpdate;
+        _performingBatchUpdate = YES;
+        if (update) { update(); }
+        _performingBatchUpdate = performingBatchUpdate;
+    } completion:completion];
 }
 
 @end
@@ -0,0 +1,11 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import <UIKit/UIKit.h>
+
+/// Draws the row separators of a band of rows in one shape layer, at the separator offsets of its layout attributes
+@interface AAPLGridLayoutRowSeparatorsView : UICollectionReusableView
+
+@end
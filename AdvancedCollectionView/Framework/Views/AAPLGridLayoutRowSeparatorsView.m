@@ -0,0 +1,58 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLGridLayoutRowSeparatorsView.h"
+#import "AAPLCollectionViewGridLayoutAttributes.h"
+#import "UIView+AAPLAdditions.h"
+
+@implementation AAPLGridLayoutRowSeparatorsView
+
++ (Class)layerClass
+{
+    return [CAShapeLayer class];
+}
+
+- (instancetype)initWithFrame:(CGRect)frame
+{
+    self = [super initWithFrame:frame];
+    if (!self)
+        return nil;
+
+    // The view covers the rows it separates, so touches must reach the cells below it
+    self.userInteractionEnabled = NO;
+    return self;
+}
+
+- (void)applyLayoutAttributes:(UICollectionViewLayoutAttributes *)layoutAttributes
+{
+    CAShapeLayer *shapeLayer = (CAShapeLayer *)self.layer;
+
+    if (![layoutAttributes isKindOfClass:AAPLCollectionViewGridLayoutAttributes.class]) {
+        shapeLayer.path = NULL;
+        return;
+    }
+
+    AAPLCollectionViewGridLayoutAttributes *attributes = (AAPLCollectionViewGridLayoutAttributes *)layoutAttributes;
+    CGFloat width = attributes.size.width;
+    CGFloat hairline = self.aapl_hairlineWidth;
+
+    // The offsets are already snapped to pixels by the layout
+    const CGFloat *separatorOffsets = attributes.separatorOffsets;
+    NSUInteger numberOfSeparatorOffsets = attributes.numberOfSeparatorOffsets;
+    CGMutablePathRef path = CGPathCreateMutable();
+    for (NSUInteger offsetIndex = 0; offsetIndex < numberOfSeparatorOffsets; ++offsetIndex)
+        CGPathAddRect(path, NULL, CGRectMake(0, separatorOffsets[offsetIndex], width, hairline));
+
+    // Don't animate the separators moving when the view is reused
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
+    shapeLayer.fillColor = attributes.backgroundColor.CGColor;
+    shapeLayer.path = path;
+    [CATransaction commit];
+
+    CGPathRelease(path);
+}
+
+@end
@@ -0,0 +1,487 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#import "AAPLChangeJournal.h"
+#include "AAPLTestSupport.h"
+
+#include <stdlib.h>
+
+@implementation NSIndexPath (AAPLTestItemAndSection)
+
++ (instancetype)indexPathForItem:(NSInteger)item inSection:(NSInteger)section
+{
+    NSUInteger indexes[] = { (NSUInteger)section, (NSUInteger)item };
+    return [self indexPathWithIndexes:indexes length:2];
+}
+
+- (NSInteger)section
+{
+    return (NSInteger)[self indexAtPosition:0];
+}
+
+- (NSInteger)item
+{
+    return (NSInteger)[self indexAtPosition:1];
+}
+
+@end
+
+// The model is an array of sections, each an array of items. An item is "identifier:version", and refreshing an item bumps its version, so an item that shows stale content can be told apart from the current one.
+
+typedef struct {
+    unsigned int seed;
+    NSUInteger lastIdentifier;
+} AAPLTestGenerator;
+
+static NSUInteger AAPLTestRandom(AAPLTestGenerator *generator, NSUInteger limit)
+{
+    return (NSUInteger)rand_r(&generator->seed) % limit;
+}
+
+static NSString *AAPLTestNewItem(AAPLTestGenerator *generator)
+{
+    return [NSString stringWithFormat:@"%lu:0", (unsigned long)++generator->lastIdentifier];
+}
+
+static NSString *AAPLTestItemIdentifier(NSString *item)
+{
+    return [item componentsSeparatedByString:@":"][0];
+}
+
+static NSString *AAPLTestRefreshedItem(NSString *item)
+{
+    NSArray *parts = [item componentsSeparatedByString:@":"];
+    return [NSString stringWithFormat:@"%@:%ld", parts[0], (long)[parts[1] integerValue] + 1];
+}
+
+static NSIndexPath *AAPLTestIndexPath(NSUInteger section, NSUInteger item)
+{
+    return [NSIndexPath indexPathForItem:(NSInteger)item inSection:(NSInteger)section];
+}
+
+static NSMutableArray *AAPLTestCopySections(NSArray *sections)
+{
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:sections.count];
+    for (NSArray *items in sections)
+        [result addObject:[items mutableCopy]];
+    return result;
+}
+
+static BOOL AAPLTestIndexSetsIntersect(NSIndexSet *indexes, NSIndexSet *otherIndexes)
+{
+    return NSNotFound != [indexes indexPassingTest:^BOOL(NSUInteger index, BOOL *stop) {
+        return [otherIndexes containsIndex:index];
+    }];
+}
+
+#define AAPLTestRejectBatch(reason) do { \
+    fprintf(stderr, "invalid batch: %s\n", reason); \
+    return nil; \
+} while (0)
+
+/// Apply the journal's changes to the items the collection view shows, the way a batch update does, and return the items it would show afterwards. Inserted and refreshed items are read from the model. Returns nil if the batch breaks a rule of batch updates.
+static NSArray *AAPLTestApplyBatch(NSArray *view, NSArray *model, AAPLChangeJournal *journal)
+{
+    NSUInteger numberOfSections = model.count;
+
+    NSIndexSet *removedSections = journal.removedSections;
+    NSIndexSet *insertedSections = journal.insertedSections;
+    NSIndexSet *refreshedSections = journal.refreshedSections;
+    NSMutableDictionary *sectionMoves = [NSMutableDictionary dictionary];
+    __block BOOL duplicateSectionMove = NO;
+    [journal enumerateSectionMovesUsingBlock:^(NSInteger section, NSInteger newSection, BOOL *stop) {
+        duplicateSectionMove = duplicateSectionMove || sectionMoves[@(section)];
+        sectionMoves[@(section)] = @(newSection);
+    }];
+    if (duplicateSectionMove)
+        AAPLTestRejectBatch("a section moves twice");
+
+    if (view.count + insertedSections.count != numberOfSections + removedSections.count)
+        AAPLTestRejectBatch("the number of sections doesn't add up");
+    if (AAPLTestIndexSetsIntersect(removedSections, refreshedSections))
+        AAPLTestRejectBatch("a section is removed and refreshed");
+
+    // Work out where every section that isn't removed ends up: moved sections go where they're moved to, and the rest fill the other places in order
+    NSMutableArray *oldSectionForNewSection = [NSMutableArray arrayWithCapacity:numberOfSections];
+    for (NSUInteger newSection = 0; newSection < numberOfSections; ++newSection)
+        [oldSectionForNewSection addObject:[NSNull null]];
+
+    for (NSNumber *section in sectionMoves) {
+        NSUInteger newSection = [sectionMoves[section] unsignedIntegerValue];
+        if (section.unsignedIntegerValue >= view.count || newSection >= numberOfSections)
+            AAPLTestRejectBatch("a section moves out of range");
+        if ([removedSections containsIndex:section.unsignedIntegerValue] || [refreshedSections containsIndex:section.unsignedIntegerValue])
+            AAPLTestRejectBatch("a moved section is also removed or refreshed");
+        if ([insertedSections containsIndex:newSection] || oldSectionForNewSection[newSection] != [NSNull null])
+            AAPLTestRejectBatch("two sections end up in the same place");
+        oldSectionForNewSection[newSection] = section;
+    }
+
+    NSUInteger newSection = 0;
+    for (NSUInteger section = 0; section < view.count; ++section) {
+        if ([removedSections containsIndex:section] || sectionMoves[@(section)])
+            continue;
+        while (newSection < numberOfSections && ([insertedSections containsIndex:newSection] || oldSectionForNewSection[newSection] != [NSNull null]))
+            ++newSection;
+        if (newSection == numberOfSections)
+            AAPLTestRejectBatch("more sections remain than there is room for");
+        oldSectionForNewSection[newSection++] = @(section);
+    }
+
+    // Removed and refreshed sections, and inserted ones, are read again, so their items can't be changed one by one
+    NSMutableIndexSet *reloadedOldSections = [removedSections mutableCopy];
+    [reloadedOldSections addIndexes:refreshedSections];
+    NSMutableIndexSet *reloadedNewSections = [insertedSections mutableCopy];
+    for (NSUInteger section = 0; section < numberOfSections; ++section) {
+        id oldSection = oldSectionForNewSection[section];
+        if (oldSection == [NSNull null]) {
+            if (![insertedSections containsIndex:section])
+                AAPLTestRejectBatch("a section is left empty");
+        }
+        else if ([refreshedSections containsIndex:[oldSection unsignedIntegerValue]])
+            [reloadedNewSections addIndex:section];
+    }
+
+    NSMutableDictionary *moves = [NSMutableDictionary dictionary];
+    __block BOOL duplicateMove = NO;
+    [journal enumerateMovesUsingBlock:^(NSIndexPath *fromIndexPath, NSIndexPath *toIndexPath, BOOL *stop) {
+        duplicateMove = duplicateMove || moves[fromIndexPath];
+        moves[fromIndexPath] = toIndexPath;
+    }];
+    if (duplicateMove)
+        AAPLTestRejectBatch("an item moves twice");
+
+    NSSet *refreshedIndexPaths = [NSSet setWithArray:journal.refreshedIndexPaths];
+    NSMutableArray *oldIndexPaths = [NSMutableArray arrayWithArray:journal.removedIndexPaths];
+    [oldIndexPaths addObjectsFromArray:journal.refreshedIndexPaths];
+    [oldIndexPaths addObjectsFromArray:moves.allKeys];
+    if ([NSSet setWithArray:oldIndexPaths].count != oldIndexPaths.count)
+        AAPLTestRejectBatch("an item is changed twice");
+    for (NSIndexPath *indexPath in oldIndexPaths) {
+        NSUInteger section = (NSUInteger)indexPath.section;
+        if (section >= view.count || [reloadedOldSections containsIndex:section] || (NSUInteger)indexPath.item >= [view[section] count])
+            AAPLTestRejectBatch("an item is changed where it can't be");
+    }
+
+    NSMutableArray *newIndexPaths = [NSMutableArray arrayWithArray:journal.insertedIndexPaths];
+    [newIndexPaths addObjectsFromArray:moves.allValues];
+    if ([NSSet setWithArray:newIndexPaths].count != newIndexPaths.count)
+        AAPLTestRejectBatch("two items end up in the same place");
+    for (NSIndexPath *indexPath in newIndexPaths) {
+        NSUInteger section = (NSUInteger)indexPath.section;
+        if (section >= numberOfSections || [reloadedNewSections containsIndex:section] || (NSUInteger)indexPath.item >= [model[section] count])
+            AAPLTestRejectBatch("an item ends up where it can't be");
+    }
+
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:numberOfSections];
+    for (NSUInteger section = 0; section < numberOfSections; ++section) {
+        NSArray *items = model[section];
+        if ([reloadedNewSections containsIndex:section]) {
+            [result addObject:items];
+            continue;
+        }
+
+        NSUInteger oldSection = [oldSectionForNewSection[section] unsignedIntegerValue];
+
+        // Items that arrive by insertion or move take their places, and the items that stay fill the rest in order
+        NSMutableDictionary *arrivingItems = [NSMutableDictionary dictionary];
+        for (NSIndexPath *indexPath in journal.insertedIndexPaths) {
+            if ((NSUInteger)indexPath.section == section)
+                arrivingItems[@(indexPath.item)] = [NSNull null];
+        }
+        for (NSIndexPath *fromIndexPath in moves) {
+            NSIndexPath *toIndexPath = moves[fromIndexPath];
+            if ((NSUInteger)toIndexPath.section == section)
+                arrivingItems[@(toIndexPath.item)] = fromIndexPath;
+        }
+
+        NSMutableArray *stayingIndexPaths = [NSMutableArray array];
+        for (NSUInteger item = 0; item < [view[oldSection] count]; ++item) {
+            NSIndexPath *indexPath = AAPLTestIndexPath(oldSection, item);
+            if (![journal.removedIndexPaths containsObject:indexPath] && !moves[indexPath])
+                [stayingIndexPaths addObject:indexPath];
+        }
+
+        if (arrivingItems.count + stayingIndexPaths.count != items.count)
+            AAPLTestRejectBatch("the number of items in a section doesn't add up");
+
+        NSMutableArray *resultItems = [NSMutableArray arrayWithCapacity:items.count];
+        NSUInteger stayingIndex = 0;
+        for (NSUInteger item = 0; item < items.count; ++item) {
+            id origin = arrivingItems[@(item)] ?: stayingIndexPaths[stayingIndex++];
+            if (origin == [NSNull null]) {
+                [resultItems addObject:items[item]];
+                continue;
+            }
+
+            NSIndexPath *fromIndexPath = origin;
+            NSString *oldItem = view[(NSUInteger)fromIndexPath.section][(NSUInteger)fromIndexPath.item];
+            if ([refreshedIndexPaths containsObject:fromIndexPath]) {
+                if (![AAPLTestItemIdentifier(oldItem) isEqualToString:AAPLTestItemIdentifier(items[item])])
+                    AAPLTestRejectBatch("a refreshed item ends up in the place of another");
+                [resultItems addObject:items[item]];
+            }
+            else
+                [resultItems addObject:oldItem];
+        }
+        [result addObject:resultItems];
+    }
+
+    return result;
+}
+
+static void AAPLTestCheckBatch(NSArray *view, NSArray *model, AAPLChangeJournal *journal)
+{
+    NSArray *result = AAPLTestApplyBatch(view, model, journal);
+    AAPLTestAssert([result isEqualToArray:model]);
+}
+
+static void AAPLTestItemChanges(void)
+{
+    NSArray *view = @[ @[ @"1:0", @"2:0", @"3:0", @"4:0" ], @[ @"5:0", @"6:0" ] ];
+
+    // Removing an inserted item cancels both
+    AAPLChangeJournal *journal = [[AAPLChangeJournal alloc] init];
+    [journal insertItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 1) ]];
+    [journal removeItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 1) ]];
+    AAPLTestAssert(!journal.hasChanges);
+
+    // Refreshing an inserted item does nothing, and refreshing an item twice refreshes it once
+    [journal insertItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 0) ]];
+    [journal refreshItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 0), AAPLTestIndexPath(0, 2), AAPLTestIndexPath(0, 2) ]];
+    AAPLTestAssert([journal.insertedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(0, 0) ]]);
+    AAPLTestAssert([journal.refreshedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(0, 1) ]]);
+    AAPLTestCheckBatch(view, @[ @[ @"7:0", @"1:0", @"2:1", @"3:0", @"4:0" ], @[ @"5:0", @"6:0" ] ], journal);
+
+    // Runs of inserted and removed items keep the untouched items in between where they are
+    journal = [[AAPLChangeJournal alloc] init];
+    [journal removeItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 0), AAPLTestIndexPath(0, 2) ]];
+    [journal insertItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 1), AAPLTestIndexPath(0, 2), AAPLTestIndexPath(1, 2) ]];
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:(@[ AAPLTestIndexPath(0, 0), AAPLTestIndexPath(0, 2) ])]);
+    AAPLTestCheckBatch(view, @[ @[ @"2:0", @"7:0", @"8:0", @"4:0" ], @[ @"5:0", @"6:0", @"9:0" ] ], journal);
+
+    // A moved item that's refreshed as well is removed and inserted, because a batch can't move and reload the same item
+    journal = [[AAPLChangeJournal alloc] init];
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(0, 0) toIndexPath:AAPLTestIndexPath(1, 1)];
+    [journal refreshItemsAtIndexPaths:@[ AAPLTestIndexPath(1, 1) ]];
+    __block NSUInteger numberOfMoves = 0;
+    [journal enumerateMovesUsingBlock:^(NSIndexPath *fromIndexPath, NSIndexPath *toIndexPath, BOOL *stop) {
+        ++numberOfMoves;
+    }];
+    AAPLTestAssert(0 == numberOfMoves);
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(0, 0) ]]);
+    AAPLTestAssert([journal.insertedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(1, 1) ]]);
+    AAPLTestCheckBatch(view, @[ @[ @"2:0", @"3:0", @"4:0" ], @[ @"5:0", @"1:1", @"6:0" ] ], journal);
+}
+
+static void AAPLTestSectionChanges(void)
+{
+    // The collection view applies section changes right away, so recorded changes follow their sections
+    NSMutableArray *view = AAPLTestCopySections(@[ @[ @"1:0", @"2:0" ], @[ @"3:0", @"4:0" ] ]);
+    AAPLChangeJournal *journal = [[AAPLChangeJournal alloc] init];
+    [journal removeItemsAtIndexPaths:@[ AAPLTestIndexPath(1, 0) ]];
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(0, 0) toIndexPath:AAPLTestIndexPath(1, 1)];
+
+    [journal insertSections:[NSIndexSet indexSetWithIndex:0]];
+    [view insertObject:[@[ @"5:0" ] mutableCopy] atIndex:0];
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(2, 0) ]]);
+    AAPLTestCheckBatch(view, @[ @[ @"5:0" ], @[ @"2:0" ], @[ @"4:0", @"1:0" ] ], journal);
+
+    // Items that moved into a removed section are removed from where they were
+    [journal removeSections:[NSIndexSet indexSetWithIndex:2]];
+    [view removeObjectAtIndex:2];
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(1, 0) ]]);
+    AAPLTestCheckBatch(view, @[ @[ @"5:0" ], @[ @"2:0" ] ], journal);
+
+    // Items that moved out of a refreshed section are new where they are now, and the changes recorded in it are dropped
+    view = AAPLTestCopySections(@[ @[ @"1:0", @"2:0" ], @[ @"3:0", @"4:0" ] ]);
+    journal = [[AAPLChangeJournal alloc] init];
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(0, 0) toIndexPath:AAPLTestIndexPath(1, 0)];
+    [journal removeItemsAtIndexPaths:@[ AAPLTestIndexPath(0, 0) ]];
+    [journal refreshSections:[NSIndexSet indexSetWithIndex:0]];
+    view[0] = [NSMutableArray array];
+    AAPLTestAssert(0 == journal.removedIndexPaths.count);
+    AAPLTestAssert([journal.insertedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(1, 0) ]]);
+    AAPLTestCheckBatch(view, @[ @[], @[ @"1:0", @"3:0", @"4:0" ] ], journal);
+}
+
+static void AAPLTestSectionChangesInBatch(void)
+{
+    NSArray *view = @[ @[ @"1:0", @"2:0" ], @[ @"3:0" ] ];
+
+    // An item change followed by a section insert in the same turn: the data source already has the new section when it's notified, so both go in one batch
+    AAPLChangeJournal *journal = [[AAPLChangeJournal alloc] init];
+    journal.includesSectionChanges = YES;
+    [journal insertItemsAtIndexPaths:@[ AAPLTestIndexPath(1, 1) ]];
+    [journal insertSections:[NSIndexSet indexSetWithIndex:0]];
+    AAPLTestAssert([journal.insertedSections isEqualToIndexSet:[NSIndexSet indexSetWithIndex:0]]);
+    AAPLTestAssert([journal.insertedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(2, 1) ]]);
+    AAPLTestCheckBatch(view, @[ @[ @"5:0" ], @[ @"1:0", @"2:0" ], @[ @"3:0", @"4:0" ] ], journal);
+
+    // Removed index paths and the sources of moves stay in terms of the sections before the batch
+    journal = [[AAPLChangeJournal alloc] init];
+    journal.includesSectionChanges = YES;
+    [journal removeItemsAtIndexPaths:@[ AAPLTestIndexPath(1, 0) ]];
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(0, 1) toIndexPath:AAPLTestIndexPath(1, 0)];
+    [journal moveSection:1 toSection:0];
+    [journal insertSections:[NSIndexSet indexSetWithIndex:1]];
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(1, 0) ]]);
+    __block NSUInteger numberOfSectionMoves = 0;
+    [journal enumerateSectionMovesUsingBlock:^(NSInteger section, NSInteger newSection, BOOL *stop) {
+        AAPLTestAssert(1 == section && 0 == newSection);
+        ++numberOfSectionMoves;
+    }];
+    AAPLTestAssert(1 == numberOfSectionMoves);
+    AAPLTestCheckBatch(view, @[ @[ @"2:0" ], @[], @[ @"1:0" ] ], journal);
+
+    // Items moved into a removed section are removed from where they were, and those moved out of a refreshed one are inserted
+    journal = [[AAPLChangeJournal alloc] init];
+    journal.includesSectionChanges = YES;
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(0, 0) toIndexPath:AAPLTestIndexPath(1, 0)];
+    [journal moveItemAtIndexPath:AAPLTestIndexPath(2, 0) toIndexPath:AAPLTestIndexPath(0, 1)];
+    [journal removeSections:[NSIndexSet indexSetWithIndex:1]];
+    [journal refreshSections:[NSIndexSet indexSetWithIndex:1]];
+    AAPLTestAssert([journal.removedSections isEqualToIndexSet:[NSIndexSet indexSetWithIndex:1]]);
+    AAPLTestAssert([journal.refreshedSections isEqualToIndexSet:[NSIndexSet indexSetWithIndex:2]]);
+    AAPLTestAssert([journal.removedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(0, 0) ]]);
+    AAPLTestAssert([journal.insertedIndexPaths isEqualToArray:@[ AAPLTestIndexPath(0, 1) ]]);
+    AAPLTestCheckBatch(@[ @[ @"1:0", @"2:0" ], @[ @"3:0", @"4:0" ], @[ @"5:0" ] ], @[ @[ @"2:0", @"5:0" ], @[] ], journal);
+}
+
+/// Make random changes to a model one at a time, recording each in a journal, and check the journal's batch brings the items the collection view shows up to date with the model. Unless the journal includes section changes, the collection view applies them as they happen, as it does for a data source showing its placeholder.
+static BOOL AAPLTestRandomChanges(unsigned int seed, BOOL includesSectionChanges, NSUInteger numberOfChanges)
+{
+    AAPLTestGenerator generator = { seed, 0 };
+
+    NSMutableArray *model = [NSMutableArray array];
+    for (NSUInteger section = AAPLTestRandom(&generator, 5); section > 0; --section) {
+        NSMutableArray *items = [NSMutableArray array];
+        for (NSUInteger item = AAPLTestRandom(&generator, 5); item > 0; --item)
+            [items addObject:AAPLTestNewItem(&generator)];
+        [model addObject:items];
+    }
+    NSMutableArray *view = AAPLTestCopySections(model);
+
+    AAPLChangeJournal *journal = [[AAPLChangeJournal alloc] init];
+    journal.includesSectionChanges = includesSectionChanges;
+
+    for (NSUInteger change = 0; change < numberOfChanges; ++change) {
+        NSUInteger action = AAPLTestRandom(&generator, 10);
+        NSUInteger numberOfSections = model.count;
+
+        if (action == 6) {
+            NSUInteger section = AAPLTestRandom(&generator, numberOfSections + 1);
+            NSMutableArray *items = [NSMutableArray array];
+            for (NSUInteger item = AAPLTestRandom(&generator, 3); item > 0; --item)
+                [items addObject:AAPLTestNewItem(&generator)];
+            [model insertObject:items atIndex:section];
+            if (!includesSectionChanges)
+                [view insertObject:[items mutableCopy] atIndex:section];
+            [journal insertSections:[NSIndexSet indexSetWithIndex:section]];
+            continue;
+        }
+
+        if (!numberOfSections)
+            continue;
+
+        NSUInteger section = AAPLTestRandom(&generator, numberOfSections);
+        NSMutableArray *items = model[section];
+
+        if (action <= 1) {
+            NSMutableSet *insertedItems = [NSMutableSet set];
+            for (NSUInteger count = 1 + AAPLTestRandom(&generator, 2); count > 0; --count) {
+                NSString *item = AAPLTestNewItem(&generator);
+                [items insertObject:item atIndex:AAPLTestRandom(&generator, items.count + 1)];
+                [insertedItems addObject:item];
+            }
+            NSMutableArray *indexPaths = [NSMutableArray array];
+            for (NSUInteger item = 0; item < items.count; ++item) {
+                if ([insertedItems containsObject:items[item]])
+                    [indexPaths addObject:AAPLTestIndexPath(section, item)];
+            }
+            [journal insertItemsAtIndexPaths:indexPaths];
+        }
+        else if (action == 2 && items.count) {
+            NSMutableIndexSet *removedItems = [NSMutableIndexSet indexSetWithIndex:AAPLTestRandom(&generator, items.count)];
+            [removedItems addIndex:AAPLTestRandom(&generator, items.count)];
+            NSMutableArray *indexPaths = [NSMutableArray array];
+            [removedItems enumerateIndexesUsingBlock:^(NSUInteger item, BOOL *stop) {
+                [indexPaths addObject:AAPLTestIndexPath(section, item)];
+            }];
+            [items removeObjectsAtIndexes:removedItems];
+            [journal removeItemsAtIndexPaths:indexPaths];
+        }
+        else if (action == 3 && items.count) {
+            NSUInteger item = AAPLTestRandom(&generator, items.count);
+            items[item] = AAPLTestRefreshedItem(items[item]);
+            [journal refreshItemsAtIndexPaths:@[ AAPLTestIndexPath(section, item) ]];
+        }
+        else if ((action == 4 || action == 5) && items.count) {
+            NSUInteger item = AAPLTestRandom(&generator, items.count);
+            NSString *movedItem = items[item];
+            [items removeObjectAtIndex:item];
+            NSUInteger newSection = AAPLTestRandom(&generator, numberOfSections);
+            NSUInteger newItem = AAPLTestRandom(&generator, [model[newSection] count] + 1);
+            [model[newSection] insertObject:movedItem atIndex:newItem];
+            [journal moveItemAtIndexPath:AAPLTestIndexPath(section, item) toIndexPath:AAPLTestIndexPath(newSection, newItem)];
+        }
+        else if (action == 7) {
+            [model removeObjectAtIndex:section];
+            if (!includesSectionChanges)
+                [view removeObjectAtIndex:section];
+            [journal removeSections:[NSIndexSet indexSetWithIndex:section]];
+        }
+        else if (action == 8) {
+            NSUInteger newSection = AAPLTestRandom(&generator, numberOfSections);
+            [model removeObjectAtIndex:section];
+            [model insertObject:items atIndex:newSection];
+            if (!includesSectionChanges) {
+                NSMutableArray *viewItems = view[section];
+                [view removeObjectAtIndex:section];
+                [view insertObject:viewItems atIndex:newSection];
+            }
+            [journal moveSection:(NSInteger)section toSection:(NSInteger)newSection];
+        }
+        else if (action == 9) {
+            // A refreshed section may come back with different items
+            for (NSUInteger item = 0; item < items.count; ++item)
+                items[item] = AAPLTestRefreshedItem(items[item]);
+            if (AAPLTestRandom(&generator, 2))
+                [items addObject:AAPLTestNewItem(&generator)];
+            if (!includesSectionChanges)
+                view[section] = [items mutableCopy];
+            [journal refreshSections:[NSIndexSet indexSetWithIndex:section]];
+        }
+    }
+
+    NSArray *result = AAPLTestApplyBatch(view, model, journal);
+    return [result isEqualToArray:model];
+}
+
+static void AAPLTestRandomSequences(BOOL includesSectionChanges)
+{
+    NSUInteger numberOfFailures = 0;
+    for (unsigned int seed = 1; seed <= 20000; ++seed) {
+        @autoreleasepool {
+            if (!AAPLTestRandomChanges(seed, includesSectionChanges, 1 + seed % 40)) {
+                if (++numberOfFailures <= 5)
+                    fprintf(stderr, "random changes with seed %u%s don't add up\n", seed, includesSectionChanges ? " and section changes in the batch" : "");
+            }
+        }
+    }
+    AAPLTestAssert(0 == numberOfFailures);
+}
+
+int main(void)
+{
+    @autoreleasepool {
+        AAPLTestItemChanges();
+        AAPLTestSectionChanges();
+        AAPLTestSectionChangesInBatch();
+        AAPLTestRandomSequences(NO);
+        AAPLTestRandomSequences(YES);
+    }
+    return AAPLTestFinish("AAPLChangeJournalTests");
+}
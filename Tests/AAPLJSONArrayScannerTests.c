@@ -0,0 +1,403 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLJSONArrayScanner.h"
+#include "AAPLTestSupport.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// A growing string for building documents
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} AAPLTestString;
+
+static void AAPLTestStringAppendBytes(AAPLTestString *string, const char *bytes, size_t length)
+{
+    if (string->length + length + 1 > string->capacity) {
+        size_t capacity = string->capacity ? string->capacity : 256;
+        while (capacity < string->length + length + 1)
+            capacity *= 2;
+        string->bytes = realloc(string->bytes, capacity);
+        string->capacity = capacity;
+    }
+    memcpy(string->bytes + string->length, bytes, length);
+    string->length += length;
+    string->bytes[string->length] = '\0';
+}
+
+static void AAPLTestStringAppend(AAPLTestString *string, const char *text)
+{
+    AAPLTestStringAppendBytes(string, text, strlen(text));
+}
+
+/// The pieces of a generated document the scanner should find
+enum { AAPLTestMaximumNumberOfPieces = 16 };
+
+typedef struct {
+    AAPLTestString elements[AAPLTestMaximumNumberOfPieces];
+    size_t numberOfElements;
+    AAPLTestString memberNames[AAPLTestMaximumNumberOfPieces];
+    AAPLTestString memberValues[AAPLTestMaximumNumberOfPieces];
+    size_t numberOfMembers;
+} AAPLTestPieces;
+
+static void AAPLTestPiecesClear(AAPLTestPieces *pieces)
+{
+    for (size_t index = 0; index < AAPLTestMaximumNumberOfPieces; ++index) {
+        pieces->elements[index].length = 0;
+        pieces->memberNames[index].length = 0;
+        pieces->memberValues[index].length = 0;
+    }
+    pieces->numberOfElements = 0;
+    pieces->numberOfMembers = 0;
+}
+
+static void AAPLTestPiecesFree(AAPLTestPieces *pieces)
+{
+    for (size_t index = 0; index < AAPLTestMaximumNumberOfPieces; ++index) {
+        free(pieces->elements[index].bytes);
+        free(pieces->memberNames[index].bytes);
+        free(pieces->memberValues[index].bytes);
+    }
+}
+
+static void AAPLTestAppendWhiteSpace(AAPLTestString *string)
+{
+    static const char *whiteSpace[] = { "", "", " ", "\n  ", "\t", "\r\n" };
+    AAPLTestStringAppend(string, whiteSpace[rand() % 6]);
+}
+
+/// The contents of a string full of the characters that delimit structure, escaped quotes and backslashes included
+static void AAPLTestAppendRandomStringContents(AAPLTestString *string)
+{
+    static const char *characters[] = { "a", "b", "\\\"", "\\\\", ",", "{", "}", "[", "]", ":", " ", "\\n", "\xc3\xa9", "\\u00e9" };
+    for (int length = rand() % 6; length > 0; --length)
+        AAPLTestStringAppend(string, characters[rand() % 14]);
+}
+
+static void AAPLTestAppendRandomString(AAPLTestString *string)
+{
+    AAPLTestStringAppend(string, "\"");
+    AAPLTestAppendRandomStringContents(string);
+    AAPLTestStringAppend(string, "\"");
+}
+
+static void AAPLTestAppendRandomValue(AAPLTestString *string, int depth)
+{
+    static const char *scalars[] = { "true", "false", "null", "1.5e3", "-42", "0" };
+
+    switch (rand() % (depth < 3 ? 7 : 4)) {
+        case 0:
+        case 1:
+            AAPLTestStringAppend(string, scalars[rand() % 6]);
+            break;
+        case 2:
+        case 3:
+            AAPLTestAppendRandomString(string);
+            break;
+        case 4:
+        case 5:
+            AAPLTestStringAppend(string, "{");
+            for (int count = rand() % 4, index = 0; index < count; ++index) {
+                if (index)
+                    AAPLTestStringAppend(string, ",");
+                AAPLTestAppendWhiteSpace(string);
+                AAPLTestAppendRandomString(string);
+                AAPLTestStringAppend(string, ":");
+                AAPLTestAppendWhiteSpace(string);
+                AAPLTestAppendRandomValue(string, depth + 1);
+            }
+            AAPLTestStringAppend(string, "}");
+            break;
+        default:
+            AAPLTestStringAppend(string, "[");
+            for (int count = rand() % 4, index = 0; index < count; ++index) {
+                if (index)
+                    AAPLTestStringAppend(string, ",");
+                AAPLTestAppendWhiteSpace(string);
+                AAPLTestAppendRandomValue(string, depth + 1);
+            }
+            AAPLTestStringAppend(string, "]");
+            break;
+    }
+}
+
+/// Build a random document, either a bare array or an object with the array as its "results" member among others, and remember its elements and other members
+static void AAPLTestMakeDocument(AAPLTestString *document, AAPLTestPieces *pieces, bool keyed)
+{
+    AAPLTestPiecesClear(pieces);
+    document->length = 0;
+
+    AAPLTestString array = { 0 };
+    AAPLTestStringAppend(&array, "[");
+    pieces->numberOfElements = (size_t)(rand() % 6);
+    for (size_t index = 0; index < pieces->numberOfElements; ++index) {
+        AAPLTestString *element = &pieces->elements[index];
+        AAPLTestAppendRandomValue(element, 0);
+        if (index)
+            AAPLTestStringAppend(&array, ",");
+        AAPLTestAppendWhiteSpace(&array);
+        AAPLTestStringAppendBytes(&array, element->bytes, element->length);
+        AAPLTestAppendWhiteSpace(&array);
+    }
+    // Trailing commas are tolerated
+    if (pieces->numberOfElements && 0 == rand() % 3)
+        AAPLTestStringAppend(&array, ",");
+    AAPLTestAppendWhiteSpace(&array);
+    AAPLTestStringAppend(&array, "]");
+
+    AAPLTestAppendWhiteSpace(document);
+    if (!keyed) {
+        AAPLTestStringAppendBytes(document, array.bytes, array.length);
+        AAPLTestAppendWhiteSpace(document);
+        free(array.bytes);
+        return;
+    }
+
+    pieces->numberOfMembers = (size_t)(rand() % 3);
+    size_t resultsPosition = (size_t)rand() % (pieces->numberOfMembers + 1);
+    AAPLTestStringAppend(document, "{");
+    for (size_t position = 0, memberIndex = 0; position <= pieces->numberOfMembers; ++position) {
+        if (position)
+            AAPLTestStringAppend(document, ",");
+        AAPLTestAppendWhiteSpace(document);
+
+        if (position == resultsPosition) {
+            AAPLTestStringAppend(document, "\"results\"");
+            AAPLTestAppendWhiteSpace(document);
+            AAPLTestStringAppend(document, ":");
+            AAPLTestAppendWhiteSpace(document);
+            AAPLTestStringAppendBytes(document, array.bytes, array.length);
+        }
+        else {
+            // Member names are reported without their quotes
+            AAPLTestString *name = &pieces->memberNames[memberIndex];
+            AAPLTestString *value = &pieces->memberValues[memberIndex];
+            ++memberIndex;
+
+            AAPLTestStringAppend(name, "m");
+            AAPLTestAppendRandomStringContents(name);
+            AAPLTestAppendRandomValue(value, 0);
+
+            AAPLTestStringAppend(document, "\"");
+            AAPLTestStringAppendBytes(document, name->bytes, name->length);
+            AAPLTestStringAppend(document, "\"");
+            AAPLTestAppendWhiteSpace(document);
+            AAPLTestStringAppend(document, ":");
+            AAPLTestAppendWhiteSpace(document);
+            AAPLTestStringAppendBytes(document, value->bytes, value->length);
+        }
+        AAPLTestAppendWhiteSpace(document);
+    }
+    AAPLTestStringAppend(document, "}");
+    AAPLTestAppendWhiteSpace(document);
+    free(array.bytes);
+}
+
+/// What the scanner reported
+typedef struct {
+    AAPLTestPieces pieces;
+    size_t stopAfterElement;
+} AAPLTestCollector;
+
+static bool AAPLTestCollectElement(const char *bytes, size_t length, void *context)
+{
+    AAPLTestCollector *collector = context;
+    AAPLTestPieces *pieces = &collector->pieces;
+    if (pieces->numberOfElements < AAPLTestMaximumNumberOfPieces)
+        AAPLTestStringAppendBytes(&pieces->elements[pieces->numberOfElements], bytes, length);
+    ++pieces->numberOfElements;
+    return pieces->numberOfElements != collector->stopAfterElement;
+}
+
+static bool AAPLTestCollectMember(const char *name, size_t nameLength, const char *value, size_t valueLength, void *context)
+{
+    AAPLTestPieces *pieces = &((AAPLTestCollector *)context)->pieces;
+    if (pieces->numberOfMembers < AAPLTestMaximumNumberOfPieces) {
+        AAPLTestStringAppendBytes(&pieces->memberNames[pieces->numberOfMembers], name, nameLength);
+        AAPLTestStringAppendBytes(&pieces->memberValues[pieces->numberOfMembers], value, valueLength);
+    }
+    ++pieces->numberOfMembers;
+    return true;
+}
+
+static const AAPLJSONArrayScannerCallbacks AAPLTestCallbacks = { AAPLTestCollectElement, AAPLTestCollectMember };
+
+static bool AAPLTestStringsEqual(const AAPLTestString *string, const AAPLTestString *otherString)
+{
+    return string->length == otherString->length && (!string->length || !memcmp(string->bytes, otherString->bytes, string->length));
+}
+
+/// Feed a document to a scanner in random pieces, some of them a single byte
+static AAPLJSONArrayScannerResult AAPLTestScan(AAPLJSONArrayScannerRef scanner, const char *bytes, size_t length, size_t maximumPieceLength)
+{
+    AAPLJSONArrayScannerResult result = AAPLJSONArrayScannerResultContinue;
+    for (size_t position = 0; position < length && AAPLJSONArrayScannerResultContinue == result;) {
+        size_t pieceLength = 1 + (size_t)rand() % maximumPieceLength;
+        if (pieceLength > length - position)
+            pieceLength = length - position;
+        result = AAPLJSONArrayScannerAppendBytes(scanner, bytes + position, pieceLength);
+        position += pieceLength;
+    }
+    return result;
+}
+
+/// Split random documents at random points and compare what the scanner finds with what went into them
+static void AAPLTestRandomDocuments(void)
+{
+    AAPLTestString document = { 0 };
+    AAPLTestPieces expected = { 0 };
+    AAPLTestCollector collector = { 0 };
+
+    srand(1);
+    for (int round = 0; round < 4000; ++round) {
+        bool keyed = round % 2;
+        AAPLTestMakeDocument(&document, &expected, keyed);
+        AAPLTestPiecesClear(&collector.pieces);
+
+        AAPLJSONArrayScannerRef scanner = AAPLJSONArrayScannerCreate(keyed ? "results" : NULL, &AAPLTestCallbacks, &collector);
+        AAPLTestAssert(scanner);
+        AAPLJSONArrayScannerResult result = AAPLTestScan(scanner, document.bytes, document.length, (round % 3 ? 64 : 3));
+
+        AAPLTestAssert(AAPLJSONArrayScannerResultContinue == result);
+        AAPLTestAssert(AAPLJSONArrayScannerIsComplete(scanner));
+        AAPLTestAssert(AAPLJSONArrayScannerGetNumberOfElements(scanner) == expected.numberOfElements);
+        AAPLTestAssert(collector.pieces.numberOfElements == expected.numberOfElements);
+        AAPLTestAssert(collector.pieces.numberOfMembers == expected.numberOfMembers);
+        for (size_t index = 0; index < expected.numberOfElements && index < collector.pieces.numberOfElements; ++index)
+            AAPLTestAssert(AAPLTestStringsEqual(&collector.pieces.elements[index], &expected.elements[index]));
+        for (size_t index = 0; index < expected.numberOfMembers && index < collector.pieces.numberOfMembers; ++index) {
+            AAPLTestAssert(AAPLTestStringsEqual(&collector.pieces.memberNames[index], &expected.memberNames[index]));
+            AAPLTestAssert(AAPLTestStringsEqual(&collector.pieces.memberValues[index], &expected.memberValues[index]));
+        }
+
+        if (AAPLTestFailureCount) {
+            fprintf(stderr, "document %d: %s\n", round, document.bytes);
+            break;
+        }
+
+        AAPLJSONArrayScannerRelease(scanner);
+    }
+
+    AAPLTestPiecesFree(&expected);
+    AAPLTestPiecesFree(&collector.pieces);
+    free(document.bytes);
+}
+
+static void AAPLTestMalformedDocuments(void)
+{
+    static const struct {
+        const char *key;
+        const char *document;
+        bool error;
+    } cases[] = {
+        { "results", "{\"results\": [1,2}", true },
+        { "results", "{\"a\": , \"results\": []}", true },
+        { "results", "{\"results\":[{]}", true },
+        { "results", "[1, 2]", true },
+        { NULL, "{\"results\": []}", true },
+        { NULL, "[1] x", true },
+        // Truncated documents scan without error but never complete
+        { NULL, "[1,2", false },
+        { "results", "{\"results\": [\"]\"", false },
+    };
+
+    AAPLTestCollector collector = { 0 };
+    for (size_t index = 0; index < sizeof(cases) / sizeof(cases[0]); ++index) {
+        const char *document = cases[index].document;
+        for (size_t maximumPieceLength = 1; maximumPieceLength < 8; maximumPieceLength += 6) {
+            AAPLTestPiecesClear(&collector.pieces);
+            AAPLJSONArrayScannerRef scanner = AAPLJSONArrayScannerCreate(cases[index].key, &AAPLTestCallbacks, &collector);
+            AAPLJSONArrayScannerResult result = AAPLTestScan(scanner, document, strlen(document), maximumPieceLength);
+            AAPLTestAssert(result == (cases[index].error ? AAPLJSONArrayScannerResultError : AAPLJSONArrayScannerResultContinue));
+            AAPLTestAssert(!AAPLJSONArrayScannerIsComplete(scanner));
+            if (cases[index].error)
+                AAPLTestAssert(AAPLJSONArrayScannerResultError == AAPLJSONArrayScannerAppendBytes(scanner, "]", 1));
+            AAPLJSONArrayScannerRelease(scanner);
+        }
+    }
+    AAPLTestPiecesFree(&collector.pieces);
+}
+
+static void AAPLTestStopping(void)
+{
+    static const char document[] = "{\"results\": [1, {\"a\": [2]}, \"3\", 4]}";
+
+    AAPLTestCollector collector = { 0 };
+    collector.stopAfterElement = 2;
+    AAPLJSONArrayScannerRef scanner = AAPLJSONArrayScannerCreate("results", &AAPLTestCallbacks, &collector);
+    AAPLTestAssert(AAPLJSONArrayScannerResultStopped == AAPLJSONArrayScannerAppendBytes(scanner, document, sizeof(document) - 1));
+    AAPLTestAssert(2 == AAPLJSONArrayScannerGetNumberOfElements(scanner));
+    AAPLTestAssert(!AAPLJSONArrayScannerIsComplete(scanner));
+    AAPLTestAssert(AAPLJSONArrayScannerResultStopped == AAPLJSONArrayScannerAppendBytes(scanner, "]", 1));
+    AAPLTestAssert(2 == AAPLJSONArrayScannerGetNumberOfElements(scanner));
+    AAPLJSONArrayScannerRelease(scanner);
+    AAPLTestPiecesFree(&collector.pieces);
+}
+
+typedef struct {
+    double startTime;
+    double firstElementTime;
+    size_t numberOfBytes;
+} AAPLTestBenchmarkContext;
+
+static bool AAPLTestTimeElement(const char *bytes, size_t length, void *context)
+{
+    AAPLTestBenchmarkContext *benchmark = context;
+    if (!benchmark->numberOfBytes)
+        benchmark->firstElementTime = AAPLTestGetTime() - benchmark->startTime;
+    benchmark->numberOfBytes += length;
+    return true;
+}
+
+/// Scan a large list of cat like objects, the way the cat list is read, in 1 MB pieces and as a whole
+static void AAPLTestBenchmark(void)
+{
+    const size_t numberOfCats = 200000;
+    AAPLTestString document = { 0 };
+    char cat[512];
+
+    AAPLTestStringAppend(&document, "{\"delayResults\": false, \"results\": [\n");
+    for (size_t catIndex = 0; catIndex < numberOfCats; ++catIndex) {
+        snprintf(cat, sizeof(cat), "  {\"uniqueID\": \"cat-%zu\", \"name\": \"Cat %zu\", \"shortDescription\": \"A \\\"big\\\" cat, [not] {small}\", \"conservationStatus\": \"Vulnerable\", \"classification\": {\"kingdom\": \"Animalia\", \"order\": [\"Carnivora\"]}}%s\n", catIndex, catIndex, (catIndex + 1 < numberOfCats ? "," : ""));
+        AAPLTestStringAppend(&document, cat);
+    }
+    AAPLTestStringAppend(&document, "]}\n");
+
+    const size_t pieceLengths[] = { 1 << 20, SIZE_MAX };
+    for (size_t index = 0; index < 2; ++index) {
+        AAPLTestBenchmarkContext benchmark = { 0 };
+        AAPLJSONArrayScannerCallbacks callbacks = { AAPLTestTimeElement, NULL };
+        AAPLJSONArrayScannerRef scanner = AAPLJSONArrayScannerCreate("results", &callbacks, &benchmark);
+
+        benchmark.startTime = AAPLTestGetTime();
+        for (size_t position = 0; position < document.length; position += pieceLengths[index]) {
+            size_t pieceLength = document.length - position < pieceLengths[index] ? document.length - position : pieceLengths[index];
+            AAPLJSONArrayScannerAppendBytes(scanner, document.bytes + position, pieceLength);
+        }
+        double time = AAPLTestGetTime() - benchmark.startTime;
+
+        AAPLTestAssert(AAPLJSONArrayScannerIsComplete(scanner));
+        AAPLTestAssert(AAPLJSONArrayScannerGetNumberOfElements(scanner) == numberOfCats);
+        printf("JSON array scanner, %.0f MB %s: %.0f MB/s, first element after %.3f ms\n", document.length / 1e6, (index ? "as a whole" : "in 1 MB pieces"), document.length / time / 1e6, benchmark.firstElementTime * 1e3);
+        AAPLJSONArrayScannerRelease(scanner);
+    }
+
+    free(document.bytes);
+}
+
+int main(void)
+{
+    AAPLTestRandomDocuments();
+    AAPLTestMalformedDocuments();
+    AAPLTestStopping();
+    AAPLTestBenchmark();
+    return AAPLTestFinish("AAPLJSONArrayScannerTests");
+}
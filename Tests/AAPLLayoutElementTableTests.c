@@ -0,0 +1,378 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLLayoutElementTable.h"
+#include "AAPLTestSupport.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// The values the layout uses for the global section and for section level elements
+#define AAPLTestGlobalSection ((size_t)UINTPTR_MAX)
+#define AAPLTestNotFound ((size_t)INTPTR_MAX)
+
+/// Values are counted objects, so the tests can check every retain is balanced by a release
+typedef struct {
+    long retainCount;
+} AAPLTestValue;
+
+static long AAPLTestNumberOfRetains;
+static long AAPLTestNumberOfReleases;
+
+static const void *AAPLTestRetain(const void *value)
+{
+    ++((AAPLTestValue *)value)->retainCount;
+    ++AAPLTestNumberOfRetains;
+    return value;
+}
+
+static void AAPLTestRelease(const void *value)
+{
+    --((AAPLTestValue *)value)->retainCount;
+    ++AAPLTestNumberOfReleases;
+}
+
+static const AAPLLayoutElementTableValueCallBacks AAPLTestCallBacks = { AAPLTestRetain, AAPLTestRelease };
+
+static bool AAPLTestCountEntries(AAPLLayoutElementKey key, const void *value, void *context)
+{
+    ++*(size_t *)context;
+    return true;
+}
+
+static bool AAPLTestStopAfterOne(AAPLLayoutElementKey key, const void *value, void *context)
+{
+    ++*(size_t *)context;
+    return false;
+}
+
+static void AAPLTestInsertAndReplace(void)
+{
+    AAPLTestValue values[3] = { { 0 } };
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(&AAPLTestCallBacks);
+    AAPLTestAssert(table);
+
+    AAPLLayoutElementKey key = AAPLLayoutElementKeyMake(1, 2, 3);
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, key, &values[0]));
+    AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 1);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, key) == &values[0]);
+    AAPLTestAssert(values[0].retainCount == 1);
+
+    // Replacing keeps the count, releases the old value and retains the new one
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, key, &values[1]));
+    AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 1);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, key) == &values[1]);
+    AAPLTestAssert(values[0].retainCount == 0);
+    AAPLTestAssert(values[1].retainCount == 1);
+
+    // Setting the value already stored must not release it before retaining it
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, key, &values[1]));
+    AAPLTestAssert(values[1].retainCount == 1);
+
+    // Keys differing only in kind, section or item are distinct
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(2, 2, 3), &values[2]));
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(1, 3, 3), &values[2]));
+    AAPLTestAssert(AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(1, 2, 4), &values[2]));
+    AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 4);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, key) == &values[1]);
+    AAPLTestAssert(values[2].retainCount == 3);
+
+    // NULL values are refused, because an empty slot is a NULL value
+    AAPLTestAssert(!AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(9, 9, 9), NULL));
+    AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 4);
+
+    AAPLLayoutElementTableRelease(table);
+    for (int valueIndex = 0; valueIndex < 3; ++valueIndex)
+        AAPLTestAssert(values[valueIndex].retainCount == 0);
+}
+
+static void AAPLTestMissingKeys(void)
+{
+    AAPLTestValue value = { 0 };
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(NULL);
+
+    // An empty table has no storage yet
+    AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(0, 0, 0)));
+    size_t count = 0;
+    AAPLLayoutElementTableApplyFunction(table, AAPLTestCountEntries, &count);
+    AAPLTestAssert(count == 0);
+
+    AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(0, 0, 0), &value);
+    AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(0, 0, 1)));
+    AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(0, 1, 0)));
+    AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(1, 0, 0)));
+
+    // Without callbacks the values are stored as they are
+    AAPLTestAssert(value.retainCount == 0);
+    AAPLLayoutElementTableRelease(table);
+    AAPLLayoutElementTableRelease(NULL);
+}
+
+/// The global section and section level elements use the largest index values, which must neither collide with each other nor with ordinary keys
+static void AAPLTestGlobalSectionKeys(void)
+{
+    AAPLTestValue values[4] = { { 0 } };
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(&AAPLTestCallBacks);
+
+    AAPLLayoutElementKey globalHeader = AAPLLayoutElementKeyMake(1, AAPLTestGlobalSection, 0);
+    AAPLLayoutElementKey globalBackground = AAPLLayoutElementKeyMake(1, AAPLTestGlobalSection, AAPLTestNotFound);
+    AAPLLayoutElementKey sectionBackground = AAPLLayoutElementKeyMake(1, 0, AAPLTestNotFound);
+    AAPLLayoutElementKey firstHeader = AAPLLayoutElementKeyMake(1, 0, 0);
+
+    AAPLLayoutElementTableSetValue(table, globalHeader, &values[0]);
+    AAPLLayoutElementTableSetValue(table, globalBackground, &values[1]);
+    AAPLLayoutElementTableSetValue(table, sectionBackground, &values[2]);
+    AAPLLayoutElementTableSetValue(table, firstHeader, &values[3]);
+
+    AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 4);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, globalHeader) == &values[0]);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, globalBackground) == &values[1]);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, sectionBackground) == &values[2]);
+    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, firstHeader) == &values[3]);
+    AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(1, AAPLTestNotFound, AAPLTestNotFound)));
+
+    AAPLLayoutElementTableRelease(table);
+}
+
+/// Fill the table through several rehashes, checking every key after each growth step, then clear it and fill it again in the storage it kept
+static void AAPLTestGrowth(void)
+{
+    const size_t numberOfKeys = 5000;
+    AAPLTestValue *values = calloc(numberOfKeys, sizeof(AAPLTestValue));
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(&AAPLTestCallBacks);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t keyIndex = 0; keyIndex < numberOfKeys; ++keyIndex) {
+            // Dense sections and items, as the layout produces them
+            AAPLLayoutElementKey key = AAPLLayoutElementKeyMake((uint32_t)(keyIndex % 3), keyIndex / 30, keyIndex % 10);
+            AAPLTestAssert(AAPLLayoutElementTableSetValue(table, key, &values[keyIndex]));
+
+            // The capacity starts at 64 and doubles, so check everything added so far right after each rehash
+            size_t count = keyIndex + 1;
+            if (count > 32 && 0 == (count & (count - 1))) {
+                for (size_t checkIndex = 0; checkIndex <= keyIndex; ++checkIndex) {
+                    AAPLLayoutElementKey checkKey = AAPLLayoutElementKeyMake((uint32_t)(checkIndex % 3), checkIndex / 30, checkIndex % 10);
+                    AAPLTestAssert(AAPLLayoutElementTableGetValue(table, checkKey) == &values[checkIndex]);
+                }
+            }
+        }
+
+        AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == numberOfKeys);
+        for (size_t keyIndex = 0; keyIndex < numberOfKeys; ++keyIndex) {
+            AAPLLayoutElementKey key = AAPLLayoutElementKeyMake((uint32_t)(keyIndex % 3), keyIndex / 30, keyIndex % 10);
+            AAPLTestAssert(AAPLLayoutElementTableGetValue(table, key) == &values[keyIndex]);
+            AAPLTestAssert(values[keyIndex].retainCount == 1);
+        }
+
+        size_t count = 0;
+        AAPLLayoutElementTableApplyFunction(table, AAPLTestCountEntries, &count);
+        AAPLTestAssert(count == numberOfKeys);
+        count = 0;
+        AAPLLayoutElementTableApplyFunction(table, AAPLTestStopAfterOne, &count);
+        AAPLTestAssert(count == 1);
+
+        AAPLLayoutElementTableRemoveAllValues(table);
+        AAPLTestAssert(AAPLLayoutElementTableGetCount(table) == 0);
+        AAPLTestAssert(!AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(0, 0, 0)));
+        for (size_t keyIndex = 0; keyIndex < numberOfKeys; ++keyIndex)
+            AAPLTestAssert(values[keyIndex].retainCount == 0);
+    }
+
+    AAPLLayoutElementTableRelease(table);
+    free(values);
+}
+
+/// Every retain the table makes is balanced by a release, whether values are replaced, cleared or released with the table
+static void AAPLTestReleaseBalance(void)
+{
+    AAPLTestNumberOfRetains = 0;
+    AAPLTestNumberOfReleases = 0;
+
+    AAPLTestValue values[16] = { { 0 } };
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(&AAPLTestCallBacks);
+    unsigned int seed = 1;
+
+    for (int round = 0; round < 4; ++round) {
+        for (int operation = 0; operation < 2000; ++operation) {
+            AAPLLayoutElementKey key = AAPLLayoutElementKeyMake(rand_r(&seed) % 2, rand_r(&seed) % 40, rand_r(&seed) % 40);
+            AAPLLayoutElementTableSetValue(table, key, &values[rand_r(&seed) % 16]);
+        }
+
+        long retainCount = 0;
+        for (int valueIndex = 0; valueIndex < 16; ++valueIndex)
+            retainCount += values[valueIndex].retainCount;
+        AAPLTestAssert(retainCount == (long)AAPLLayoutElementTableGetCount(table));
+        AAPLTestAssert(AAPLTestNumberOfRetains - AAPLTestNumberOfReleases == retainCount);
+
+        if (round % 2)
+            AAPLLayoutElementTableRemoveAllValues(table);
+    }
+
+    AAPLLayoutElementTableRelease(table);
+    AAPLTestAssert(AAPLTestNumberOfRetains == AAPLTestNumberOfReleases);
+    for (int valueIndex = 0; valueIndex < 16; ++valueIndex)
+        AAPLTestAssert(values[valueIndex].retainCount == 0);
+}
+
+/// A model of the dictionary path the table replaced, which keyed attributes by AAPLIndexPathKind objects. Each lookup allocated a key object and copied the index path into it, hashed the index path and the kind string, and compared candidate keys through a call, as -isEqual: would.
+typedef struct AAPLTestObjectKey {
+    size_t *indexes;
+    size_t length;
+    const char *kind;
+} AAPLTestObjectKey;
+
+typedef struct AAPLTestObjectEntry {
+    AAPLTestObjectKey *key;
+    const void *value;
+    struct AAPLTestObjectEntry *next;
+} AAPLTestObjectEntry;
+
+typedef struct {
+    AAPLTestObjectEntry **buckets;
+    size_t numberOfBuckets;
+} AAPLTestObjectDictionary;
+
+static AAPLTestObjectKey *AAPLTestObjectKeyCreate(const char *kind, size_t section, size_t item)
+{
+    AAPLTestObjectKey *key = malloc(sizeof(AAPLTestObjectKey));
+    key->length = 2;
+    key->indexes = malloc(2 * sizeof(size_t));
+    key->indexes[0] = section;
+    key->indexes[1] = item;
+    // Kinds are immutable strings, so copying one only retains it
+    key->kind = kind;
+    return key;
+}
+
+static void AAPLTestObjectKeyRelease(AAPLTestObjectKey *key)
+{
+    free(key->indexes);
+    free(key);
+}
+
+static size_t AAPLTestObjectKeyHash(const AAPLTestObjectKey *key)
+{
+    size_t indexPathHash = 0;
+    for (size_t position = 0; position < key->length; ++position)
+        indexPathHash = indexPathHash * 257 + key->indexes[position];
+
+    size_t kindHash = 0;
+    for (const char *character = key->kind; *character; ++character)
+        kindHash = kindHash * 31 + (unsigned char)*character;
+
+    size_t result = 1;
+    result = 31 * result + indexPathHash;
+    result = 31 * result + kindHash;
+    return result;
+}
+
+static bool AAPLTestObjectKeyEqual(const AAPLTestObjectKey *key1, const AAPLTestObjectKey *key2)
+{
+    if (key1 == key2)
+        return true;
+    return key1->length == key2->length && !memcmp(key1->indexes, key2->indexes, key1->length * sizeof(size_t)) && !strcmp(key1->kind, key2->kind);
+}
+
+/// Called through a pointer, standing in for message dispatch
+static bool (*volatile AAPLTestObjectKeyIsEqual)(const AAPLTestObjectKey *, const AAPLTestObjectKey *) = AAPLTestObjectKeyEqual;
+
+static void AAPLTestObjectDictionarySetValue(AAPLTestObjectDictionary *dictionary, AAPLTestObjectKey *key, const void *value)
+{
+    size_t bucket = AAPLTestObjectKeyHash(key) % dictionary->numberOfBuckets;
+    AAPLTestObjectEntry *entry = malloc(sizeof(AAPLTestObjectEntry));
+    entry->key = key;
+    entry->value = value;
+    entry->next = dictionary->buckets[bucket];
+    dictionary->buckets[bucket] = entry;
+}
+
+static const void *AAPLTestObjectDictionaryGetValue(AAPLTestObjectDictionary *dictionary, const AAPLTestObjectKey *key)
+{
+    size_t bucket = AAPLTestObjectKeyHash(key) % dictionary->numberOfBuckets;
+    for (AAPLTestObjectEntry *entry = dictionary->buckets[bucket]; entry; entry = entry->next) {
+        if (AAPLTestObjectKeyIsEqual(entry->key, key))
+            return entry->value;
+    }
+    return NULL;
+}
+
+/// Random lookups in a layout of 8,000 sections with a header, a footer and a background each, plus a global header
+static void AAPLTestBenchmark(void)
+{
+    static const char *kinds[] = { "UICollectionElementKindSectionHeader", "UICollectionElementKindSectionFooter", "AAPLGridLayoutBackgroundKind" };
+    const size_t numberOfSections = 8000;
+    const int numberOfLookups = 2000000;
+    AAPLTestValue value = { 0 };
+
+    AAPLLayoutElementTableRef table = AAPLLayoutElementTableCreate(NULL);
+    AAPLTestObjectDictionary dictionary = { NULL, 1 };
+    while (dictionary.numberOfBuckets < 2 * (3 * numberOfSections + 1))
+        dictionary.numberOfBuckets *= 2;
+    dictionary.buckets = calloc(dictionary.numberOfBuckets, sizeof(AAPLTestObjectEntry *));
+
+    AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(0, AAPLTestGlobalSection, 0), &value);
+    AAPLTestObjectDictionarySetValue(&dictionary, AAPLTestObjectKeyCreate(kinds[0], AAPLTestGlobalSection, 0), &value);
+    for (size_t sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex) {
+        for (uint32_t kind = 0; kind < 3; ++kind) {
+            size_t item = (2 == kind ? AAPLTestNotFound : 0);
+            AAPLLayoutElementTableSetValue(table, AAPLLayoutElementKeyMake(kind, sectionIndex, item), &value);
+            AAPLTestObjectDictionarySetValue(&dictionary, AAPLTestObjectKeyCreate(kinds[kind], sectionIndex, item), &value);
+        }
+    }
+
+    // Volatile so the lookups aren't optimized away
+    volatile size_t found = 0;
+    unsigned int seed = 1;
+    double start = AAPLTestGetTime();
+    for (int lookupIndex = 0; lookupIndex < numberOfLookups; ++lookupIndex) {
+        uint32_t kind = rand_r(&seed) % 3;
+        size_t sectionIndex = rand_r(&seed) % numberOfSections;
+        if (AAPLLayoutElementTableGetValue(table, AAPLLayoutElementKeyMake(kind, sectionIndex, (2 == kind ? AAPLTestNotFound : 0))))
+            ++found;
+    }
+    double tableTime = AAPLTestGetTime() - start;
+    AAPLTestAssert(found == (size_t)numberOfLookups);
+
+    found = 0;
+    seed = 1;
+    start = AAPLTestGetTime();
+    for (int lookupIndex = 0; lookupIndex < numberOfLookups; ++lookupIndex) {
+        uint32_t kind = rand_r(&seed) % 3;
+        size_t sectionIndex = rand_r(&seed) % numberOfSections;
+        AAPLTestObjectKey *key = AAPLTestObjectKeyCreate(kinds[kind], sectionIndex, (2 == kind ? AAPLTestNotFound : 0));
+        if (AAPLTestObjectDictionaryGetValue(&dictionary, key))
+            ++found;
+        AAPLTestObjectKeyRelease(key);
+    }
+    double dictionaryTime = AAPLTestGetTime() - start;
+    AAPLTestAssert(found == (size_t)numberOfLookups);
+
+    printf("element table, %zu entries: %.1f M lookups/s, object key dictionary model %.1f M lookups/s\n", AAPLLayoutElementTableGetCount(table), numberOfLookups / tableTime * 1e-6, numberOfLookups / dictionaryTime * 1e-6);
+
+    for (size_t bucket = 0; bucket < dictionary.numberOfBuckets; ++bucket) {
+        AAPLTestObjectEntry *entry = dictionary.buckets[bucket];
+        while (entry) {
+            AAPLTestObjectEntry *next = entry->next;
+            AAPLTestObjectKeyRelease(entry->key);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(dictionary.buckets);
+    AAPLLayoutElementTableRelease(table);
+}
+
+int main(void)
+{
+    AAPLTestInsertAndReplace();
+    AAPLTestMissingKeys();
+    AAPLTestGlobalSectionKeys();
+    AAPLTestGrowth();
+    AAPLTestReleaseBalance();
+    AAPLTestBenchmark();
+    return AAPLTestFinish("AAPLLayoutElementTableTests");
+}
@@ -0,0 +1,208 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLLayoutIndex.h"
+#include "AAPLTestSupport.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    double minY;
+    double maxY;
+} AAPLTestInterval;
+
+typedef struct {
+    size_t *values;
+    size_t count;
+    size_t limit;
+} AAPLTestCollector;
+
+static bool AAPLTestCollect(size_t value, void *context)
+{
+    AAPLTestCollector *collector = context;
+    collector->values[collector->count++] = value;
+    return collector->count < collector->limit;
+}
+
+static bool AAPLTestCount(size_t value, void *context)
+{
+    ++*(size_t *)context;
+    return true;
+}
+
+/// Compare queries against a linear scan for random intervals, some of them much taller than the rest
+static void AAPLTestRandomQueries(void)
+{
+    enum { AAPLTestMaximumCount = 3000 };
+    static AAPLTestInterval intervals[AAPLTestMaximumCount];
+    // Room for a second enumeration after the first
+    static size_t values[2 * AAPLTestMaximumCount];
+
+    AAPLLayoutIndexRef index = AAPLLayoutIndexCreate();
+    AAPLTestAssert(index);
+
+    for (int round = 0; round < 200; ++round) {
+        AAPLLayoutIndexRemoveAllEntries(index);
+        size_t count = (size_t)(rand() % AAPLTestMaximumCount);
+        bool ascending = round % 2;
+        for (size_t position = 0; position < count; ++position) {
+            double minY = ascending ? (double)position * 10 : rand() % 30000;
+            double height = (rand() % 50 ? rand() % 300 : rand() % 30000);
+            intervals[position] = (AAPLTestInterval){ minY, minY + height };
+            AAPLTestAssert(AAPLLayoutIndexAddEntry(index, minY, minY + height, position));
+        }
+        AAPLLayoutIndexFinalize(index);
+        AAPLTestAssert(AAPLLayoutIndexGetCount(index) == count);
+
+        for (int queryIndex = 0; queryIndex < 100; ++queryIndex) {
+            double minY = rand() % 32000 - 1000;
+            double maxY = minY + rand() % 1000;
+
+            AAPLTestCollector collector = { values, 0, SIZE_MAX };
+            size_t visited = AAPLLayoutIndexEnumerateEntriesInRange(index, minY, maxY, AAPLTestCollect, &collector);
+            AAPLTestAssert(visited == collector.count);
+
+            size_t expected = 0;
+            for (size_t position = 0; position < count; ++position) {
+                if (intervals[position].maxY >= minY && intervals[position].minY <= maxY)
+                    ++expected;
+            }
+            AAPLTestAssert(collector.count == expected);
+
+            for (size_t position = 0; position < collector.count; ++position) {
+                const AAPLTestInterval *interval = &intervals[values[position]];
+                AAPLTestAssert(interval->maxY >= minY && interval->minY <= maxY);
+                if (position) {
+                    const AAPLTestInterval *previous = &intervals[values[position - 1]];
+                    AAPLTestAssert(previous->minY < interval->minY || (previous->minY == interval->minY && values[position - 1] < values[position]));
+                }
+            }
+
+            // Stopping early passes a prefix of the same values
+            if (expected > 1) {
+                size_t limit = expected / 2;
+                AAPLTestCollector stopping = { values + expected, 0, limit };
+                AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, minY, maxY, AAPLTestCollect, &stopping) == limit);
+                for (size_t position = 0; position < limit; ++position)
+                    AAPLTestAssert(values[expected + position] == values[position]);
+            }
+        }
+    }
+
+    AAPLLayoutIndexRelease(index);
+}
+
+static void AAPLTestEmptyIndex(void)
+{
+    AAPLLayoutIndexRef index = AAPLLayoutIndexCreate();
+    size_t count = 0;
+    AAPLLayoutIndexFinalize(index);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, -1000, 1000, AAPLTestCount, &count) == 0);
+
+    AAPLLayoutIndexAddEntry(index, 10, 20, 0);
+    AAPLLayoutIndexFinalize(index);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 20, 30, AAPLTestCount, &count) == 1);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 21, 30, AAPLTestCount, &count) == 0);
+
+    AAPLLayoutIndexRemoveAllEntries(index);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, -1000, 1000, AAPLTestCount, &count) == 0);
+    AAPLLayoutIndexRelease(index);
+}
+
+/// Offsets move the entries already added, apply to entries added later and are reset along with the entries
+static void AAPLTestOffsetEntries(void)
+{
+    AAPLLayoutIndexRef index = AAPLLayoutIndexCreate();
+    size_t count = 0;
+
+    AAPLLayoutIndexAddEntry(index, 10, 20, 0);
+    AAPLLayoutIndexOffsetEntries(index, 100);
+    AAPLLayoutIndexAddEntry(index, 150, 160, 1);
+    AAPLLayoutIndexFinalize(index);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 0, 50, AAPLTestCount, &count) == 0);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 110, 120, AAPLTestCount, &count) == 1);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 110, 150, AAPLTestCount, &count) == 2);
+
+    AAPLLayoutIndexOffsetEntries(index, -50);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 60, 70, AAPLTestCount, &count) == 1);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 100, 110, AAPLTestCount, &count) == 1);
+
+    AAPLLayoutIndexRemoveAllEntries(index);
+    AAPLLayoutIndexAddEntry(index, 10, 20, 0);
+    AAPLLayoutIndexFinalize(index);
+    AAPLTestAssert(AAPLLayoutIndexEnumerateEntriesInRange(index, 10, 20, AAPLTestCount, &count) == 1);
+    AAPLLayoutIndexRelease(index);
+}
+
+/// Query screen sized rects in a layout of sections with headers, footers and separators, with and without a background as tall as the whole layout at the top, and compare with a linear scan
+static void AAPLTestBenchmark(bool tallBackground)
+{
+    const size_t numberOfSections = 20000;
+    const double sectionHeight = 600;
+    const double screenHeight = 800;
+    const int numberOfQueries = 200000;
+
+    size_t capacity = 4 * numberOfSections + 1;
+    AAPLTestInterval *intervals = malloc(capacity * sizeof(AAPLTestInterval));
+    size_t count = 0;
+    double layoutHeight = numberOfSections * sectionHeight;
+
+    if (tallBackground)
+        intervals[count++] = (AAPLTestInterval){ 0, layoutHeight };
+    for (size_t sectionIndex = 0; sectionIndex < numberOfSections; ++sectionIndex) {
+        double minY = sectionIndex * sectionHeight;
+        intervals[count++] = (AAPLTestInterval){ minY, minY + 44 };
+        intervals[count++] = (AAPLTestInterval){ minY + 44, minY + 44.5 };
+        intervals[count++] = (AAPLTestInterval){ minY + sectionHeight - 30, minY + sectionHeight };
+        intervals[count++] = (AAPLTestInterval){ minY + sectionHeight - 0.5, minY + sectionHeight };
+    }
+
+    AAPLLayoutIndexRef index = AAPLLayoutIndexCreate();
+    double start = AAPLTestGetTime();
+    for (size_t position = 0; position < count; ++position)
+        AAPLLayoutIndexAddEntry(index, intervals[position].minY, intervals[position].maxY, position);
+    AAPLLayoutIndexFinalize(index);
+    double buildTime = AAPLTestGetTime() - start;
+
+    size_t found = 0;
+    srand(1);
+    start = AAPLTestGetTime();
+    for (int queryIndex = 0; queryIndex < numberOfQueries; ++queryIndex) {
+        double minY = (double)rand() / RAND_MAX * (layoutHeight - screenHeight);
+        AAPLLayoutIndexEnumerateEntriesInRange(index, minY, minY + screenHeight, AAPLTestCount, &found);
+    }
+    double indexTime = AAPLTestGetTime() - start;
+
+    const int numberOfScans = 200;
+    // Volatile so the scan isn't optimized away
+    volatile size_t scanned = 0;
+    srand(1);
+    start = AAPLTestGetTime();
+    for (int queryIndex = 0; queryIndex < numberOfScans; ++queryIndex) {
+        double minY = (double)rand() / RAND_MAX * (layoutHeight - screenHeight);
+        for (size_t position = 0; position < count; ++position) {
+            if (intervals[position].maxY >= minY && intervals[position].minY <= minY + screenHeight)
+                ++scanned;
+        }
+    }
+    double scanTime = AAPLTestGetTime() - start;
+
+    printf("layout index, %zu entries%s: build %.2f ms, query %.3f us (%.1f entries each), linear scan %.1f us\n", count, (tallBackground ? " with a tall background" : ""), buildTime * 1e3, indexTime / numberOfQueries * 1e6, (double)found / numberOfQueries, scanTime / numberOfScans * 1e6);
+
+    AAPLLayoutIndexRelease(index);
+    free(intervals);
+}
+
+int main(void)
+{
+    AAPLTestEmptyIndex();
+    AAPLTestOffsetEntries();
+    AAPLTestRandomQueries();
+    AAPLTestBenchmark(false);
+    AAPLTestBenchmark(true);
+    return AAPLTestFinish("AAPLLayoutIndexTests");
+}
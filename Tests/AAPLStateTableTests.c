@@ -0,0 +1,164 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLStateTable.h"
+#include "AAPLTestSupport.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// The states of the stress test form a ring, where each state may only change to the next one
+enum {
+    AAPLTestNumberOfStates = 8,
+    AAPLTestNumberOfThreads = 8,
+    AAPLTestTransitionsPerThread = 200000,
+};
+
+typedef struct {
+    AAPLStateTableRef table;
+    unsigned int seed;
+    long numberOfTransitions;
+    long numberOfFailures;
+} AAPLTestWorker;
+
+static void AAPLTestValidTransitions(void)
+{
+    AAPLTestAssert(!AAPLStateTableCreate(AAPLStateTableMaximumNumberOfStates + 1));
+
+    AAPLStateTableRef table = AAPLStateTableCreate(AAPLStateTableMaximumNumberOfStates);
+    AAPLTestAssert(table);
+    AAPLTestAssert(AAPLStateTableGetNumberOfStates(table) == AAPLStateTableMaximumNumberOfStates);
+    AAPLTestAssert(AAPLStateTableGetCurrentState(table) == AAPLStateTableNoState);
+
+    // The last state uses the top bit of the masks
+    uint32_t lastState = AAPLStateTableMaximumNumberOfStates - 1;
+    AAPLStateTableAddTransition(table, 0, lastState);
+    AAPLStateTableAddTransition(table, lastState, 0);
+    AAPLStateTableAddTransition(table, 0, AAPLStateTableMaximumNumberOfStates);
+    AAPLTestAssert(AAPLStateTableIsValidTransition(table, 0, lastState));
+    AAPLTestAssert(AAPLStateTableIsValidTransition(table, lastState, 0));
+    AAPLTestAssert(!AAPLStateTableIsValidTransition(table, 0, 1));
+    AAPLTestAssert(!AAPLStateTableIsValidTransition(table, 0, AAPLStateTableMaximumNumberOfStates));
+    AAPLTestAssert(AAPLStateTableIsValidTransition(table, AAPLStateTableNoState, 5));
+
+    uint32_t fromState = 0;
+    AAPLTestAssert(AAPLStateTableTransition(table, 0, &fromState));
+    AAPLTestAssert(fromState == AAPLStateTableNoState);
+    AAPLTestAssert(!AAPLStateTableTransition(table, 1, &fromState));
+    AAPLTestAssert(fromState == 0);
+    AAPLTestAssert(AAPLStateTableGetCurrentState(table) == 0);
+    AAPLTestAssert(AAPLStateTableTransition(table, lastState, &fromState));
+    AAPLTestAssert(fromState == 0);
+
+    AAPLStateTableRemoveAllTransitions(table);
+    AAPLTestAssert(!AAPLStateTableTransition(table, 0, NULL));
+    AAPLTestAssert(AAPLStateTableGetCurrentState(table) == lastState);
+
+    AAPLStateTableRelease(table);
+}
+
+static void *AAPLTestRunWorker(void *context)
+{
+    AAPLTestWorker *worker = context;
+
+    for (int transitionIndex = 0; transitionIndex < AAPLTestTransitionsPerThread; ++transitionIndex) {
+        uint32_t currentState = AAPLStateTableGetCurrentState(worker->table);
+        if (currentState >= AAPLTestNumberOfStates)
+            ++worker->numberOfFailures;
+
+        // Mostly valid transitions, with some random ones the table must refuse unless they happen to be valid
+        uint32_t toState = (currentState + 1) % AAPLTestNumberOfStates;
+        if (0 == rand_r(&worker->seed) % 4)
+            toState = (uint32_t)rand_r(&worker->seed) % AAPLTestNumberOfStates;
+
+        uint32_t fromState;
+        if (AAPLStateTableTransition(worker->table, toState, &fromState)) {
+            if (toState != (fromState + 1) % AAPLTestNumberOfStates)
+                ++worker->numberOfFailures;
+            ++worker->numberOfTransitions;
+        }
+        else if (toState == (fromState + 1) % AAPLTestNumberOfStates)
+            ++worker->numberOfFailures;
+    }
+
+    return NULL;
+}
+
+/// Race transitions around the ring from several threads. Every transition must have been valid from the state it replaced, so the final state follows from the number of transitions.
+static void AAPLTestConcurrentTransitions(void)
+{
+    AAPLStateTableRef table = AAPLStateTableCreate(AAPLTestNumberOfStates);
+    for (uint32_t state = 0; state < AAPLTestNumberOfStates; ++state)
+        AAPLStateTableAddTransition(table, state, (state + 1) % AAPLTestNumberOfStates);
+    AAPLTestAssert(AAPLStateTableTransition(table, 0, NULL));
+
+    pthread_t threads[AAPLTestNumberOfThreads];
+    AAPLTestWorker workers[AAPLTestNumberOfThreads];
+    for (int threadIndex = 0; threadIndex < AAPLTestNumberOfThreads; ++threadIndex) {
+        workers[threadIndex] = (AAPLTestWorker){ table, (unsigned int)threadIndex + 1, 0, 0 };
+        AAPLTestAssert(0 == pthread_create(&threads[threadIndex], NULL, AAPLTestRunWorker, &workers[threadIndex]));
+    }
+
+    long numberOfTransitions = 0;
+    for (int threadIndex = 0; threadIndex < AAPLTestNumberOfThreads; ++threadIndex) {
+        pthread_join(threads[threadIndex], NULL);
+        AAPLTestAssert(0 == workers[threadIndex].numberOfFailures);
+        numberOfTransitions += workers[threadIndex].numberOfTransitions;
+    }
+
+    AAPLTestAssert(AAPLStateTableGetCurrentState(table) == (uint32_t)(numberOfTransitions % AAPLTestNumberOfStates));
+    printf("state table, %d threads: %ld transitions\n", AAPLTestNumberOfThreads, numberOfTransitions);
+
+    AAPLStateTableRelease(table);
+}
+
+/// Compare reading and validated transitions against taking an uncontended mutex, which is what the state machine used to do for each read
+static void AAPLTestBenchmark(void)
+{
+    const int numberOfReads = 50000000;
+    const int numberOfTransitions = 20000000;
+
+    AAPLStateTableRef table = AAPLStateTableCreate(AAPLTestNumberOfStates);
+    for (uint32_t state = 0; state < AAPLTestNumberOfStates; ++state)
+        AAPLStateTableAddTransition(table, state, (state + 1) % AAPLTestNumberOfStates);
+    AAPLStateTableTransition(table, 0, NULL);
+
+    // Volatile so the loops aren't optimized away
+    volatile uint32_t sink = 0;
+
+    double start = AAPLTestGetTime();
+    for (int readIndex = 0; readIndex < numberOfReads; ++readIndex)
+        sink += AAPLStateTableGetCurrentState(table);
+    double readTime = AAPLTestGetTime() - start;
+
+    start = AAPLTestGetTime();
+    for (int transitionIndex = 0; transitionIndex < numberOfTransitions; ++transitionIndex)
+        AAPLStateTableTransition(table, (AAPLStateTableGetCurrentState(table) + 1) % AAPLTestNumberOfStates, NULL);
+    double transitionTime = AAPLTestGetTime() - start;
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    uint32_t lockedState = 0;
+    start = AAPLTestGetTime();
+    for (int readIndex = 0; readIndex < numberOfReads; ++readIndex) {
+        pthread_mutex_lock(&mutex);
+        sink += lockedState;
+        pthread_mutex_unlock(&mutex);
+    }
+    double mutexTime = AAPLTestGetTime() - start;
+
+    printf("state table: read %.2f ns, validated transition %.2f ns, mutex read %.2f ns\n", readTime / numberOfReads * 1e9, transitionTime / numberOfTransitions * 1e9, mutexTime / numberOfReads * 1e9);
+
+    AAPLStateTableRelease(table);
+}
+
+int main(void)
+{
+    AAPLTestValidTransitions();
+    AAPLTestConcurrentTransitions();
+    AAPLTestBenchmark();
+    return AAPLTestFinish("AAPLStateTableTests");
+}
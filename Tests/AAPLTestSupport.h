@@ -0,0 +1,42 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#ifndef AAPL_TEST_SUPPORT_H
+#define AAPL_TEST_SUPPORT_H
+
+#include <stdio.h>
+#include <time.h>
+
+/// The number of failed assertions so far
+static int AAPLTestFailureCount;
+
+/// Report a failed condition and keep going, so one run shows every failure
+#define AAPLTestAssert(condition) do { \
+    if (!(condition)) { \
+        ++AAPLTestFailureCount; \
+        fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+    } \
+} while (0)
+
+/// A monotonic time in seconds for benchmarks
+static inline double AAPLTestGetTime(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/// Print the result and return the exit status for main
+static inline int AAPLTestFinish(const char *name)
+{
+    if (AAPLTestFailureCount) {
+        fprintf(stderr, "%s: %d failures\n", name, AAPLTestFailureCount);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+#endif
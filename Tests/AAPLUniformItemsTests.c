@@ -0,0 +1,215 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+#include "AAPLUniformItems.h"
+#include "AAPLTestSupport.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Items stored the way sections with per item storage keep them, to compare against
+typedef struct {
+    double minY;
+    double height;
+} AAPLTestItem;
+
+/// Stack the items and return the total height
+static double AAPLTestLayOutItems(AAPLTestItem *testItems, size_t numberOfItems)
+{
+    double y = 0;
+    for (size_t itemIndex = 0; itemIndex < numberOfItems; ++itemIndex) {
+        testItems[itemIndex].minY = y;
+        y += testItems[itemIndex].height;
+    }
+    return y;
+}
+
+static size_t AAPLTestIndexOfFirstItemReachingY(const AAPLTestItem *testItems, size_t numberOfItems, double y)
+{
+    size_t low = 0, high = numberOfItems;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (testItems[middle].minY + testItems[middle].height < y)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static void AAPLTestEmptyColumn(void)
+{
+    AAPLUniformItemsRef items = AAPLUniformItemsCreate();
+    AAPLTestAssert(items);
+    AAPLTestAssert(AAPLUniformItemsGetNumberOfHeights(items) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetHeight(items, 0, 44) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 0, 44, 100) == 0);
+
+    double height = 0;
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 3, 44, &height) == 132);
+    AAPLTestAssert(height == 44);
+    AAPLTestAssert(AAPLUniformItemsGetHeight(items, 10, 44) == 440);
+
+    // Touching the bottom of an item reaches it
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 44, -5) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 44, 44) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 44, 44.5) == 1);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 44, 440) == 9);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 44, 441) == 10);
+
+    // A zero row height can't be divided by
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 0, 0) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, 10, 0, 1) == 10);
+
+    AAPLUniformItemsRelease(items);
+    AAPLUniformItemsRelease(NULL);
+}
+
+static void AAPLTestRemeasuredItems(void)
+{
+    AAPLUniformItemsRef items = AAPLUniformItemsCreate();
+    double height;
+
+    AAPLTestAssert(AAPLUniformItemsSetHeight(items, 5, 100, 44));
+    AAPLTestAssert(AAPLUniformItemsSetHeight(items, 2, 10, 44));
+    AAPLTestAssert(AAPLUniformItemsGetNumberOfHeights(items) == 2);
+    AAPLTestAssert(AAPLUniformItemsGetItemIndexAtPosition(items, 0) == 2);
+    AAPLTestAssert(AAPLUniformItemsGetItemIndexAtPosition(items, 1) == 5);
+
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 2, 44, &height) == 88 && height == 10);
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 3, 44, &height) == 98 && height == 44);
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 5, 44, &height) == 186 && height == 100);
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 6, 44, &height) == 286 && height == 44);
+    AAPLTestAssert(AAPLUniformItemsGetHeight(items, 7, 44) == 330);
+
+    // Setting the row height keeps the item recorded, and leaves the column as if it had never been remeasured
+    AAPLTestAssert(AAPLUniformItemsSetHeight(items, 2, 44, 44));
+    AAPLTestAssert(AAPLUniformItemsSetHeight(items, 5, 44, 44));
+    AAPLTestAssert(AAPLUniformItemsGetNumberOfHeights(items) == 2);
+    AAPLTestAssert(AAPLUniformItemsGetHeight(items, 7, 44) == 308);
+
+    // Setting the height an unrecorded item already has records nothing
+    AAPLTestAssert(AAPLUniformItemsSetHeight(items, 3, 44, 44));
+    AAPLTestAssert(AAPLUniformItemsGetNumberOfHeights(items) == 2);
+
+    AAPLUniformItemsRemoveAllHeights(items);
+    AAPLTestAssert(AAPLUniformItemsGetNumberOfHeights(items) == 0);
+    AAPLTestAssert(AAPLUniformItemsGetItemMinY(items, 6, 44, &height) == 264 && height == 44);
+
+    AAPLUniformItemsRelease(items);
+}
+
+/// Remeasure random items of random columns and compare every position and many queries with items stored one by one
+static void AAPLTestRandomColumns(void)
+{
+    const size_t maximumNumberOfItems = 300;
+    AAPLTestItem *testItems = malloc(maximumNumberOfItems * sizeof(AAPLTestItem));
+    unsigned int seed = 1;
+
+    for (int trial = 0; trial < 2000; ++trial) {
+        size_t numberOfItems = 1 + rand_r(&seed) % maximumNumberOfItems;
+        // Row heights that aren't exactly representable exercise the rounding of the division
+        double rowHeight = (trial % 3 ? 44 : 0.1 + rand_r(&seed) % 1000 / 7.0);
+        for (size_t itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+            testItems[itemIndex].height = rowHeight;
+
+        AAPLUniformItemsRef items = AAPLUniformItemsCreate();
+        int numberOfChanges = (trial % 4 ? rand_r(&seed) % 20 : 0);
+        for (int change = 0; change < numberOfChanges; ++change) {
+            size_t itemIndex = rand_r(&seed) % numberOfItems;
+            double height = (rand_r(&seed) % 4 ? rand_r(&seed) % 200 : rowHeight);
+            AAPLTestAssert(AAPLUniformItemsSetHeight(items, itemIndex, height, rowHeight));
+            testItems[itemIndex].height = height;
+        }
+
+        double totalHeight = AAPLTestLayOutItems(testItems, numberOfItems);
+        AAPLTestAssert(fabs(AAPLUniformItemsGetHeight(items, numberOfItems, rowHeight) - totalHeight) < 1e-6);
+
+        // Positions computed from the row height may differ from a running sum in the last bits, so queries are checked against the computed positions
+        for (size_t itemIndex = 0; itemIndex < numberOfItems; ++itemIndex) {
+            double height;
+            double minY = AAPLUniformItemsGetItemMinY(items, itemIndex, rowHeight, &height);
+            AAPLTestAssert(fabs(minY - testItems[itemIndex].minY) < 1e-6);
+            AAPLTestAssert(height == testItems[itemIndex].height);
+            testItems[itemIndex].minY = minY;
+        }
+
+        for (int query = 0; query < 30; ++query) {
+            double y;
+            if (query % 2) {
+                // Exactly on an item edge, where rounding matters most
+                size_t itemIndex = rand_r(&seed) % numberOfItems;
+                y = testItems[itemIndex].minY + (query % 4 == 1 ? testItems[itemIndex].height : 0);
+            }
+            else
+                y = (double)rand_r(&seed) / RAND_MAX * (totalHeight + 200) - 100;
+
+            AAPLTestAssert(AAPLUniformItemsGetIndexOfFirstItemReachingY(items, numberOfItems, rowHeight, y) == AAPLTestIndexOfFirstItemReachingY(testItems, numberOfItems, y));
+        }
+
+        AAPLUniformItemsRelease(items);
+    }
+
+    free(testItems);
+}
+
+/// Lay out a section of a million rows and find the first item reaching random positions, computed from the row height and with the items stored one by one
+static void AAPLTestBenchmark(void)
+{
+    const size_t numberOfItems = 1000000;
+    const double rowHeight = 44;
+    const int numberOfLayouts = 20;
+    const int numberOfQueries = 1000000;
+
+    // Volatile so the work isn't optimized away
+    volatile double height = 0;
+    volatile size_t found = 0;
+
+    AAPLUniformItemsRef items = AAPLUniformItemsCreate();
+    double start = AAPLTestGetTime();
+    for (int layout = 0; layout < numberOfLayouts; ++layout)
+        height = AAPLUniformItemsGetHeight(items, numberOfItems, rowHeight + layout);
+    double uniformLayoutTime = (AAPLTestGetTime() - start) / numberOfLayouts;
+
+    AAPLTestItem *testItems = malloc(numberOfItems * sizeof(AAPLTestItem));
+    start = AAPLTestGetTime();
+    for (int layout = 0; layout < numberOfLayouts; ++layout) {
+        for (size_t itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+            testItems[itemIndex].height = rowHeight + layout;
+        height = AAPLTestLayOutItems(testItems, numberOfItems);
+    }
+    double arrayLayoutTime = (AAPLTestGetTime() - start) / numberOfLayouts;
+    AAPLTestAssert(height == AAPLUniformItemsGetHeight(items, numberOfItems, rowHeight + numberOfLayouts - 1));
+
+    unsigned int seed = 1;
+    start = AAPLTestGetTime();
+    for (int query = 0; query < numberOfQueries; ++query)
+        found += AAPLUniformItemsGetIndexOfFirstItemReachingY(items, numberOfItems, height / numberOfItems, (double)rand_r(&seed) / RAND_MAX * height);
+    double uniformQueryTime = (AAPLTestGetTime() - start) / numberOfQueries;
+    size_t uniformFound = found;
+
+    found = 0;
+    seed = 1;
+    start = AAPLTestGetTime();
+    for (int query = 0; query < numberOfQueries; ++query)
+        found += AAPLTestIndexOfFirstItemReachingY(testItems, numberOfItems, (double)rand_r(&seed) / RAND_MAX * height);
+    double arrayQueryTime = (AAPLTestGetTime() - start) / numberOfQueries;
+    AAPLTestAssert(found == uniformFound);
+
+    printf("uniform items, %zu rows: layout %.0f ns, first item reaching y %.0f ns; stored items (%.0f MB): layout %.2f ms, first item reaching y %.0f ns\n", numberOfItems, uniformLayoutTime * 1e9, uniformQueryTime * 1e9, numberOfItems * sizeof(AAPLTestItem) / 1e6, arrayLayoutTime * 1e3, arrayQueryTime * 1e9);
+
+    free(testItems);
+    AAPLUniformItemsRelease(items);
+}
+
+int main(void)
+{
+    AAPLTestEmptyColumn();
+    AAPLTestRemeasuredItems();
+    AAPLTestRandomColumns();
+    AAPLTestBenchmark();
+    return AAPLTestFinish("AAPLUniformItemsTests");
+}
@@ -0,0 +1,14 @@
+/*
+ Copyright (C) 2014 Apple Inc. All Rights Reserved.
+ See LICENSE.txt for this sample’s licensing information
+ */
+
+// Stands in for UIKit when building Foundation-only parts of the framework for the tests. The tests implement these.
+
+#import <Foundation/Foundation.h>
+
+@interface NSIndexPath (AAPLTestItemAndSection)
++ (instancetype)indexPathForItem:(NSInteger)item inSection:(NSInteger)section;
+@property (nonatomic, readonly) NSInteger item;
+@property (nonatomic, readonly) NSInteger section;
+@end